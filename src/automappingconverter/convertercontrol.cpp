@@ -21,34 +21,120 @@
 
 #include "convertercontrol.h"
 
-#include "map.h"
-#include "layer.h"
-#include "tileset.h"
+#include <QBuffer>
+#include <QDebug>
+#include <QFile>
+#include <QRunnable>
+#include <QThreadPool>
+#include <QVector>
+#include <QXmlStreamReader>
+#include <QXmlStreamWriter>
 
-#include "mapreader.h"
-#include "mapwriter.h"
+namespace {
 
-#include <QDebug>
-#include <QSettings>
+/**
+ * Determines the version of a single file and converts it when asked to.
+ * The results are written to slots owned by ConverterControl::process().
+ */
+class ProcessJob : public QRunnable
+{
+public:
+    ProcessJob(const ConverterControl *control,
+               const QString &fileName,
+               bool convert,
+               QString *version,
+               bool *converted)
+        : mControl(control)
+        , mFileName(fileName)
+        , mConvert(convert)
+        , mVersion(version)
+        , mConverted(converted)
+    {}
 
-using namespace Tiled;
+    void run()
+    {
+        *mVersion = mControl->automappingRuleFileVersion(mFileName);
 
-ConverterControl::ConverterControl()
+        if (mConvert && *mVersion == mControl->version1()
+                && mControl->convertV1toV2(mFileName)) {
+            *mVersion = mControl->version2();
+            *mConverted = true;
+        }
+    }
+
+private:
+    const ConverterControl *mControl;
+    QString mFileName;
+    bool mConvert;
+    QString *mVersion;
+    bool *mConverted;
+};
+
+} // anonymous namespace
+
+static bool isLayerElement(const QStringRef &name)
+{
+    return name == QLatin1String("layer")
+            || name == QLatin1String("objectgroup")
+            || name == QLatin1String("imagelayer");
+}
+
+/**
+ * Reads the names of the layers in the given map file. The contents of the
+ * tilesets and layers are skipped, so no images are loaded and no layer
+ * data is decoded.
+ *
+ * Returns false when the file could not be read or isn't a map.
+ */
+static bool readLayerNames(const QString &fileName, QStringList *layerNames)
 {
+    QFile file(fileName);
+    if (!file.open(QIODevice::ReadOnly))
+        return false;
+
+    QXmlStreamReader xml(&file);
+    if (!xml.readNextStartElement() || xml.name() != QLatin1String("map"))
+        return false;
+
+    while (xml.readNextStartElement()) {
+        if (isLayerElement(xml.name()))
+            layerNames->append(xml.attributes().value(QLatin1String("name")).toString());
+        xml.skipCurrentElement();
+    }
+
+    return !xml.hasError();
 }
 
-QString ConverterControl::automappingRuleFileVersion(const QString &fileName)
+static QString convertedLayerName(const QString &name, const QString &fileName)
 {
-    Tiled::MapReader reader;
-    Tiled::Map *map = reader.readMap(fileName);
+    if (name.startsWith("ruleset", Qt::CaseInsensitive))
+        return QLatin1String("Input_set");
+    if (name.startsWith("rulenotset", Qt::CaseInsensitive))
+        return QLatin1String("InputNot_set");
+    if (name.startsWith("ruleregions", Qt::CaseInsensitive))
+        return QLatin1String("Regions");
+    if (name.startsWith("rule", Qt::CaseInsensitive))
+        return "Output" + name.right(name.length() - 4);
 
-    if (!map)
+    qWarning() << QString("Warning at conversion of") << fileName <<
+                  QString("unused layers found");
+    return name;
+}
+
+ConverterControl::ConverterControl()
+{
+}
+
+QString ConverterControl::automappingRuleFileVersion(const QString &fileName) const
+{
+    QStringList layerNames;
+    if (!readLayerNames(fileName, &layerNames))
         return versionNotAMap();
 
     // version 1 check
     bool hasonlyruleprefix = true;
-    foreach (Tiled::Layer *layer, map->layers()) {
-        if (!layer->name().startsWith("rule", Qt::CaseInsensitive))
+    foreach (const QString &name, layerNames) {
+        if (!name.startsWith("rule", Qt::CaseInsensitive))
             hasonlyruleprefix = false;
     }
     if (hasonlyruleprefix)
@@ -60,17 +146,17 @@ QString ConverterControl::automappingRuleFileVersion(const QString &fileName)
     bool hasregion = false;
     bool allused = true;
 
-    foreach (Tiled::Layer *layer, map->layers()) {
+    foreach (const QString &name, layerNames) {
         bool isunused = true;
-        if (layer->name().startsWith("input", Qt::CaseInsensitive)) {
+        if (name.startsWith("input", Qt::CaseInsensitive)) {
             hasrule = true;
             isunused = false;
         }
-        if (layer->name().startsWith("output", Qt::CaseInsensitive)) {
+        if (name.startsWith("output", Qt::CaseInsensitive)) {
             hasoutput = true;
             isunused = false;
         }
-        if (layer->name().toLower() == "regions") {
+        if (name.toLower() == "regions") {
             hasregion = true;
             isunused = false;
         }
@@ -83,36 +169,103 @@ QString ConverterControl::automappingRuleFileVersion(const QString &fileName)
     return versionUnknown();
 }
 
-void ConverterControl::convertV1toV2(const QString &fileName)
+/**
+ * Renames the layers by copying the file token by token, which leaves
+ * everything else, including the encoding of the layer data, as it was.
+ * The file is only overwritten once it has been read successfully.
+ */
+bool ConverterControl::convertV1toV2(const QString &fileName) const
 {
-    Tiled::MapReader reader;
-    Tiled::Map *map = reader.readMap(fileName);
-
-    if (!map) {
+    QFile file(fileName);
+    if (!file.open(QIODevice::ReadOnly)) {
         qWarning() << "Error at conversion of " << fileName << ":\n"
-                   << reader.errorString();
-        return;
+                   << file.errorString();
+        return false;
     }
 
-    foreach (Tiled::Layer *layer, map->layers()) {
-        if (layer->name().startsWith("ruleset", Qt::CaseInsensitive)) {
-            layer->setName("Input_set");
-        } else if (layer->name().startsWith("rulenotset", Qt::CaseInsensitive)) {
-            layer->setName("InputNot_set");
-        } else if (layer->name().startsWith("ruleregions", Qt::CaseInsensitive)) {
-            layer->setName("Regions");
-        } else if (layer->name().startsWith("rule", Qt::CaseInsensitive)) {
-            const QString newname = layer->name().right(layer->name().length() - 4);
-            layer->setName("Output" + newname);
+    QByteArray converted;
+    QBuffer buffer(&converted);
+    buffer.open(QIODevice::WriteOnly);
+
+    QXmlStreamReader reader(&file);
+    QXmlStreamWriter writer(&buffer);
+    int depth = 0;
+
+    while (!reader.atEnd()) {
+        reader.readNext();
+        if (reader.hasError())
+            break;
+
+        if (reader.isStartElement() && depth == 1
+                && isLayerElement(reader.name())) {
+            writer.writeStartElement(reader.name().toString());
+            foreach (const QXmlStreamAttribute &attribute, reader.attributes()) {
+                if (attribute.name() == QLatin1String("name")) {
+                    const QString name = attribute.value().toString();
+                    writer.writeAttribute(QLatin1String("name"),
+                                          convertedLayerName(name, fileName));
+                } else {
+                    writer.writeAttribute(attribute);
+                }
+            }
         } else {
-            qWarning() << QString("Warning at conversion of") << fileName <<
-                          QString("unused layers found");
+            writer.writeCurrentToken(reader);
         }
+
+        if (reader.isStartElement())
+            ++depth;
+        else if (reader.isEndElement())
+            --depth;
+    }
+
+    if (reader.hasError()) {
+        qWarning() << "Error at conversion of " << fileName << ":\n"
+                   << reader.errorString();
+        return false;
+    }
+
+    file.close();
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)
+            || file.write(converted) != converted.size()) {
+        qWarning() << "Error at conversion of " << fileName << ":\n"
+                   << file.errorString();
+        return false;
     }
 
-    Tiled::MapWriter writer;
-    writer.writeMap(map, fileName);
+    return true;
+}
 
-    qDeleteAll(map->tilesets());
-    delete map;
+QMap<QString, QString> ConverterControl::fileVersions(const QStringList &fileNames) const
+{
+    return process(fileNames, false, 0);
+}
+
+QMap<QString, QString> ConverterControl::convertAll(const QStringList &fileNames,
+                                                    QStringList *convertedFiles) const
+{
+    return process(fileNames, true, convertedFiles);
+}
+
+QMap<QString, QString> ConverterControl::process(const QStringList &fileNames,
+                                                 bool convert,
+                                                 QStringList *convertedFiles) const
+{
+    const int count = fileNames.size();
+    QVector<QString> versions(count);
+    QVector<bool> converted(count);
+
+    QThreadPool threadPool;
+    for (int i = 0; i < count; ++i) {
+        threadPool.start(new ProcessJob(this, fileNames.at(i), convert,
+                                        &versions[i], &converted[i]));
+    }
+    threadPool.waitForDone();
+
+    QMap<QString, QString> result;
+    for (int i = 0; i < count; ++i) {
+        result.insert(fileNames.at(i), versions.at(i));
+        if (converted.at(i) && convertedFiles)
+            convertedFiles->append(fileNames.at(i));
+    }
+    return result;
 }
@@ -22,9 +22,17 @@
 #ifndef CONVERTERCONTROL_H
 #define CONVERTERCONTROL_H
 
+#include <QMap>
 #include <QString>
+#include <QStringList>
 #include <QObject>
 
+/**
+ * Detects and converts the version of automapping rule files.
+ *
+ * Both only look at the layer elements of the map file and never load the
+ * tilesets or the layer data, which makes them safe to run on worker threads.
+ */
 class ConverterControl
 {
 public:
@@ -35,8 +43,32 @@ public:
     QString versionUnknown() const { return QObject::tr("unknown"); }
     QString versionNotAMap() const { return QObject::tr("not a map"); }
 
-    QString automappingRuleFileVersion(const QString &fileName);
-    void convertV1toV2(const QString &fileName);
+    QString automappingRuleFileVersion(const QString &fileName) const;
+    bool convertV1toV2(const QString &fileName) const;
+
+    /**
+     * Returns the version of each of the given files. The files are read
+     * concurrently.
+     */
+    QMap<QString, QString> fileVersions(const QStringList &fileNames) const;
+
+    /**
+     * Converts all given files that are at version 1 to version 2. The
+     * files are processed concurrently, and files at any other version are
+     * left untouched.
+     *
+     * @param fileNames      the files to convert
+     * @param convertedFiles when not 0, receives the files that were
+     *                       rewritten
+     * @return the version of each of the files after the conversion
+     */
+    QMap<QString, QString> convertAll(const QStringList &fileNames,
+                                      QStringList *convertedFiles = 0) const;
+
+private:
+    QMap<QString, QString> process(const QStringList &fileNames,
+                                   bool convert,
+                                   QStringList *convertedFiles) const;
 };
 
 #endif // CONVERTERCONTROL_H
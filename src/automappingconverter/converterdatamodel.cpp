@@ -87,21 +87,33 @@ void ConverterDataModel::insertFileNames(const QStringList &fileNames)
     const int row = mFileNames.size();
     beginInsertRows(QModelIndex(), row, row + fileNames.count() - 1);
     mFileNames.append(fileNames);
-    foreach (const QString &fileName, fileNames)
-         mFileVersions[fileName] = mControl->automappingRuleFileVersion(fileName);
+    const QMap<QString, QString> versions = mControl->fileVersions(fileNames);
+    QMapIterator<QString, QString> it(versions);
+    while (it.hasNext()) {
+        it.next();
+        mFileVersions.insert(it.key(), it.value());
+    }
     endInsertRows();
 }
 
 void ConverterDataModel::updateVersions()
 {
-    for (int i = 0; i < count(); ++i) {
-        const QString fileName = mFileNames.at(i);
-        const QString version = mFileVersions[fileName];
-        qWarning() << "processing" << fileName << "at version" << version;
-        if (version == mControl->version1()) {
-            mControl->convertV1toV2(fileName);
-            mFileVersions[fileName] = mControl->version2();
-        }
+    QStringList toConvert;
+    foreach (const QString &fileName, mFileNames)
+        if (mFileVersions.value(fileName) == mControl->version1())
+            toConvert.append(fileName);
+
+    QStringList converted;
+    const QMap<QString, QString> versions = mControl->convertAll(toConvert,
+                                                                 &converted);
+    QMapIterator<QString, QString> it(versions);
+    while (it.hasNext()) {
+        it.next();
+        mFileVersions.insert(it.key(), it.value());
     }
+
+    foreach (const QString &fileName, converted)
+        qWarning() << "converted" << fileName << "to version" << mControl->version2();
+
     emit dataChanged(index(0), index(count()));
 }
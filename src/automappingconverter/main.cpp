@@ -19,12 +19,136 @@
  * this program. If not, see <http://www.gnu.org/licenses/>.
  */
  
+#include "convertercontrol.h"
 #include "converterwindow.h"
 
 #include <QApplication>
+#include <QDirIterator>
+#include <QFileInfo>
+#include <QTextStream>
+
+#include <cstdio>
+
+/**
+ * Collects the map files to process. Directories are searched recursively
+ * for .tmx files.
+ */
+static QStringList collectFiles(const QStringList &paths)
+{
+    QStringList fileNames;
+
+    foreach (const QString &path, paths) {
+        if (!QFileInfo(path).isDir()) {
+            fileNames.append(path);
+            continue;
+        }
+
+        QDirIterator it(path, QStringList() << QLatin1String("*.tmx"),
+                        QDir::Files, QDirIterator::Subdirectories);
+        while (it.hasNext())
+            fileNames.append(it.next());
+    }
+
+    return fileNames;
+}
+
+/**
+ * Converts the given files and directories without showing the window.
+ * With --check, only the versions are reported.
+ */
+static int runHeadless(QStringList arguments)
+{
+    QTextStream out(stdout);
+
+    if (arguments.contains(QLatin1String("--help"))) {
+        out << "Usage: automappingconverter [--check] [files or directories...]\n"
+               "\n"
+               "Converts the given automapping rule files from the format of\n"
+               "Tiled 0.8 and before to the format of Tiled 0.9 and later.\n"
+               "Directories are searched for .tmx files recursively. Without\n"
+               "arguments, the converter window is shown.\n"
+               "\n"
+               "  --check   only report the version of each file\n";
+        return 0;
+    }
+
+    const bool check = arguments.removeAll(QLatin1String("--check")) > 0;
+
+    foreach (const QString &argument, arguments) {
+        if (argument.startsWith(QLatin1Char('-')) && !QFileInfo(argument).exists()) {
+            QTextStream(stderr) << "Unknown option: " << argument << '\n'
+                                << "Try --help for the usage.\n";
+            return 1;
+        }
+    }
+
+    if (arguments.isEmpty()) {
+        QTextStream(stderr) << "No files or directories given.\n";
+        return 1;
+    }
+
+    const QStringList fileNames = collectFiles(arguments);
+
+    ConverterControl control;
+
+    if (check) {
+        const QMap<QString, QString> versions = control.fileVersions(fileNames);
+        QMapIterator<QString, QString> it(versions);
+        while (it.hasNext()) {
+            it.next();
+            out << it.key() << ": " << it.value() << '\n';
+        }
+        return 0;
+    }
+
+    QStringList converted;
+    const QMap<QString, QString> versions = control.convertAll(fileNames,
+                                                               &converted);
+    int failed = 0;
+    foreach (const QString &fileName, converted)
+        out << "converted " << fileName << '\n';
+    foreach (const QString &version, versions)
+        if (version == control.version1())
+            ++failed;
+
+    out << converted.size() << " converted, "
+        << versions.size() - converted.size() - failed << " skipped, "
+        << failed << " failed\n";
+
+    return failed == 0 ? 0 : 1;
+}
+
+/**
+ * Returns whether the command line asks for converting without the window.
+ * This is the case when existing files or directories, or the options of the
+ * converter itself are given. Anything else, like the options handled by Qt,
+ * leaves the window to be shown.
+ */
+static bool isHeadless(int argc, char *argv[])
+{
+    for (int i = 1; i < argc; ++i) {
+        const QString argument = QString::fromLocal8Bit(argv[i]);
+
+        if (argument == QLatin1String("--check") ||
+                argument == QLatin1String("--help"))
+            return true;
+
+        if (!argument.startsWith(QLatin1Char('-')) &&
+                QFileInfo(argument).exists())
+            return true;
+    }
+
+    return false;
+}
 
 int main(int argc, char *argv[])
 {
+    // Converting without the window must not need a display
+    if (isHeadless(argc, argv)) {
+        QCoreApplication a(argc, argv);
+        return runHeadless(a.arguments().mid(1));
+    }
+
     QApplication a(argc, argv);
     ConverterWindow w;
     w.show();
@@ -0,0 +1,349 @@
+/*
+ * collisioncache.cpp
+ * Copyright 2015, Sydoria Games <luax@sydoria.fr>
+ *
+ * This file is part of libtiled.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *    1. Redistributions of source code must retain the above copyright notice,
+ *       this list of conditions and the following disclaimer.
+ *
+ *    2. Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE CONTRIBUTORS ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO
+ * EVENT SHALL THE CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include "collisioncache.h"
+
+#include "map.h"
+#include "mapobject.h"
+#include "objectgroup.h"
+#include "tile.h"
+#include "tilelayer.h"
+#include "tileset.h"
+
+#include <QTransform>
+
+#include <cmath>
+
+// MSVC 2010 math header does not come with M_PI
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+using namespace Tiled;
+
+/**
+ * The amount of points used to approximate an ellipse.
+ */
+static const int ellipseSegments = 16;
+
+/**
+ * Points closer than this to the line through their neighbors, in pixels,
+ * are left out of the simplified polygons.
+ */
+static const qreal simplifyTolerance = 0.5;
+
+static qreal distanceToLine(const QPointF &point,
+                            const QPointF &start, const QPointF &end)
+{
+    const QPointF d = end - start;
+    const qreal length = std::sqrt(d.x() * d.x() + d.y() * d.y());
+    if (length == 0) {
+        const QPointF p = point - start;
+        return std::sqrt(p.x() * p.x() + p.y() * p.y());
+    }
+    return std::fabs(d.y() * point.x() - d.x() * point.y()
+                     + end.x() * start.y() - end.y() * start.x()) / length;
+}
+
+/**
+ * Douglas-Peucker simplification of the points from \a first to \a last,
+ * marking the points to keep in \a keep.
+ */
+static void simplify(const QPolygonF &polygon, int first, int last,
+                     QVector<bool> &keep)
+{
+    qreal maxDistance = 0;
+    int index = -1;
+
+    for (int i = first + 1; i < last; ++i) {
+        const qreal distance = distanceToLine(polygon.at(i),
+                                              polygon.at(first),
+                                              polygon.at(last));
+        if (distance > maxDistance) {
+            maxDistance = distance;
+            index = i;
+        }
+    }
+
+    if (index != -1 && maxDistance > simplifyTolerance) {
+        keep[index] = true;
+        simplify(polygon, first, index, keep);
+        simplify(polygon, index, last, keep);
+    }
+}
+
+static QPolygonF simplified(const QPolygonF &polygon)
+{
+    if (polygon.size() <= 4)
+        return polygon;
+
+    // Treat the closed polygon as a chain from the first point back to itself
+    QPolygonF chain = polygon;
+    chain.append(polygon.first());
+
+    QVector<bool> keep(chain.size(), false);
+    keep[0] = true;
+    keep[chain.size() - 1] = true;
+
+    // Split the ring at its middle, since a chain ending where it starts
+    // has no line to measure against
+    const int middle = chain.size() / 2;
+    keep[middle] = true;
+    simplify(chain, 0, middle, keep);
+    simplify(chain, middle, chain.size() - 1, keep);
+
+    QPolygonF result;
+    for (int i = 0; i < chain.size() - 1; ++i)
+        if (keep.at(i))
+            result.append(chain.at(i));
+    return result;
+}
+
+QPolygonF CollisionCache::outline(const MapObject *object)
+{
+    QPolygonF polygon;
+    const QPointF pos = object->position();
+
+    switch (object->shape()) {
+    case MapObject::Rectangle: {
+        QRectF bounds = object->bounds();
+        // Tile objects are aligned to their bottom-left corner
+        if (!object->cell().isEmpty())
+            bounds.translate(0, -bounds.height());
+        polygon = QPolygonF(bounds);
+        polygon.removeLast();   // QPolygonF(QRectF) is closed explicitly
+        break;
+    }
+    case MapObject::Ellipse: {
+        const QRectF bounds = object->bounds();
+        const QPointF center = bounds.center();
+        for (int i = 0; i < ellipseSegments; ++i) {
+            const qreal angle = 2 * M_PI * i / ellipseSegments;
+            polygon.append(QPointF(center.x() + std::cos(angle) * bounds.width() / 2,
+                                   center.y() + std::sin(angle) * bounds.height() / 2));
+        }
+        break;
+    }
+    case MapObject::Polygon:
+        polygon = object->polygon().translated(pos);
+        break;
+    case MapObject::Polyline:
+        return polygon;
+    }
+
+    if (object->rotation() != 0) {
+        QTransform transform;
+        transform.translate(pos.x(), pos.y());
+        transform.rotate(object->rotation());
+        transform.translate(-pos.x(), -pos.y());
+        polygon = transform.map(polygon);
+    }
+
+    return polygon;
+}
+
+/**
+ * Applies the flipping flags encoded in \a flags to the \a mask. Like for the
+ * tiles themselves, the anti-diagonal flip is applied first.
+ */
+static quint64 transformedMask(quint64 mask, int flags)
+{
+    const int r = CollisionCache::Resolution;
+    quint64 result = 0;
+
+    for (int sy = 0; sy < r; ++sy) {
+        for (int sx = 0; sx < r; ++sx) {
+            if (!(mask & (Q_UINT64_C(1) << (sy * r + sx))))
+                continue;
+
+            int x = sx;
+            int y = sy;
+            if (flags & 4)
+                qSwap(x, y);
+            if (flags & 1)
+                x = r - 1 - x;
+            if (flags & 2)
+                y = r - 1 - y;
+
+            result |= Q_UINT64_C(1) << (y * r + x);
+        }
+    }
+
+    return result;
+}
+
+static int flipFlags(const Cell &cell)
+{
+    return (cell.flippedHorizontally ? 1 : 0)
+            | (cell.flippedVertically ? 2 : 0)
+            | (cell.flippedAntiDiagonally ? 4 : 0);
+}
+
+quint64 CollisionCache::cellMask(const Cell &cell)
+{
+    if (cell.isEmpty() || !cell.tile->objectGroup())
+        return 0;
+
+    return tileShape(cell.tile).masks[flipFlags(cell)];
+}
+
+quint64 CollisionCache::compiledCellMask(const Cell &cell) const
+{
+    if (cell.isEmpty() || !cell.tile->objectGroup())
+        return 0;
+
+    QHash<const Tileset*, QVector<TileShape> >::const_iterator it =
+            mTilesets.constFind(cell.tile->tileset());
+    if (it == mTilesets.constEnd())
+        return 0;
+
+    const QVector<TileShape> &shapes = it.value();
+    const int id = cell.tile->id();
+    if (id >= shapes.size() || !shapes.at(id).compiled)
+        return 0;
+
+    return shapes.at(id).masks[flipFlags(cell)];
+}
+
+void CollisionCache::compile(const Map *map)
+{
+    foreach (const Tileset *tileset, map->tilesets())
+        for (int i = 0; i < tileset->tileCount(); ++i)
+            if (const Tile *tile = tileset->tileAt(i))
+                if (tile->objectGroup())
+                    tileShape(tile);
+}
+
+const QVector<QPolygonF> &CollisionCache::polygons(const Tile *tile)
+{
+    return tileShape(tile).polygons;
+}
+
+QVector<quint64> CollisionCache::collisionMasks(const Map *map)
+{
+    const int mapWidth = map->width();
+    const int mapHeight = map->height();
+    QVector<quint64> masks(mapWidth * mapHeight, 0);
+
+    foreach (Layer *layer, map->layers()) {
+        const TileLayer *tileLayer = layer->asTileLayer();
+        if (!tileLayer)
+            continue;
+
+        const QRect area = tileLayer->bounds() & QRect(0, 0, mapWidth, mapHeight);
+
+        for (int y = area.top(); y <= area.bottom(); ++y) {
+            quint64 *row = masks.data() + y * mapWidth;
+
+            for (int x = area.left(); x <= area.right(); ++x) {
+                const Cell &cell = tileLayer->cellAt(x - tileLayer->x(),
+                                                     y - tileLayer->y());
+                if (cell.isEmpty() || !cell.tile->objectGroup())
+                    continue;
+
+                row[x] |= tileShape(cell.tile).masks[flipFlags(cell)];
+            }
+        }
+    }
+
+    return masks;
+}
+
+void CollisionCache::invalidate(const Tile *tile)
+{
+    QHash<const Tileset*, QVector<TileShape> >::iterator it =
+            mTilesets.find(tile->tileset());
+
+    if (it != mTilesets.end() && tile->id() < it->size())
+        (*it)[tile->id()].compiled = false;
+}
+
+void CollisionCache::invalidate(const Tileset *tileset)
+{
+    mTilesets.remove(tileset);
+}
+
+void CollisionCache::clear()
+{
+    mTilesets.clear();
+}
+
+CollisionCache::TileShape &CollisionCache::tileShape(const Tile *tile)
+{
+    QVector<TileShape> &shapes = mTilesets[tile->tileset()];
+    if (tile->id() >= shapes.size())
+        shapes.resize(qMax(tile->tileset()->tileCount(), tile->id() + 1));
+
+    TileShape &shape = shapes[tile->id()];
+
+    // The masks are relative to the size of the tile, which changes when
+    // its tileset is reloaded
+    if (!shape.compiled || shape.tileSize != tile->size())
+        compileShape(tile, shape);
+
+    return shape;
+}
+
+void CollisionCache::compileShape(const Tile *tile, TileShape &shape)
+{
+    shape.compiled = true;
+    shape.tileSize = tile->size();
+    shape.polygons.clear();
+
+    if (const ObjectGroup *objectGroup = tile->objectGroup()) {
+        foreach (const MapObject *object, objectGroup->objects()) {
+            const QPolygonF polygon = outline(object);
+            if (polygon.size() >= 3)
+                shape.polygons.append(simplified(polygon));
+        }
+    }
+
+    quint64 mask = 0;
+
+    if (!shape.polygons.isEmpty() && !shape.tileSize.isEmpty()) {
+        const qreal stepX = qreal(shape.tileSize.width()) / Resolution;
+        const qreal stepY = qreal(shape.tileSize.height()) / Resolution;
+
+        for (int y = 0; y < Resolution; ++y) {
+            for (int x = 0; x < Resolution; ++x) {
+                const QPointF center((x + 0.5) * stepX, (y + 0.5) * stepY);
+
+                foreach (const QPolygonF &polygon, shape.polygons) {
+                    if (polygon.containsPoint(center, Qt::OddEvenFill)) {
+                        mask |= Q_UINT64_C(1) << (y * Resolution + x);
+                        break;
+                    }
+                }
+            }
+        }
+    }
+
+    for (int flags = 0; flags < 8; ++flags)
+        shape.masks[flags] = transformedMask(mask, flags);
+}
@@ -0,0 +1,132 @@
+/*
+ * collisioncache.h
+ * Copyright 2015, Sydoria Games <luax@sydoria.fr>
+ *
+ * This file is part of libtiled.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *    1. Redistributions of source code must retain the above copyright notice,
+ *       this list of conditions and the following disclaimer.
+ *
+ *    2. Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE CONTRIBUTORS ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO
+ * EVENT SHALL THE CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#ifndef COLLISIONCACHE_H
+#define COLLISIONCACHE_H
+
+#include "tiled_global.h"
+
+#include <QHash>
+#include <QPolygonF>
+#include <QSize>
+#include <QVector>
+
+namespace Tiled {
+
+class Cell;
+class Map;
+class MapObject;
+class Tile;
+class Tileset;
+
+/**
+ * Caches the collision shapes of tiles in a compiled form, so that the
+ * collision data of a whole map can be queried without going through the
+ * object group of each tile again.
+ *
+ * For each tile, the shapes of its object group are compiled into a mask of
+ * Resolution x Resolution bits covering the cell of the tile, with a variant
+ * for each combination of flipping flags, and into a list of simplified
+ * polygons. Tiles are compiled when they are first queried. The owner of the
+ * cache needs to invalidate a tile when its object group changes, and a
+ * tileset when tiles are added to or removed from it.
+ */
+class TILEDSHARED_EXPORT CollisionCache
+{
+public:
+    /**
+     * The amount of mask bits along each side of a cell.
+     */
+    static const int Resolution = 8;
+
+    /**
+     * Returns the collision mask of the given \a cell, with its flipping
+     * flags applied. Bit <code>y * Resolution + x</code> is set when the
+     * center of the matching part of the cell lies inside a shape.
+     */
+    quint64 cellMask(const Cell &cell);
+
+    /**
+     * Returns the collision mask of the given \a cell like cellMask(), but
+     * only if its tile was already compiled, and 0 otherwise. Since it
+     * doesn't modify the cache, it may be called from multiple threads once
+     * the tiles have been compiled with compile().
+     */
+    quint64 compiledCellMask(const Cell &cell) const;
+
+    /**
+     * Compiles the collision shapes of all tiles of the \a map's tilesets
+     * that have any.
+     */
+    void compile(const Map *map);
+
+    /**
+     * Returns the collision shapes of the \a tile as closed polygons in
+     * pixel coordinates relative to the top-left of the tile. Ellipses are
+     * approximated and nearly collinear points are left out.
+     */
+    const QVector<QPolygonF> &polygons(const Tile *tile);
+
+    /**
+     * Returns the combined collision mask of each cell of the \a map,
+     * row by row. Each tile layer contributes the masks of its cells.
+     */
+    QVector<quint64> collisionMasks(const Map *map);
+
+    /**
+     * Returns the outline of the given \a object as a closed polygon in the
+     * coordinates of its object group, or an empty polygon when the object
+     * does not cover an area.
+     */
+    static QPolygonF outline(const MapObject *object);
+
+    void invalidate(const Tile *tile);
+    void invalidate(const Tileset *tileset);
+    void clear();
+
+private:
+    struct TileShape
+    {
+        TileShape() : compiled(false) {}
+
+        bool compiled;
+        QSize tileSize;
+        quint64 masks[8];
+        QVector<QPolygonF> polygons;
+    };
+
+    TileShape &tileShape(const Tile *tile);
+    static void compileShape(const Tile *tile, TileShape &shape);
+
+    QHash<const Tileset*, QVector<TileShape> > mTilesets;
+};
+
+} // namespace Tiled
+
+#endif // COLLISIONCACHE_H
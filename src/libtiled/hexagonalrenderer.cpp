@@ -34,7 +34,6 @@
 #include "tilelayer.h"
 #include "tileset.h"
 
-#include <QVector2D>
 #include <QtCore/qmath.h>
 
 #include <limits>
@@ -92,7 +91,7 @@ QRect HexagonalRenderer::boundingRect(const QRect &rect) const
 {
     const RenderParams p(map());
 
-    QPoint topLeft = tileToScreenCoords(rect.topLeft()).toPoint();
+    QPoint topLeft = p.tileToScreen(rect.x(), rect.y());
     int width, height;
 
     if (p.staggerX) {
@@ -147,7 +146,7 @@ void HexagonalRenderer::drawGrid(QPainter *painter, const QRectF &exposed,
     startTile.setX(qMax(0, startTile.x()));
     startTile.setY(qMax(0, startTile.y()));
 
-    startPos = tileToScreenCoords(startTile).toPoint();
+    startPos = p.tileToScreen(startTile.x(), startTile.y());
 
     const QPoint oct[8] = {
         QPoint(0,                           p.tileHeight - p.sideOffsetY),
@@ -275,7 +274,8 @@ void HexagonalRenderer::drawTileLayer(QPainter *painter,
     // Compensate for the layer position
     startTile -= layer->position();
 
-    QPoint startPos = tileToScreenCoords(startTile + layer->position()).toPoint();
+    QPoint startPos = p.tileToScreen(startTile.x() + layer->x(),
+                                     startTile.y() + layer->y());
 
     /* Determine in which half of the tile the top-left corner of the area we
      * need to draw is. If we're in the upper half, we need to start one row
@@ -296,7 +296,8 @@ void HexagonalRenderer::drawTileLayer(QPainter *painter,
         startTile.setX(qMax(-1, startTile.x()));
         startTile.setY(qMax(-1, startTile.y()));
 
-        startPos = tileToScreenCoords(startTile + layer->position()).toPoint();
+        startPos = p.tileToScreen(startTile.x() + layer->x(),
+                                  startTile.y() + layer->y());
         startPos.ry() += p.tileHeight;
 
         bool staggeredRow = p.doStaggerX(startTile.x() + layer->x());
@@ -333,7 +334,8 @@ void HexagonalRenderer::drawTileLayer(QPainter *painter,
         startTile.setX(qMax(0, startTile.x()));
         startTile.setY(qMax(0, startTile.y()));
 
-        startPos = tileToScreenCoords(startTile + layer->position()).toPoint();
+        startPos = p.tileToScreen(startTile.x() + layer->x(),
+                                  startTile.y() + layer->y());
         startPos.ry() += p.tileHeight;
 
         // Odd row shifting is applied in the rendering loop, so un-apply it here
@@ -369,12 +371,24 @@ void HexagonalRenderer::drawTileSelection(QPainter *painter,
     painter->setBrush(color);
     painter->setPen(Qt::NoPen);
 
+    const RenderParams p(map());
+    const QPolygonF hexagon = tileToScreenPolygon(p, QPoint());
+    const QSize tileSize(p.tileWidth, p.tileHeight);
+
+    // Reused for each tile to avoid allocating a polygon per tile
+    QPolygonF polygon(hexagon);
+
     foreach (const QRect &r, region.rects()) {
         for (int y = r.top(); y <= r.bottom(); ++y) {
             for (int x = r.left(); x <= r.right(); ++x) {
-                const QPolygonF polygon = tileToScreenPolygon(x, y);
-                if (QRectF(polygon.boundingRect()).intersects(exposed))
-                    painter->drawConvexPolygon(polygon);
+                const QPoint topLeft = p.tileToScreen(x, y);
+                if (!exposed.intersects(QRectF(QRect(topLeft, tileSize))))
+                    continue;
+
+                for (int i = 0; i < 8; ++i)
+                    polygon[i] = hexagon.at(i) + topLeft;
+
+                painter->drawConvexPolygon(polygon);
             }
         }
     }
@@ -395,9 +409,28 @@ QPointF HexagonalRenderer::pixelToTileCoords(qreal x, qreal y) const
  * supported by this renderer.
  */
 QPointF HexagonalRenderer::screenToTileCoords(qreal x, qreal y) const
+{
+    return screenToTile(RenderParams(map()), x, y);
+}
+
+QPolygonF HexagonalRenderer::screenToTileCoords(const QPolygonF &points) const
 {
     const RenderParams p(map());
+    const int count = points.size();
+
+    QPolygonF tiles(count);
+    const QPointF *src = points.constData();
+    QPointF *dst = tiles.data();
 
+    for (int i = 0; i < count; ++i)
+        dst[i] = screenToTile(p, src[i].x(), src[i].y());
+
+    return tiles;
+}
+
+QPoint HexagonalRenderer::screenToTile(const RenderParams &p,
+                                       qreal x, qreal y) const
+{
     if (p.staggerX)
         x -= p.staggerEven ? p.tileWidth : p.sideOffsetX;
     else
@@ -408,8 +441,8 @@ QPointF HexagonalRenderer::screenToTileCoords(qreal x, qreal y) const
                                    qFloor(y / (p.tileHeight + p.sideLengthY)));
 
     // Relative x and y position on the base square of the grid-aligned tile
-    const QVector2D rel(x - referencePoint.x() * (p.tileWidth + p.sideLengthX),
-                        y - referencePoint.y() * (p.tileHeight + p.sideLengthY));
+    const qreal relX = x - referencePoint.x() * (p.tileWidth + p.sideLengthX);
+    const qreal relY = y - referencePoint.y() * (p.tileHeight + p.sideLengthY);
 
     // Adjust the reference point to the correct tile coordinates
     int &staggerAxisIndex = p.staggerX ? referencePoint.rx() : referencePoint.ry();
@@ -418,34 +451,36 @@ QPointF HexagonalRenderer::screenToTileCoords(qreal x, qreal y) const
         ++staggerAxisIndex;
 
     // Determine the nearest hexagon tile by the distance to the center
-    QVector2D centers[4];
+    int centersX[4];
+    int centersY[4];
 
     if (p.staggerX) {
         const int left = p.sideLengthX / 2;
         const int centerX = left + p.columnWidth;
         const int centerY = p.tileHeight / 2;
 
-        centers[0] = QVector2D(left,                    centerY);
-        centers[1] = QVector2D(centerX,                 centerY - p.rowHeight);
-        centers[2] = QVector2D(centerX,                 centerY + p.rowHeight);
-        centers[3] = QVector2D(centerX + p.columnWidth, centerY);
+        centersX[0] = left;                     centersY[0] = centerY;
+        centersX[1] = centerX;                  centersY[1] = centerY - p.rowHeight;
+        centersX[2] = centerX;                  centersY[2] = centerY + p.rowHeight;
+        centersX[3] = centerX + p.columnWidth;  centersY[3] = centerY;
     } else {
         const int top = p.sideLengthY / 2;
         const int centerX = p.tileWidth / 2;
         const int centerY = top + p.rowHeight;
 
-        centers[0] = QVector2D(centerX,                 top);
-        centers[1] = QVector2D(centerX - p.columnWidth, centerY);
-        centers[2] = QVector2D(centerX + p.columnWidth, centerY);
-        centers[3] = QVector2D(centerX,                 centerY + p.rowHeight);
+        centersX[0] = centerX;                  centersY[0] = top;
+        centersX[1] = centerX - p.columnWidth;  centersY[1] = centerY;
+        centersX[2] = centerX + p.columnWidth;  centersY[2] = centerY;
+        centersX[3] = centerX;                  centersY[3] = centerY + p.rowHeight;
     }
 
     int nearest = 0;
     qreal minDist = std::numeric_limits<qreal>::max();
 
     for (int i = 0; i < 4; ++i) {
-        const QVector2D &center = centers[i];
-        const qreal dc = (center - rel).lengthSquared();
+        const qreal dx = centersX[i] - relX;
+        const qreal dy = centersY[i] - relY;
+        const qreal dc = dx * dx + dy * dy;
         if (dc < minDist) {
             minDist = dc;
             nearest = i;
@@ -476,25 +511,22 @@ QPointF HexagonalRenderer::screenToTileCoords(qreal x, qreal y) const
 QPointF HexagonalRenderer::tileToScreenCoords(qreal x, qreal y) const
 {
     const RenderParams p(map());
-    const int tileX = qFloor(x);
-    const int tileY = qFloor(y);
-    int pixelX, pixelY;
+    return p.tileToScreen(qFloor(x), qFloor(y));
+}
 
-    if (p.staggerX) {
-        pixelY = tileY * (p.tileHeight + p.sideLengthY);
-        if (p.doStaggerX(tileX))
-            pixelY += p.rowHeight;
+QPolygonF HexagonalRenderer::tileToScreenCoords(const QPolygonF &tiles) const
+{
+    const RenderParams p(map());
+    const int count = tiles.size();
 
-        pixelX = tileX * p.columnWidth;
-    } else {
-        pixelX = tileX * (p.tileWidth + p.sideLengthX);
-        if (p.doStaggerY(tileY))
-            pixelX += p.columnWidth;
+    QPolygonF points(count);
+    const QPointF *src = tiles.constData();
+    QPointF *dst = points.data();
 
-        pixelY = tileY * p.rowHeight;
-    }
+    for (int i = 0; i < count; ++i)
+        dst[i] = p.tileToScreen(qFloor(src[i].x()), qFloor(src[i].y()));
 
-    return QPointF(pixelX, pixelY);
+    return points;
 }
 
 QPoint HexagonalRenderer::topLeft(int x, int y) const
@@ -560,8 +592,12 @@ QPoint HexagonalRenderer::bottomRight(int x, int y) const
 QPolygonF HexagonalRenderer::tileToScreenPolygon(int x, int y) const
 {
     const RenderParams p(map());
-    const QPointF topRight = tileToScreenCoords(x, y);
+    return tileToScreenPolygon(p, p.tileToScreen(x, y));
+}
 
+QPolygonF HexagonalRenderer::tileToScreenPolygon(const RenderParams &p,
+                                                 const QPoint &topRight)
+{
     QPolygonF polygon(8);
     polygon[0] = topRight + QPoint(0,                           p.tileHeight - p.sideOffsetY);
     polygon[1] = topRight + QPoint(0,                           p.sideOffsetY);
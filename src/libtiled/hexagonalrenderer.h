@@ -68,6 +68,23 @@ protected:
         bool doStaggerY(int y) const
         { return !staggerX && (y & 1) ^ staggerEven; }
 
+        /**
+         * Returns the screen position of the tile at (\a x, \a y). Unlike
+         * HexagonalRenderer::tileToScreenCoords, this only does integer
+         * math and doesn't look up the map parameters again.
+         */
+        QPoint tileToScreen(int x, int y) const
+        {
+            if (staggerX)
+                return QPoint(x * columnWidth,
+                              y * (tileHeight + sideLengthY)
+                              + (doStaggerX(x) ? rowHeight : 0));
+            else
+                return QPoint(x * (tileWidth + sideLengthX)
+                              + (doStaggerY(y) ? columnWidth : 0),
+                              y * rowHeight);
+        }
+
         const int tileWidth;
         const int tileHeight;
         int sideLengthX;
@@ -106,9 +123,11 @@ public:
 
     using OrthogonalRenderer::screenToTileCoords;
     QPointF screenToTileCoords(qreal x, qreal y) const;
+    QPolygonF screenToTileCoords(const QPolygonF &points) const;
 
     using OrthogonalRenderer::tileToScreenCoords;
     QPointF tileToScreenCoords(qreal x, qreal y) const;
+    QPolygonF tileToScreenCoords(const QPolygonF &tiles) const;
 
     // Functions specific to this type of renderer
     QPoint topLeft(int x, int y) const;
@@ -117,6 +136,11 @@ public:
     QPoint bottomRight(int x, int y) const;
 
     QPolygonF tileToScreenPolygon(int x, int y) const;
+
+private:
+    QPoint screenToTile(const RenderParams &p, qreal x, qreal y) const;
+    static QPolygonF tileToScreenPolygon(const RenderParams &p,
+                                         const QPoint &topRight);
 };
 
 } // namespace Tiled
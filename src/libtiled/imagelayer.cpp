@@ -30,8 +30,6 @@
 #include "imagelayer.h"
 #include "map.h"
 
-#include <QBitmap>
-
 using namespace Tiled;
 
 ImageLayer::ImageLayer(const QString &name, int x, int y, int width, int height):
@@ -43,29 +41,39 @@ ImageLayer::~ImageLayer()
 {
 }
 
+const QPixmap &ImageLayer::image() const
+{
+    if (mPixmap.isNull() && !mImage.isNull())
+        mPixmap = QPixmap::fromImage(mImage.toImage());
+
+    return mPixmap;
+}
+
+void ImageLayer::setImage(const QPixmap &image)
+{
+    mImage.load(image.toImage());
+    mPixmap = QPixmap();
+}
+
 void ImageLayer::resetImage()
 {
-    mImage = QPixmap();
+    mImage.clear();
+    mPixmap = QPixmap();
     mImageSource.clear();
 }
 
 bool ImageLayer::loadFromImage(const QImage &image, const QString &fileName)
 {
     mImageSource = fileName;
+    mPixmap = QPixmap();
+    return mImage.load(image, mTransparentColor);
+}
 
-    if (image.isNull()) {
-        mImage = QPixmap();
-        return false;
-    }
-
-    mImage = QPixmap::fromImage(image);
-
-    if (mTransparentColor.isValid()) {
-        const QImage mask = image.createMaskFromColor(mTransparentColor.rgb());
-        mImage.setMask(QBitmap::fromImage(mask));
-    }
-
-    return true;
+bool ImageLayer::loadFromFile(const QString &fileName)
+{
+    mImageSource = fileName;
+    mPixmap = QPixmap();
+    return mImage.load(fileName, mTransparentColor);
 }
 
 bool ImageLayer::isEmpty() const
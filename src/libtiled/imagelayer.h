@@ -32,6 +32,7 @@
 
 #include "tiled_global.h"
 
+#include "imagepyramid.h"
 #include "layer.h"
 #include "tileset.h"
 
@@ -88,14 +89,26 @@ public:
     const QString &imageSource() const { return mImageSource; }
 
     /**
-      * Returns the image of this layer.
+      * Returns the image of this layer. The full resolution pixmap is only
+      * created on first use and kept until the image changes, so prefer
+      * imagePyramid() or imageSize() where possible.
       */
-    const QPixmap &image() const { return mImage; }
+    const QPixmap &image() const;
 
     /**
       * Sets the image of this layer.
       */
-    void setImage(const QPixmap &image) { mImage = image; }
+    void setImage(const QPixmap &image);
+
+    /**
+     * Returns the image of this layer as a tiled pyramid, for drawing.
+     */
+    const ImagePyramid &imagePyramid() const { return mImage; }
+
+    /**
+     * Returns the size of the image of this layer.
+     */
+    QSize imageSize() const { return mImage.size(); }
 
     /**
      * Resets layer image.
@@ -115,6 +128,16 @@ public:
      */
     bool loadFromImage(const QImage &image, const QString &fileName);
 
+    /**
+     * Load this layer from the image file \a fileName, which becomes the new
+     * imageSource. Unlike loadFromImage(), this allows the image to be
+     * decoded in parts.
+     *
+     * @return <code>true</code> if loading was successful, otherwise
+     *         returns <code>false</code>
+     */
+    bool loadFromFile(const QString &fileName);
+
     /**
      * Returns true if no image source has been set.
      */
@@ -130,7 +153,8 @@ protected:
 private:
     QString mImageSource;
     QColor mTransparentColor;
-    QPixmap mImage;
+    ImagePyramid mImage;
+    mutable QPixmap mPixmap;
 };
 
 } // namespace Tiled
@@ -0,0 +1,668 @@
+/*
+ * imagepyramid.cpp
+ * Copyright 2015, Sydoria Games <luax@sydoria.fr>
+ *
+ * This file is part of libtiled.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *    1. Redistributions of source code must retain the above copyright notice,
+ *       this list of conditions and the following disclaimer.
+ *
+ *    2. Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE CONTRIBUTORS ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO
+ * EVENT SHALL THE CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "imagepyramid.h"
+
+#include <QCache>
+#include <QCoreApplication>
+#include <QImageReader>
+#include <QMutex>
+#include <QPainter>
+#include <QPixmap>
+#include <QRunnable>
+#include <QSet>
+#include <QThreadPool>
+
+#include <cmath>
+
+namespace Tiled {
+
+/**
+ * The image a pyramid is made of. This is either an image, or the name of an
+ * image file. Files of which parts can be decoded on their own are never
+ * decoded as a whole, the others are decoded when the image is first needed.
+ */
+class ImagePyramidSource
+{
+public:
+    ImagePyramidSource();
+    ~ImagePyramidSource();
+
+    /**
+     * Returns the full image as it was decoded, without the transparent
+     * color applied. May be called from any thread.
+     */
+    QImage decodedImage() const;
+
+    int id;
+    QSize size;
+    int levelCount;
+    QString fileName;
+    bool readsParts;
+    QColor transparentColor;
+
+private:
+    mutable QMutex mMutex;
+    mutable QImage mImage;
+    mutable bool mDecoded;
+
+    friend class ImagePyramid;
+};
+
+} // namespace Tiled
+
+using namespace Tiled;
+
+/**
+ * The size of the tiles at each level, in pixels.
+ */
+static const int tileSize = 512;
+
+/**
+ * The amount of memory the cached tiles of all pyramids may take, in
+ * kilobytes.
+ */
+static const int tileCacheLimit = 128 * 1024;
+
+namespace {
+
+struct TileKey
+{
+    TileKey(int source, int level, int column, int row)
+        : source(source)
+        , level(level)
+        , column(column)
+        , row(row)
+    {}
+
+    bool operator==(const TileKey &other) const
+    {
+        return source == other.source && level == other.level &&
+                column == other.column && row == other.row;
+    }
+
+    int source;
+    int level;
+    int column;
+    int row;
+};
+
+inline uint qHash(const TileKey &key)
+{
+    return (uint(key.source) * 31) ^ (uint(key.level) << 24) ^
+            (uint(key.row) << 12) ^ uint(key.column);
+}
+
+/**
+ * A tile that was produced in the background. It holds on to its source,
+ * so that the source is only ever released on the GUI thread.
+ */
+struct DecodedTile
+{
+    TileKey key;
+    QImage image;
+    QSharedPointer<const ImagePyramidSource> source;
+};
+
+} // anonymous namespace
+
+typedef QCache<TileKey, QPixmap> TileCache;
+
+static TileCache *tileCache = 0;
+static QAtomicInt nextSourceId(1);
+
+static QThreadPool *decodePool = 0;
+static ImagePyramidNotifier *notifier = 0;
+
+// Only used on the GUI thread
+static QSet<TileKey> pendingTiles;
+
+static QMutex decodedTilesMutex;
+static QList<DecodedTile> decodedTiles;
+
+/**
+ * Stops the background jobs and deletes the tile cache along with the
+ * application, since pixmaps can't outlive it.
+ */
+static void deleteTileCache()
+{
+    if (decodePool) {
+        decodePool->waitForDone();
+        delete decodePool;
+        decodePool = 0;
+    }
+
+    // Releases the sources, which still refer to the cache
+    decodedTiles.clear();
+    pendingTiles.clear();
+
+    delete notifier;
+    notifier = 0;
+
+    delete tileCache;
+    tileCache = 0;
+}
+
+static TileCache *ensureTileCache()
+{
+    if (!tileCache) {
+        tileCache = new TileCache(tileCacheLimit);
+        qAddPostRoutine(deleteTileCache);
+    }
+    return tileCache;
+}
+
+static QSize levelSize(const QSize &size, int level)
+{
+    const int factor = 1 << level;
+    return QSize((size.width() + factor - 1) / factor,
+                 (size.height() + factor - 1) / factor);
+}
+
+/**
+ * Returns the amount of levels for an image of the given \a size. Halving
+ * stops once a level fits in a single tile.
+ */
+static int levelCount(const QSize &size)
+{
+    int count = 1;
+    while (levelSize(size, count - 1).width() > tileSize ||
+           levelSize(size, count - 1).height() > tileSize)
+        ++count;
+    return count;
+}
+
+static int tileCount(int length)
+{
+    return (length + tileSize - 1) / tileSize;
+}
+
+static QRect tileRect(const QSize &levelSize, int column, int row)
+{
+    return QRect(column * tileSize, row * tileSize, tileSize, tileSize)
+            & QRect(QPoint(), levelSize);
+}
+
+static void applyTransparentColor(QImage &image, const QColor &color)
+{
+    if (!color.isValid() || image.isNull())
+        return;
+
+    image = image.convertToFormat(QImage::Format_ARGB32);
+
+    const QRgb rgb = color.rgb();
+    for (int y = 0; y < image.height(); ++y) {
+        QRgb *line = reinterpret_cast<QRgb*>(image.scanLine(y));
+        for (int x = 0; x < image.width(); ++x)
+            if (line[x] == rgb)
+                line[x] = 0;
+    }
+}
+
+/**
+ * Produces the tile at \a column and \a row of the given \a level, from the
+ * part of the full resolution image it covers.
+ */
+static QImage produceTile(const ImagePyramidSource &source,
+                          int level, int column, int row)
+{
+    const int factor = 1 << level;
+    const QRect target = tileRect(levelSize(source.size, level), column, row);
+    const QRect rect = QRect(target.topLeft() * factor,
+                             target.size() * factor)
+            & QRect(QPoint(), source.size);
+
+    QImage tile;
+    bool sharesSource = false;
+
+    if (source.readsParts) {
+        QImageReader reader(source.fileName);
+        reader.setClipRect(rect);
+
+        // Scaling has to wait for the transparent color to be applied
+        if (level > 0 && !source.transparentColor.isValid())
+            reader.setScaledSize(target.size());
+
+        tile = reader.read();
+    } else {
+        const QImage image = source.decodedImage();
+        if (image.isNull())
+            return image;
+
+        if (image.depth() == 32) {
+            // Refer to the covered part of the image rather than copying it
+            const uchar *bits = image.constBits()
+                    + rect.top() * image.bytesPerLine()
+                    + rect.left() * 4;
+
+            tile = QImage(bits, rect.width(), rect.height(),
+                          image.bytesPerLine(), image.format());
+            sharesSource = true;
+        } else {
+            tile = image.copy(rect);
+        }
+    }
+
+    if (tile.isNull())
+        return tile;
+
+    if (source.transparentColor.isValid()) {
+        applyTransparentColor(tile, source.transparentColor);
+        sharesSource = false;
+    }
+
+    if (tile.size() != target.size()) {
+        tile = tile.scaled(target.size(),
+                           Qt::IgnoreAspectRatio,
+                           Qt::SmoothTransformation);
+    } else if (sharesSource) {
+        tile = tile.copy();
+    }
+
+    return tile.convertToFormat(QImage::Format_ARGB32_Premultiplied);
+}
+
+static QPixmap insertTile(const TileKey &key, const QImage &image)
+{
+    // Failed tiles are cached as well, so they are not produced again and
+    // again. Pixmaps may only be created on the GUI thread.
+    const QPixmap pixmap = QPixmap::fromImage(image);
+    const int cost = qMax(1, image.byteCount() / 1024);
+    ensureTileCache()->insert(key, new QPixmap(pixmap), cost);
+    return pixmap;
+}
+
+/**
+ * Runs the given jobs on a thread pool of their own and waits until they
+ * are done.
+ */
+static void runJobs(const QList<QRunnable*> &jobs)
+{
+    QThreadPool threadPool;
+    foreach (QRunnable *job, jobs)
+        threadPool.start(job);
+    threadPool.waitForDone();
+}
+
+namespace {
+
+/**
+ * Produces a single tile. The source is only read, so any amount of these
+ * jobs can run in parallel.
+ */
+class TileJob : public QRunnable
+{
+public:
+    TileJob(const ImagePyramidSource *source,
+            int level, int column, int row,
+            QImage *tile)
+        : mSource(source)
+        , mLevel(level)
+        , mColumn(column)
+        , mRow(row)
+        , mTile(tile)
+    {}
+
+    void run()
+    {
+        *mTile = produceTile(*mSource, mLevel, mColumn, mRow);
+    }
+
+private:
+    const ImagePyramidSource *mSource;
+    int mLevel;
+    int mColumn;
+    int mRow;
+    QImage *mTile;
+};
+
+/**
+ * Produces a single tile in the background and hands it to the notifier,
+ * which adds it to the cache on the GUI thread.
+ */
+class BackgroundTileJob : public QRunnable
+{
+public:
+    BackgroundTileJob(const QSharedPointer<const ImagePyramidSource> &source,
+                      const TileKey &key)
+        : mSource(source)
+        , mKey(key)
+    {}
+
+    void run()
+    {
+        DecodedTile decoded = {
+            mKey,
+            produceTile(*mSource, mKey.level, mKey.column, mKey.row),
+            mSource
+        };
+
+        QMutexLocker locker(&decodedTilesMutex);
+        const bool first = decodedTiles.isEmpty();
+        decodedTiles.append(decoded);
+        decoded.source.clear();
+        mSource.clear();
+        locker.unlock();
+
+        if (first)
+            QMetaObject::invokeMethod(notifier, "insertDecodedTiles",
+                                      Qt::QueuedConnection);
+    }
+
+private:
+    QSharedPointer<const ImagePyramidSource> mSource;
+    TileKey mKey;
+};
+
+} // anonymous namespace
+
+/**
+ * Starts producing the tile with the given \a key in the background, unless
+ * that is already happening.
+ */
+static void requestTile(const QSharedPointer<const ImagePyramidSource> &source,
+                        const TileKey &key)
+{
+    if (pendingTiles.contains(key))
+        return;
+
+    ImagePyramidNotifier::instance();
+    if (!decodePool)
+        decodePool = new QThreadPool;
+
+    pendingTiles.insert(key);
+    decodePool->start(new BackgroundTileJob(source, key));
+}
+
+/**
+ * Draws the part of a cached coarser tile that covers the tile at the given
+ * \a level, \a column and \a row. Returns whether such a tile was cached.
+ */
+static bool drawCoarserTile(QPainter *painter,
+                            const QPointF &position,
+                            const ImagePyramidSource &source,
+                            int level, int column, int row)
+{
+    const QRect target = tileRect(levelSize(source.size, level), column, row);
+    const qreal factor = 1 << level;
+
+    for (int coarser = level + 1; coarser < source.levelCount; ++coarser) {
+        const int shift = coarser - level;
+        const TileKey key(source.id, coarser, column >> shift, row >> shift);
+        const QPixmap *tile = tileCache->object(key);
+        if (!tile || tile->isNull())
+            continue;
+
+        const qreal scale = 1 << shift;
+        const QRectF sourceRect(target.x() / scale - key.column * tileSize,
+                                target.y() / scale - key.row * tileSize,
+                                target.width() / scale,
+                                target.height() / scale);
+        const QRectF targetRect(position.x() + target.x() * factor,
+                                position.y() + target.y() * factor,
+                                target.width() * factor,
+                                target.height() * factor);
+
+        painter->drawPixmap(targetRect, *tile, sourceRect);
+        return true;
+    }
+
+    return false;
+}
+
+ImagePyramidSource::ImagePyramidSource()
+    : id(nextSourceId.fetchAndAddRelaxed(1))
+    , levelCount(0)
+    , readsParts(false)
+    , mDecoded(false)
+{
+}
+
+ImagePyramidSource::~ImagePyramidSource()
+{
+    // The cached tiles can't be drawn by any other pyramid
+    if (!tileCache)
+        return;
+
+    foreach (const TileKey &key, tileCache->keys())
+        if (key.source == id)
+            tileCache->remove(key);
+}
+
+QImage ImagePyramidSource::decodedImage() const
+{
+    QMutexLocker locker(&mMutex);
+    if (!mDecoded) {
+        mImage = QImageReader(fileName).read();
+        mDecoded = true;
+    }
+    return mImage;
+}
+
+ImagePyramid::ImagePyramid()
+{
+}
+
+bool ImagePyramid::load(const QImage &image, const QColor &transparentColor)
+{
+    clear();
+
+    if (image.isNull())
+        return false;
+
+    // The image is shared rather than converted, the tiles are converted
+    // when they are produced
+    ImagePyramidSource *source = new ImagePyramidSource;
+    source->size = image.size();
+    source->levelCount = levelCount(source->size);
+    source->transparentColor = transparentColor;
+    source->mImage = image;
+    source->mDecoded = true;
+
+    mSource = QSharedPointer<const ImagePyramidSource>(source);
+    return true;
+}
+
+bool ImagePyramid::load(const QString &fileName,
+                        const QColor &transparentColor)
+{
+    clear();
+
+    QImageReader reader(fileName);
+    const QSize size = reader.size();
+
+    // Some formats only know their size once decoded
+    if (!size.isValid())
+        return load(reader.read(), transparentColor);
+
+    ImagePyramidSource *source = new ImagePyramidSource;
+    source->size = size;
+    source->levelCount = levelCount(size);
+    source->fileName = fileName;
+    source->readsParts = reader.supportsOption(QImageIOHandler::ClipRect);
+    source->transparentColor = transparentColor;
+
+    mSource = QSharedPointer<const ImagePyramidSource>(source);
+    return true;
+}
+
+void ImagePyramid::clear()
+{
+    mSource.clear();
+}
+
+QSize ImagePyramid::size() const
+{
+    return mSource.isNull() ? QSize() : mSource->size;
+}
+
+QImage ImagePyramid::toImage() const
+{
+    if (isNull())
+        return QImage();
+
+    QImage image = mSource->readsParts ? QImageReader(mSource->fileName).read()
+                                       : mSource->decodedImage();
+    applyTransparentColor(image, mSource->transparentColor);
+    return image;
+}
+
+bool ImagePyramid::draw(QPainter *painter,
+                        const QPointF &position,
+                        const QRectF &exposed,
+                        DrawMode mode) const
+{
+    if (isNull())
+        return true;
+
+    const ImagePyramidSource &source = *mSource;
+
+    // Pick the smallest level that still has at least one pixel per
+    // device pixel
+    const QTransform &transform = painter->transform();
+    const qreal scale = std::sqrt(transform.m11() * transform.m11() +
+                                  transform.m12() * transform.m12());
+
+    int level = 0;
+    while (level + 1 < source.levelCount && scale <= 0.5 / (1 << level))
+        ++level;
+
+    const QSize size = levelSize(source.size, level);
+    const int factor = 1 << level;
+    const qreal levelTileSize = tileSize * factor;
+
+    int startColumn = 0;
+    int startRow = 0;
+    int endColumn = tileCount(size.width()) - 1;
+    int endRow = tileCount(size.height()) - 1;
+
+    if (!exposed.isNull()) {
+        const QRectF rect = exposed.translated(-position);
+        startColumn = qMax(startColumn, int(std::floor(rect.left() / levelTileSize)));
+        startRow = qMax(startRow, int(std::floor(rect.top() / levelTileSize)));
+        endColumn = qMin(endColumn, int(std::floor(rect.right() / levelTileSize)));
+        endRow = qMin(endRow, int(std::floor(rect.bottom() / levelTileSize)));
+    }
+
+    const int columns = endColumn - startColumn + 1;
+    const int rows = endRow - startRow + 1;
+    if (columns <= 0 || rows <= 0)
+        return true;
+
+    // Look up the exposed tiles. The missing ones are either produced in
+    // parallel right away, or requested in the background.
+    TileCache *cache = ensureTileCache();
+    QVector<QPixmap> pixmaps(columns * rows);
+    QVector<bool> cached(columns * rows, false);
+    QVector<QImage> images(columns * rows);
+    QList<QRunnable*> jobs;
+    bool complete = true;
+
+    for (int row = startRow; row <= endRow; ++row) {
+        for (int column = startColumn; column <= endColumn; ++column) {
+            const int index = (row - startRow) * columns + column - startColumn;
+            const TileKey key(source.id, level, column, row);
+
+            if (const QPixmap *pixmap = cache->object(key)) {
+                pixmaps[index] = *pixmap;
+                cached[index] = true;
+            } else if (mode == WaitForTiles) {
+                jobs.append(new TileJob(&source, level, column, row,
+                                        images.data() + index));
+            } else {
+                complete = false;
+            }
+        }
+    }
+
+    runJobs(jobs);
+
+    for (int row = startRow; row <= endRow; ++row) {
+        for (int column = startColumn; column <= endColumn; ++column) {
+            const int index = (row - startRow) * columns + column - startColumn;
+
+            if (mode == WaitForTiles && !cached.at(index)) {
+                pixmaps[index] = insertTile(TileKey(source.id, level, column, row),
+                                            images.at(index));
+            } else if (!cached.at(index)) {
+                // Meanwhile, fill in from a coarser level. When there is
+                // none yet, the coarsest level is requested first since it
+                // covers the whole image in a single tile.
+                if (!drawCoarserTile(painter, position, source,
+                                     level, column, row)) {
+                    const int top = source.levelCount - 1;
+                    if (!cache->contains(TileKey(source.id, top, 0, 0)))
+                        requestTile(mSource, TileKey(source.id, top, 0, 0));
+                }
+                requestTile(mSource, TileKey(source.id, level, column, row));
+                continue;
+            }
+
+            const QPixmap &tile = pixmaps.at(index);
+            if (tile.isNull())
+                continue;
+
+            const QRectF target(position.x() + column * levelTileSize,
+                                position.y() + row * levelTileSize,
+                                tile.width() * factor,
+                                tile.height() * factor);
+
+            painter->drawPixmap(target, tile, QRectF(tile.rect()));
+        }
+    }
+
+    return complete;
+}
+
+ImagePyramidNotifier *ImagePyramidNotifier::instance()
+{
+    if (!notifier) {
+        ensureTileCache();
+        notifier = new ImagePyramidNotifier;
+    }
+    return notifier;
+}
+
+ImagePyramidNotifier::ImagePyramidNotifier()
+{
+}
+
+void ImagePyramidNotifier::insertDecodedTiles()
+{
+    QMutexLocker locker(&decodedTilesMutex);
+    QList<DecodedTile> tiles;
+    tiles.swap(decodedTiles);
+    locker.unlock();
+
+    foreach (const DecodedTile &tile, tiles) {
+        pendingTiles.remove(tile.key);
+        insertTile(tile.key, tile.image);
+    }
+
+    emit tilesDecoded();
+}
@@ -0,0 +1,159 @@
+/*
+ * imagepyramid.h
+ * Copyright 2015, Sydoria Games <luax@sydoria.fr>
+ *
+ * This file is part of libtiled.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *    1. Redistributions of source code must retain the above copyright notice,
+ *       this list of conditions and the following disclaimer.
+ *
+ *    2. Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE CONTRIBUTORS ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO
+ * EVENT SHALL THE CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef IMAGEPYRAMID_H
+#define IMAGEPYRAMID_H
+
+#include "tiled_global.h"
+
+#include <QColor>
+#include <QImage>
+#include <QObject>
+#include <QSharedPointer>
+#include <QSize>
+
+class QPainter;
+
+namespace Tiled {
+
+class ImagePyramidSource;
+
+/**
+ * An image that is drawn as a grid of tiles, along with mip levels of half
+ * the size each. This allows large images to be drawn by only drawing the
+ * tiles within the exposed area, from the level matching the scale of the
+ * painter, rather than scaling the whole image.
+ *
+ * Tiles are only produced when they are first drawn, and are kept as pixmaps
+ * in a cache of limited size that is shared by all pyramids. Tiles that were
+ * not drawn for a while are evicted from it and produced again when needed.
+ * Since pixmaps are involved, drawing needs to happen on the GUI thread.
+ *
+ * Copies of a pyramid share its source image and its cached tiles.
+ */
+class TILEDSHARED_EXPORT ImagePyramid
+{
+public:
+    enum DrawMode {
+        /**
+         * Produces the missing tiles before drawing, so that the whole
+         * exposed area is drawn at once.
+         */
+        WaitForTiles,
+
+        /**
+         * Only draws the tiles that are available. The missing ones are
+         * produced in the background, and a coarser level is drawn in their
+         * place when available. ImagePyramidNotifier tells when they are
+         * done.
+         */
+        DrawAvailableTiles
+    };
+
+    ImagePyramid();
+
+    /**
+     * Sets the image of the pyramid to the given \a image. Pixels with the
+     * given \a transparentColor, when valid, are made transparent.
+     *
+     * @return <code>true</code> if the image was not null
+     */
+    bool load(const QImage &image,
+              const QColor &transparentColor = QColor());
+
+    /**
+     * Sets the image of the pyramid to the image file \a fileName. Only the
+     * header is read here. When the image format supports reading parts of
+     * the image, the tiles are decoded from the file on their own. Otherwise
+     * the image is decoded once, when its first tile is produced.
+     *
+     * @return <code>true</code> if the size of the image could be read
+     */
+    bool load(const QString &fileName,
+              const QColor &transparentColor = QColor());
+
+    void clear();
+
+    bool isNull() const { return mSource.isNull(); }
+
+    /**
+     * Returns the size of the full resolution image.
+     */
+    QSize size() const;
+
+    /**
+     * Returns the full resolution image. This may need to decode the whole
+     * file.
+     */
+    QImage toImage() const;
+
+    /**
+     * Draws the image at \a position. Only the tiles intersecting the
+     * \a exposed rect are drawn, or all of them when it is null.
+     *
+     * @return <code>true</code> if all the tiles could be drawn, which is
+     *         always the case with WaitForTiles
+     */
+    bool draw(QPainter *painter,
+              const QPointF &position,
+              const QRectF &exposed = QRectF(),
+              DrawMode mode = WaitForTiles) const;
+
+private:
+    QSharedPointer<const ImagePyramidSource> mSource;
+};
+
+/**
+ * Notifies about tiles that were produced in the background for pyramids
+ * drawn with ImagePyramid::DrawAvailableTiles. It lives on the GUI thread,
+ * so the instance needs to be created there.
+ */
+class TILEDSHARED_EXPORT ImagePyramidNotifier : public QObject
+{
+    Q_OBJECT
+
+public:
+    static ImagePyramidNotifier *instance();
+
+signals:
+    /**
+     * Emitted when tiles were added to the cache. The image layers need to
+     * be drawn again to show them.
+     */
+    void tilesDecoded();
+
+private slots:
+    void insertDecodedTiles();
+
+private:
+    ImagePyramidNotifier();
+};
+
+} // namespace Tiled
+
+#endif // IMAGEPYRAMID_H
@@ -482,6 +482,26 @@ void IsometricRenderer::drawMapObject(QPainter *painter,
     painter->restore();
 }
 
+/**
+ * The names of tile objects are drawn along with them, so named objects are
+ * left to drawMapObject().
+ */
+bool IsometricRenderer::canBatchTileObject(const MapObject *object) const
+{
+    return MapRenderer::canBatchTileObject(object) && object->name().isEmpty();
+}
+
+void IsometricRenderer::drawTileObjects(QPainter *painter,
+                                        const QList<const MapObject*> &objects) const
+{
+    CellRenderer renderer(painter);
+
+    foreach (const MapObject *object, objects)
+        renderer.render(object->cell(),
+                        pixelToScreenCoords(object->position()),
+                        CellRenderer::BottomCenter);
+}
+
 QPointF IsometricRenderer::pixelToTileCoords(qreal x, qreal y) const
 {
     const int tileHeight = map()->tileHeight();
@@ -509,6 +529,27 @@ QPointF IsometricRenderer::screenToTileCoords(qreal x, qreal y) const
                    tileY - tileX);
 }
 
+QPolygonF IsometricRenderer::screenToTileCoords(const QPolygonF &points) const
+{
+    const int tileWidth = map()->tileWidth();
+    const int tileHeight = map()->tileHeight();
+    const qreal originX = map()->height() * tileWidth / 2;
+    const int count = points.size();
+
+    QPolygonF tiles(count);
+    const QPointF *src = points.constData();
+    QPointF *dst = tiles.data();
+
+    for (int i = 0; i < count; ++i) {
+        const qreal tileY = src[i].y() / tileHeight;
+        const qreal tileX = (src[i].x() - originX) / tileWidth;
+        dst[i].rx() = tileY + tileX;
+        dst[i].ry() = tileY - tileX;
+    }
+
+    return tiles;
+}
+
 QPointF IsometricRenderer::tileToScreenCoords(qreal x, qreal y) const
 {
     const int tileWidth = map()->tileWidth();
@@ -519,6 +560,27 @@ QPointF IsometricRenderer::tileToScreenCoords(qreal x, qreal y) const
                    (x + y) * tileHeight / 2);
 }
 
+QPolygonF IsometricRenderer::tileToScreenCoords(const QPolygonF &tiles) const
+{
+    const int tileWidth = map()->tileWidth();
+    const int tileHeight = map()->tileHeight();
+    const int originX = map()->height() * tileWidth / 2;
+    const int count = tiles.size();
+
+    QPolygonF points(count);
+    const QPointF *src = tiles.constData();
+    QPointF *dst = points.data();
+
+    for (int i = 0; i < count; ++i) {
+        const qreal x = src[i].x();
+        const qreal y = src[i].y();
+        dst[i].rx() = (x - y) * tileWidth / 2 + originX;
+        dst[i].ry() = (x + y) * tileHeight / 2;
+    }
+
+    return points;
+}
+
 QPointF IsometricRenderer::screenToPixelCoords(qreal x, qreal y) const
 {
     const int tileWidth = map()->tileWidth();
@@ -27,9 +27,11 @@ DEFINES += QT_NO_CAST_FROM_ASCII \
 DEFINES += TILED_LIBRARY
 contains(QT_CONFIG, reduce_exports): CONFIG += hide_symbols
 
-SOURCES += compression.cpp \
+SOURCES += collisioncache.cpp \
+    compression.cpp \
     gidmapper.cpp \
     imagelayer.cpp \
+    imagepyramid.cpp \
     isometricrenderer.cpp \
     layer.cpp \
     map.cpp \
@@ -44,10 +46,13 @@ SOURCES += compression.cpp \
     tile.cpp \
     tilelayer.cpp \
     tileset.cpp \
+    walkabilitygrid.cpp \
     hexagonalrenderer.cpp
-HEADERS += compression.h \
+HEADERS += collisioncache.h \
+    compression.h \
     gidmapper.h \
     imagelayer.h \
+    imagepyramid.h \
     isometricrenderer.h \
     layer.h \
     map.h \
@@ -68,6 +73,7 @@ HEADERS += compression.h \
     tiled_global.h \
     tilelayer.h \
     tileset.h \
+    walkabilitygrid.h \
     logginginterface.h \
     hexagonalrenderer.h
 
@@ -45,6 +45,9 @@
 #include <QDebug>
 #include <QDir>
 #include <QFileInfo>
+#include <QImageReader>
+#include <QRunnable>
+#include <QThreadPool>
 #include <QVector>
 #include <QXmlStreamReader>
 
@@ -54,6 +57,29 @@ using namespace Tiled::Internal;
 namespace Tiled {
 namespace Internal {
 
+/**
+ * Decodes the image of a tileset. Slicing it into tiles is left to the
+ * thread of the reader, since it involves creating pixmaps.
+ */
+class TilesetImageJob : public QRunnable
+{
+public:
+    TilesetImageJob(MapReader *reader, Tileset *tileset, const QString &source)
+        : reader(reader)
+        , tileset(tileset)
+        , source(source)
+    {
+        setAutoDelete(false);
+    }
+
+    void run();
+
+    MapReader *reader;
+    Tileset *tileset;
+    QString source;
+    QImage image;
+};
+
 class MapReaderPrivate
 {
     Q_DECLARE_TR_FUNCTIONS(MapReader)
@@ -64,9 +90,15 @@ public:
     MapReaderPrivate(MapReader *mapReader):
         p(mapReader),
         mMap(0),
-        mReadingExternalTileset(false)
+        mReadingExternalTileset(false),
+        mDeferTilesetImages(false)
     {}
 
+    ~MapReaderPrivate()
+    {
+        qDeleteAll(mTilesetImageJobs);
+    }
+
     Map *readMap(QIODevice *device, const QString &path);
     Tileset *readTileset(QIODevice *device, const QString &path);
 
@@ -74,6 +106,9 @@ public:
 
     QString errorString() const;
 
+    static QImage readExternalImage(MapReader *reader, const QString &source)
+    { return reader->readExternalImage(source); }
+
 private:
     void readUnknownElement();
 
@@ -84,6 +119,7 @@ private:
     void readTilesetImage(Tileset *tileset);
     void readTilesetTerrainTypes(Tileset *tileset);
     QImage readImage();
+    void loadTilesetImages();
 
     TileLayer *readLayer();
     void readLayerData(TileLayer *tileLayer);
@@ -122,12 +158,25 @@ private:
     GidMapper mGidMapper;
     bool mReadingExternalTileset;
 
+    /**
+     * The tileset images that are still to be decoded. When deferred, they
+     * are left for the reader that asked for the external tileset, so that
+     * its images are decoded along with the ones of the map.
+     */
+    QList<TilesetImageJob*> mTilesetImageJobs;
+    bool mDeferTilesetImages;
+
     QXmlStreamReader xml;
 };
 
 } // namespace Internal
 } // namespace Tiled
 
+void TilesetImageJob::run()
+{
+    image = MapReaderPrivate::readExternalImage(reader, source);
+}
+
 Map *MapReaderPrivate::readMap(QIODevice *device, const QString &path)
 {
     mError.clear();
@@ -160,6 +209,9 @@ Tileset *MapReaderPrivate::readTileset(QIODevice *device, const QString &path)
     else
         xml.raiseError(tr("Not a tileset file."));
 
+    if (!mDeferTilesetImages)
+        loadTilesetImages();
+
     mReadingExternalTileset = false;
     return tileset;
 }
@@ -256,6 +308,11 @@ Map *MapReaderPrivate::readMap()
         mMap->setBackgroundColor(QColor(bgColorString.toString()));
 
     while (xml.readNextStartElement()) {
+        // The tileset images are decoded in parallel until something comes
+        // along that may refer to their tiles
+        if (xml.name() != QLatin1String("tileset"))
+            loadTilesetImages();
+
         if (xml.name() == QLatin1String("properties"))
             mMap->mergeProperties(readProperties());
         else if (xml.name() == QLatin1String("tileset"))
@@ -270,6 +327,8 @@ Map *MapReaderPrivate::readMap()
             readUnknownElement();
     }
 
+    loadTilesetImages();
+
     // Clean up in case of error
     if (xml.hasError()) {
         // The tilesets are not owned by the map
@@ -466,6 +525,19 @@ void MapReaderPrivate::readTilesetImage(Tileset *tileset)
     const int width = atts.value(QLatin1String("width")).toString().toInt();
     mGidMapper.setTilesetWidth(tileset, width);
 
+    // Only the size of the image is read for now, which is enough to create
+    // the tiles. The image itself is decoded by loadTilesetImages().
+    if (!source.isEmpty() && tileset->tileWidth() > 0
+            && tileset->tileHeight() > 0) {
+        const QSize imageSize = QImageReader(source).size();
+        if (imageSize.isValid()) {
+            xml.skipCurrentElement();
+            tileset->reserveTiles(imageSize, source);
+            mTilesetImageJobs.append(new TilesetImageJob(p, tileset, source));
+            return;
+        }
+    }
+
     if (!tileset->loadFromImage(readImage(), source))
         xml.raiseError(tr("Error loading tileset image:\n'%1'").arg(source));
 }
@@ -506,6 +578,32 @@ QImage MapReaderPrivate::readImage()
     return QImage();
 }
 
+/**
+ * Decodes the pending tileset images on a thread pool and slices them into
+ * tiles once they are all done.
+ */
+void MapReaderPrivate::loadTilesetImages()
+{
+    if (mTilesetImageJobs.isEmpty())
+        return;
+
+    QThreadPool threadPool;
+    foreach (TilesetImageJob *job, mTilesetImageJobs)
+        threadPool.start(job);
+    threadPool.waitForDone();
+
+    foreach (TilesetImageJob *job, mTilesetImageJobs) {
+        if (!job->tileset->loadFromImage(job->image, job->source)
+                && !xml.hasError()) {
+            xml.raiseError(tr("Error loading tileset image:\n'%1'")
+                           .arg(job->source));
+        }
+    }
+
+    qDeleteAll(mTilesetImageJobs);
+    mTilesetImageJobs.clear();
+}
+
 void MapReaderPrivate::readTilesetTerrainTypes(Tileset *tileset)
 {
     Q_ASSERT(xml.isStartElement() && xml.name() == QLatin1String("terraintypes"));
@@ -819,8 +917,8 @@ void MapReaderPrivate::readImageLayerImage(ImageLayer *imageLayer)
 
     source = p->resolveReference(source, mPath);
 
-    const QImage imageLayerImage = p->readExternalImage(source);
-    if (!imageLayer->loadFromImage(imageLayerImage, source))
+    // Only the header is read, the pyramid decodes the parts it draws
+    if (!imageLayer->loadFromFile(source))
         xml.raiseError(tr("Error loading image layer image:\n'%1'").arg(source));
 
     xml.skipCurrentElement();
@@ -1044,12 +1142,21 @@ Tileset *MapReader::readExternalTileset(const QString &source,
                                         QString *error)
 {
     MapReader reader;
+    reader.d->mDeferTilesetImages = true;
 
     Tileset *tileset = reader.readTileset(source);
-    if (!tileset)
+    if (!tileset) {
         *error = reader.errorString();
-    else
+    } else {
         d->mCreatedTilesets.append(tileset);
 
+        // Decode the images of the tileset along with those of the map
+        foreach (TilesetImageJob *job, reader.d->mTilesetImageJobs) {
+            job->reader = this;
+            d->mTilesetImageJobs.append(job);
+        }
+        reader.d->mTilesetImageJobs.clear();
+    }
+
     return tileset;
 }
@@ -106,6 +106,9 @@ protected:
 
     /**
      * Called when an external image is encountered while a tileset is loaded.
+     *
+     * Tileset images are decoded in parallel, so this function may be called
+     * from several threads at once.
      */
     virtual QImage readExternalImage(const QString &source);
 
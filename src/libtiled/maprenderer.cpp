@@ -29,6 +29,7 @@
 #include "maprenderer.h"
 
 #include "imagelayer.h"
+#include "mapobject.h"
 #include "tile.h"
 #include "tilelayer.h"
 
@@ -41,17 +42,49 @@ using namespace Tiled;
 QRectF MapRenderer::boundingRect(const ImageLayer *imageLayer) const
 {
     return QRectF(imageLayer->position(),
-                  imageLayer->image().size());
+                  imageLayer->imageSize());
 }
 
-void MapRenderer::drawImageLayer(QPainter *painter,
+bool MapRenderer::drawImageLayer(QPainter *painter,
                                  const ImageLayer *imageLayer,
-                                 const QRectF &exposed)
+                                 const QRectF &exposed,
+                                 ImagePyramid::DrawMode mode)
 {
-    Q_UNUSED(exposed)
+    return imageLayer->imagePyramid().draw(painter,
+                                           imageLayer->position(),
+                                           exposed,
+                                           mode);
+}
+
+bool MapRenderer::canBatchTileObject(const MapObject *object) const
+{
+    return !object->cell().isEmpty()
+            && object->rotation() == qreal(0)
+            && !testFlag(ShowTileObjectOutlines);
+}
 
-    painter->drawPixmap(imageLayer->position(),
-                        imageLayer->image());
+void MapRenderer::drawTileObjects(QPainter *painter,
+                                  const QList<const MapObject*> &objects) const
+{
+    // Batched objects don't show their outline, so the color is not used
+    foreach (const MapObject *object, objects)
+        drawMapObject(painter, object, Qt::gray);
+}
+
+QPolygonF MapRenderer::screenToTileCoords(const QPolygonF &points) const
+{
+    QPolygonF tiles(points.size());
+    for (int i = points.size() - 1; i >= 0; --i)
+        tiles[i] = screenToTileCoords(points.at(i));
+    return tiles;
+}
+
+QPolygonF MapRenderer::tileToScreenCoords(const QPolygonF &tiles) const
+{
+    QPolygonF points(tiles.size());
+    for (int i = tiles.size() - 1; i >= 0; --i)
+        points[i] = tileToScreenCoords(tiles.at(i));
+    return points;
 }
 
 void MapRenderer::setFlag(RenderFlag flag, bool enabled)
@@ -29,6 +29,7 @@
 #ifndef MAPRENDERER_H
 #define MAPRENDERER_H
 
+#include "imagepyramid.h"
 #include "tiled_global.h"
 
 #include <QPainter>
@@ -133,12 +134,38 @@ public:
                                const MapObject *object,
                                const QColor &color) const = 0;
 
+    /**
+     * Returns whether drawing the \a object with drawMapObject() comes down
+     * to drawing its tile, in which case it can be passed to
+     * drawTileObjects() instead. This is the case for unrotated tile objects
+     * when tile object outlines are not shown.
+     */
+    virtual bool canBatchTileObject(const MapObject *object) const;
+
+    /**
+     * Draws the given tile \a objects in order, through a single
+     * CellRenderer. Consecutive objects using the same tile are drawn with
+     * a single call, and no painter state is saved or changed per object.
+     *
+     * Only objects for which canBatchTileObject() returns true should be
+     * passed to this function.
+     *
+     * The default implementation draws each object with drawMapObject().
+     */
+    virtual void drawTileObjects(QPainter *painter,
+                                 const QList<const MapObject*> &objects) const;
+
     /**
      * Draws the given image \a layer using the given \a painter.
+     *
+     * With ImagePyramid::DrawAvailableTiles, the parts of the image that
+     * are still being decoded are left out or drawn at a lower resolution,
+     * in which case <code>false</code> is returned.
      */
-    void drawImageLayer(QPainter *painter,
+    bool drawImageLayer(QPainter *painter,
                         const ImageLayer *imageLayer,
-                        const QRectF &exposed = QRectF());
+                        const QRectF &exposed = QRectF(),
+                        ImagePyramid::DrawMode mode = ImagePyramid::WaitForTiles);
 
     /**
      * Returns the tile coordinates matching the given pixel position.
@@ -176,12 +203,26 @@ public:
     virtual QPointF screenToTileCoords(qreal x, qreal y) const = 0;
     inline QPointF screenToTileCoords(const QPointF &point) const;
 
+    /**
+     * Returns the tile coordinates matching each of the given screen
+     * positions. Renderers override this to do the setup only once for the
+     * whole batch.
+     */
+    virtual QPolygonF screenToTileCoords(const QPolygonF &points) const;
+
     /**
      * Returns the screen position matching the given tile coordinates.
      */
     virtual QPointF tileToScreenCoords(qreal x, qreal y) const = 0;
     inline QPointF tileToScreenCoords(const QPointF &point) const;
 
+    /**
+     * Returns the screen positions matching each of the given tile
+     * coordinates. Renderers override this to do the setup only once for
+     * the whole batch.
+     */
+    virtual QPolygonF tileToScreenCoords(const QPolygonF &tiles) const;
+
     /**
      * Returns the pixel position matching the given screen position.
      */
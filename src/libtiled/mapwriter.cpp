@@ -46,6 +46,8 @@
 #include <QDir>
 #include <QXmlStreamWriter>
 
+#include <cstring>
+
 #if QT_VERSION >= 0x050100
 #define HAS_QSAVEFILE_SUPPORT
 #endif
@@ -117,6 +119,99 @@ bool MapWriterPrivate::openFile(QIODevice *file)
     return true;
 }
 
+namespace {
+
+/**
+ * Writes tile layer data straight to the device of an XML stream writer, in
+ * chunks of a fixed size. This bypasses the escaping and encoding done by
+ * the writer, which is fine since the data is plain ASCII that needs no
+ * escaping.
+ */
+class RawDataWriter
+{
+public:
+    explicit RawDataWriter(QXmlStreamWriter &w)
+        : mDevice(w.device())
+        , mSize(0)
+    {
+        Q_ASSERT(mDevice);
+        mBuffer.resize(chunkSize);
+
+        // Finishes the start tag of the current element
+        w.writeCharacters(QString());
+    }
+
+    ~RawDataWriter() { flush(); }
+
+    void append(const char *latin1, int length)
+    {
+        reserve(length);
+        memcpy(mBuffer.data() + mSize, latin1, length);
+        mSize += length;
+    }
+
+    void append(char c)
+    {
+        reserve(1);
+        mBuffer.data()[mSize++] = c;
+    }
+
+    /**
+     * Appends the decimal representation of \a value, two digits at a
+     * time.
+     */
+    void appendNumber(unsigned value)
+    {
+        static const char digitPairs[] =
+                "0001020304050607080910111213141516171819"
+                "2021222324252627282930313233343536373839"
+                "4041424344454647484950515253545556575859"
+                "6061626364656667686970717273747576777879"
+                "8081828384858687888990919293949596979899";
+
+        char digits[10];
+        char *p = digits + sizeof(digits);
+
+        while (value >= 100) {
+            const unsigned i = (value % 100) * 2;
+            value /= 100;
+            *--p = digitPairs[i + 1];
+            *--p = digitPairs[i];
+        }
+
+        if (value >= 10) {
+            *--p = digitPairs[value * 2 + 1];
+            *--p = digitPairs[value * 2];
+        } else {
+            *--p = char('0' + value);
+        }
+
+        append(p, digits + sizeof(digits) - p);
+    }
+
+    void flush()
+    {
+        if (mSize > 0)
+            mDevice->write(mBuffer.constData(), mSize);
+        mSize = 0;
+    }
+
+private:
+    static const int chunkSize = 64 * 1024;
+
+    void reserve(int length)
+    {
+        if (mSize + length > chunkSize)
+            flush();
+    }
+
+    QIODevice *mDevice;
+    QByteArray mBuffer;
+    int mSize;
+};
+
+} // anonymous namespace
+
 static QXmlStreamWriter *createWriter(QIODevice *device)
 {
     QXmlStreamWriter *writer = new QXmlStreamWriter(device);
@@ -424,30 +519,42 @@ void MapWriterPrivate::writeTileLayer(QXmlStreamWriter &w,
         w.writeAttribute(QLatin1String("compression"), compression);
 
     if (mLayerDataFormat == Map::XML) {
+        // Formatted the way the stream writer would, except that empty
+        // tiles are written without the gid attribute, which defaults to 0
+        static const char tileStart[] = "\n   <tile gid=\"";
+        static const char tileEnd[] = "\"/>";
+        static const char emptyTile[] = "\n   <tile/>";
+
+        RawDataWriter data(w);
+
         for (int y = 0; y < tileLayer->height(); ++y) {
             for (int x = 0; x < tileLayer->width(); ++x) {
                 const unsigned gid = mGidMapper.cellToGid(tileLayer->cellAt(x, y));
-                w.writeStartElement(QLatin1String("tile"));
-                w.writeAttribute(QLatin1String("gid"), QString::number(gid));
-                w.writeEndElement();
+                if (gid == 0) {
+                    data.append(emptyTile, sizeof(emptyTile) - 1);
+                } else {
+                    data.append(tileStart, sizeof(tileStart) - 1);
+                    data.appendNumber(gid);
+                    data.append(tileEnd, sizeof(tileEnd) - 1);
+                }
             }
         }
+
+        data.append("\n  ", 3);
     } else if (mLayerDataFormat == Map::CSV) {
-        QString tileData;
+        RawDataWriter data(w);
+        data.append('\n');
 
         for (int y = 0; y < tileLayer->height(); ++y) {
             for (int x = 0; x < tileLayer->width(); ++x) {
                 const unsigned gid = mGidMapper.cellToGid(tileLayer->cellAt(x, y));
-                tileData.append(QString::number(gid));
+                data.appendNumber(gid);
                 if (x != tileLayer->width() - 1
                     || y != tileLayer->height() - 1)
-                    tileData.append(QLatin1String(","));
+                    data.append(',');
             }
-            tileData.append(QLatin1String("\n"));
+            data.append('\n');
         }
-
-        w.writeCharacters(QLatin1String("\n"));
-        w.writeCharacters(tileData);
     } else {
         QByteArray tileData;
         tileData.reserve(tileLayer->height() * tileLayer->width() * 4);
@@ -429,6 +429,17 @@ void OrthogonalRenderer::drawMapObject(QPainter *painter,
     painter->restore();
 }
 
+void OrthogonalRenderer::drawTileObjects(QPainter *painter,
+                                         const QList<const MapObject*> &objects) const
+{
+    CellRenderer renderer(painter);
+
+    foreach (const MapObject *object, objects)
+        renderer.render(object->cell(),
+                        object->bounds().topLeft(),
+                        CellRenderer::BottomLeft);
+}
+
 QPointF OrthogonalRenderer::pixelToTileCoords(qreal x, qreal y) const
 {
     return QPointF(x / map()->tileWidth(),
@@ -447,12 +458,48 @@ QPointF OrthogonalRenderer::screenToTileCoords(qreal x, qreal y) const
                    y / map()->tileHeight());
 }
 
+QPolygonF OrthogonalRenderer::screenToTileCoords(const QPolygonF &points) const
+{
+    const qreal tileWidth = map()->tileWidth();
+    const qreal tileHeight = map()->tileHeight();
+    const int count = points.size();
+
+    QPolygonF tiles(count);
+    const QPointF *src = points.constData();
+    QPointF *dst = tiles.data();
+
+    for (int i = 0; i < count; ++i) {
+        dst[i].rx() = src[i].x() / tileWidth;
+        dst[i].ry() = src[i].y() / tileHeight;
+    }
+
+    return tiles;
+}
+
 QPointF OrthogonalRenderer::tileToScreenCoords(qreal x, qreal y) const
 {
     return QPointF(x * map()->tileWidth(),
                    y * map()->tileHeight());
 }
 
+QPolygonF OrthogonalRenderer::tileToScreenCoords(const QPolygonF &tiles) const
+{
+    const qreal tileWidth = map()->tileWidth();
+    const qreal tileHeight = map()->tileHeight();
+    const int count = tiles.size();
+
+    QPolygonF points(count);
+    const QPointF *src = tiles.constData();
+    QPointF *dst = points.data();
+
+    for (int i = 0; i < count; ++i) {
+        dst[i].rx() = src[i].x() * tileWidth;
+        dst[i].ry() = src[i].y() * tileHeight;
+    }
+
+    return points;
+}
+
 QPointF OrthogonalRenderer::screenToPixelCoords(qreal x, qreal y) const
 {
     return QPointF(x, y);
@@ -64,6 +64,9 @@ public:
                        const MapObject *object,
                        const QColor &color) const;
 
+    void drawTileObjects(QPainter *painter,
+                         const QList<const MapObject*> &objects) const;
+
     using MapRenderer::pixelToTileCoords;
     QPointF pixelToTileCoords(qreal x, qreal y) const;
 
@@ -72,9 +75,11 @@ public:
     
     using MapRenderer::screenToTileCoords;
     QPointF screenToTileCoords(qreal x, qreal y) const;
+    QPolygonF screenToTileCoords(const QPolygonF &points) const;
 
     using MapRenderer::tileToScreenCoords;
     QPointF tileToScreenCoords(qreal x, qreal y) const;
+    QPolygonF tileToScreenCoords(const QPolygonF &tiles) const;
     
     using MapRenderer::screenToPixelCoords;
     QPointF screenToPixelCoords(qreal x, qreal y) const;
@@ -40,9 +40,28 @@ using namespace Tiled;
  * does not produce nice results for isometric shapes in the tile corners.
  */
 QPointF StaggeredRenderer::screenToTileCoords(qreal x, qreal y) const
+{
+    return screenToTile(RenderParams(map()), x, y);
+}
+
+QPolygonF StaggeredRenderer::screenToTileCoords(const QPolygonF &points) const
 {
     const RenderParams p(map());
+    const int count = points.size();
+
+    QPolygonF tiles(count);
+    const QPointF *src = points.constData();
+    QPointF *dst = tiles.data();
 
+    for (int i = 0; i < count; ++i)
+        dst[i] = screenToTile(p, src[i].x(), src[i].y());
+
+    return tiles;
+}
+
+QPoint StaggeredRenderer::screenToTile(const RenderParams &p,
+                                       qreal x, qreal y) const
+{
     if (p.staggerX)
         x -= p.staggerEven ? p.sideOffsetX : 0;
     else
@@ -80,6 +80,10 @@ public:
 
     using HexagonalRenderer::screenToTileCoords;
     QPointF screenToTileCoords(qreal x, qreal y) const;
+    QPolygonF screenToTileCoords(const QPolygonF &points) const;
+
+private:
+    QPoint screenToTile(const RenderParams &p, qreal x, qreal y) const;
 };
 
 } // namespace Tiled
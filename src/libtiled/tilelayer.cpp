@@ -29,10 +29,13 @@
 
 #include "tilelayer.h"
 
+#include "compression.h"
 #include "map.h"
 #include "tile.h"
 #include "tileset.h"
 
+#include <cstring>
+
 using namespace Tiled;
 
 TileLayer::TileLayer(const QString &name, int x, int y, int width, int height):
@@ -153,8 +156,8 @@ void TileLayer::merge(const QPoint &pos, const TileLayer *layer)
 
     for (int y = area.top(); y <= area.bottom(); ++y) {
         for (int x = area.left(); x <= area.right(); ++x) {
-            const Cell &cell = layer->cellAt(x - area.left(),
-                                             y - area.top());
+            const Cell &cell = layer->cellAt(x - pos.x(),
+                                             y - pos.y());
             if (!cell.isEmpty())
                 setCell(x, y, cell);
         }
@@ -318,6 +321,25 @@ void TileLayer::resize(const QSize &size, const QPoint &offset)
     setSize(size);
 }
 
+QByteArray TileLayer::compressCells()
+{
+    const QByteArray data(reinterpret_cast<const char*>(mGrid.constData()),
+                          mGrid.size() * sizeof(Cell));
+    mGrid = QVector<Cell>();
+    return compress(data, Zlib);
+}
+
+void TileLayer::uncompressCells(const QByteArray &data)
+{
+    const int cellCount = mWidth * mHeight;
+    const QByteArray cells = decompress(data, cellCount * sizeof(Cell));
+    Q_ASSERT(cells.size() == int(cellCount * sizeof(Cell)));
+
+    mGrid.resize(cellCount);
+    std::memcpy(mGrid.data(), cells.constData(),
+                qMin<int>(cells.size(), cellCount * sizeof(Cell)));
+}
+
 void TileLayer::offset(const QPoint &offset,
                        const QRect &bounds,
                        bool wrapX, bool wrapY)
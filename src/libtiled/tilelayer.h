@@ -237,6 +237,21 @@ public:
      */
     void resize(const QSize &size, const QPoint &offset);
 
+    /**
+     * Compresses the cells of this layer and releases the memory they took.
+     * The layer keeps its size, but its cells may not be accessed until they
+     * are restored with uncompressCells().
+     *
+     * The compressed data refers to the tiles in memory, so it is only valid
+     * for as long as the tilesets are.
+     */
+    QByteArray compressCells();
+
+    /**
+     * Restores the cells from \a data returned by compressCells().
+     */
+    void uncompressCells(const QByteArray &data);
+
     /**
      * Offsets the tiles in this layer within \a bounds by \a offset,
      * and optionally wraps them.
@@ -99,6 +99,29 @@ bool Tileset::loadFromImage(const QString &fileName)
     return loadFromImage(QImage(fileName), fileName);
 }
 
+void Tileset::reserveTiles(const QSize &imageSize, const QString &fileName)
+{
+    Q_ASSERT(mTileWidth > 0 && mTileHeight > 0);
+
+    const int stopWidth = imageSize.width() - mTileWidth;
+    const int stopHeight = imageSize.height() - mTileHeight;
+
+    int tileNum = 0;
+
+    for (int y = mMargin; y <= stopHeight; y += mTileHeight + mTileSpacing) {
+        for (int x = mMargin; x <= stopWidth; x += mTileWidth + mTileSpacing) {
+            if (tileNum >= mTiles.size())
+                mTiles.append(new Tile(QPixmap(), tileNum, this));
+            ++tileNum;
+        }
+    }
+
+    mImageWidth = imageSize.width();
+    mImageHeight = imageSize.height();
+    mColumnCount = columnCountForWidth(mImageWidth);
+    mImageSource = fileName;
+}
+
 Tileset *Tileset::findSimilarTileset(const QList<Tileset*> &tilesets) const
 {
     foreach (Tileset *candidate, tilesets) {
@@ -215,6 +215,16 @@ public:
      */
     bool loadFromImage(const QString &fileName);
 
+    /**
+     * Makes sure this tileset has the tiles that a tileset image of the given
+     * \a imageSize would provide, and remembers \a fileName as the image
+     * source. New tiles have no image until loadFromImage() is called.
+     *
+     * This allows reading the tile data while the tileset image is still
+     * being decoded.
+     */
+    void reserveTiles(const QSize &imageSize, const QString &fileName);
+
     /**
      * This checks if there is a similar tileset in the given list.
      * It is needed for replacing this tileset by its similar copy.
@@ -0,0 +1,473 @@
+/*
+ * walkabilitygrid.cpp
+ * Copyright 2015, Sydoria Games <luax@sydoria.fr>
+ *
+ * This file is part of libtiled.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *    1. Redistributions of source code must retain the above copyright notice,
+ *       this list of conditions and the following disclaimer.
+ *
+ *    2. Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE CONTRIBUTORS ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO
+ * EVENT SHALL THE CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include "walkabilitygrid.h"
+
+#include "collisioncache.h"
+#include "hexagonalrenderer.h"
+#include "isometricrenderer.h"
+#include "map.h"
+#include "mapobject.h"
+#include "objectgroup.h"
+#include "orthogonalrenderer.h"
+#include "staggeredrenderer.h"
+#include "tilelayer.h"
+
+#include <QRunnable>
+#include <QScopedPointer>
+#include <QThreadPool>
+#include <QVector>
+
+#include <algorithm>
+#include <cmath>
+
+using namespace Tiled;
+
+namespace {
+
+enum BlockFlag {
+    BlocksMovement      = 0x1,
+    BlocksLineOfSight   = 0x2
+};
+
+int blockFlags(const QString &collision)
+{
+    if (collision == QLatin1String("none"))
+        return 0;
+    if (collision == QLatin1String("movement"))
+        return BlocksMovement;
+    if (collision == QLatin1String("sight"))
+        return BlocksLineOfSight;
+    return BlocksMovement | BlocksLineOfSight;
+}
+
+/**
+ * The centers of the cells of a map, in the coordinates used by its objects.
+ * For each orientation, the centers of either each row or each column of
+ * cells lie evenly spaced on a horizontal or vertical line. This allows
+ * shapes to be rasterized by filling the spans between the points where
+ * their edges cross these lines.
+ */
+struct CellLattice
+{
+    struct Line
+    {
+        QPointF first;  // center of the first cell on the line
+        qreal step;     // distance to the center of the next cell
+    };
+
+    bool vertical;      // whether the lines are columns rather than rows
+    int width;
+    QVector<Line> lines;
+
+    int index(int line, int i) const
+    { return vertical ? i * width + line : line * width + i; }
+};
+
+QPointF cellCenter(const Map *map, const MapRenderer *renderer, int x, int y)
+{
+    switch (map->orientation()) {
+    case Map::Staggered:
+    case Map::Hexagonal:
+        // These renderers don't support fractional tile coordinates
+        return renderer->tileToPixelCoords(x, y)
+                + QPointF(map->tileWidth() / 2.0, map->tileHeight() / 2.0);
+    default:
+        return renderer->tileToPixelCoords(x + 0.5, y + 0.5);
+    }
+}
+
+CellLattice cellLattice(const Map *map)
+{
+    QScopedPointer<MapRenderer> renderer;
+
+    switch (map->orientation()) {
+    case Map::Isometric:
+        renderer.reset(new IsometricRenderer(map));
+        break;
+    case Map::Staggered:
+        renderer.reset(new StaggeredRenderer(map));
+        break;
+    case Map::Hexagonal:
+        renderer.reset(new HexagonalRenderer(map));
+        break;
+    default:
+        renderer.reset(new OrthogonalRenderer(map));
+        break;
+    }
+
+    CellLattice lattice;
+    lattice.vertical = (map->orientation() == Map::Staggered ||
+                        map->orientation() == Map::Hexagonal) &&
+            map->staggerAxis() == Map::StaggerX;
+    lattice.width = map->width();
+
+    const int lineCount = lattice.vertical ? map->width() : map->height();
+    lattice.lines.resize(lineCount);
+
+    for (int l = 0; l < lineCount; ++l) {
+        CellLattice::Line &line = lattice.lines[l];
+
+        if (lattice.vertical) {
+            line.first = cellCenter(map, renderer.data(), l, 0);
+            line.step = cellCenter(map, renderer.data(), l, 1).y() - line.first.y();
+        } else {
+            line.first = cellCenter(map, renderer.data(), 0, l);
+            line.step = cellCenter(map, renderer.data(), 1, l).x() - line.first.x();
+        }
+    }
+
+    return lattice;
+}
+
+/**
+ * Sets the bits of the cells within \a area whose centers lie within the
+ * \a polygon, using the even-odd rule.
+ */
+void fillPolygon(const QPolygonF &polygon, const CellLattice &lattice,
+                 const QRect &area,
+                 QBitArray *movement, QBitArray *lineOfSight)
+{
+    const QRectF bounds = polygon.boundingRect();
+    const int count = polygon.size();
+    QVector<qreal> crossings;
+
+    // The range of lines and the range of cells along each line to fill
+    const int firstLine = lattice.vertical ? area.left() : area.top();
+    const int lastLine = lattice.vertical ? area.right() : area.bottom();
+    const int firstCell = lattice.vertical ? area.top() : area.left();
+    const int lastCell = lattice.vertical ? area.bottom() : area.right();
+
+    for (int l = firstLine; l <= lastLine; ++l) {
+        const CellLattice::Line &line = lattice.lines.at(l);
+        if (line.step <= 0)
+            continue;
+
+        // Position of the line, and of the first cell along the line
+        const qreal position = lattice.vertical ? line.first.x() : line.first.y();
+        const qreal start = lattice.vertical ? line.first.y() : line.first.x();
+
+        if (lattice.vertical) {
+            if (position < bounds.left() || position > bounds.right())
+                continue;
+        } else {
+            if (position < bounds.top() || position > bounds.bottom())
+                continue;
+        }
+
+        crossings.clear();
+
+        for (int i = 0; i < count; ++i) {
+            const QPointF &p1 = polygon.at(i);
+            const QPointF &p2 = polygon.at((i + 1) % count);
+
+            const qreal a1 = lattice.vertical ? p1.x() : p1.y();
+            const qreal a2 = lattice.vertical ? p2.x() : p2.y();
+            if ((a1 <= position) == (a2 <= position))
+                continue;
+
+            const qreal b1 = lattice.vertical ? p1.y() : p1.x();
+            const qreal b2 = lattice.vertical ? p2.y() : p2.x();
+            crossings.append(b1 + (position - a1) * (b2 - b1) / (a2 - a1));
+        }
+
+        std::sort(crossings.begin(), crossings.end());
+
+        for (int k = 0; k + 1 < crossings.size(); k += 2) {
+            const int first = qMax(firstCell, int(std::ceil((crossings.at(k) - start) / line.step)));
+            const int last = qMin(lastCell,
+                                  int(std::ceil((crossings.at(k + 1) - start) / line.step)) - 1);
+            if (first > last)
+                continue;
+
+            if (!lattice.vertical) {
+                const int begin = lattice.index(l, first);
+                const int end = lattice.index(l, last) + 1;
+                if (movement)
+                    movement->fill(true, begin, end);
+                if (lineOfSight)
+                    lineOfSight->fill(true, begin, end);
+            } else {
+                for (int i = first; i <= last; ++i) {
+                    if (movement)
+                        movement->setBit(lattice.index(l, i));
+                    if (lineOfSight)
+                        lineOfSight->setBit(lattice.index(l, i));
+                }
+            }
+        }
+    }
+}
+
+void rasterizeTileLayer(const TileLayer *tileLayer,
+                        const CollisionCache *collisionCache,
+                        int mapWidth,
+                        const QRect &area,
+                        QBitArray *movement, QBitArray *lineOfSight)
+{
+    const int flags = blockFlags(tileLayer->property(QLatin1String("collision")));
+    if (!flags)
+        return;
+
+    const QRect layerArea = tileLayer->bounds() & area;
+
+    for (int y = layerArea.top(); y <= layerArea.bottom(); ++y) {
+        for (int x = layerArea.left(); x <= layerArea.right(); ++x) {
+            const Cell &cell = tileLayer->cellAt(x - tileLayer->x(),
+                                                 y - tileLayer->y());
+            if (!collisionCache->compiledCellMask(cell))
+                continue;
+
+            if (flags & BlocksMovement)
+                movement->setBit(y * mapWidth + x);
+            if (flags & BlocksLineOfSight)
+                lineOfSight->setBit(y * mapWidth + x);
+        }
+    }
+}
+
+void rasterizeObjectGroup(const ObjectGroup *objectGroup,
+                          const CellLattice &lattice,
+                          const QRect &area,
+                          QBitArray *movement, QBitArray *lineOfSight)
+{
+    const QString collision = QLatin1String("collision");
+    if (!objectGroup->hasProperty(collision))
+        return;
+
+    const int layerFlags = blockFlags(objectGroup->property(collision));
+
+    foreach (const MapObject *object, objectGroup->objects()) {
+        const int flags = object->hasProperty(collision)
+                ? blockFlags(object->property(collision))
+                : layerFlags;
+        if (!flags)
+            continue;
+
+        const QPolygonF polygon = CollisionCache::outline(object);
+        if (polygon.size() < 3)
+            continue;
+
+        fillPolygon(polygon, lattice, area,
+                    (flags & BlocksMovement) ? movement : 0,
+                    (flags & BlocksLineOfSight) ? lineOfSight : 0);
+    }
+}
+
+/**
+ * Rasterizes the collision data of the \a layer within \a area, setting the
+ * bits of the blocked cells.
+ */
+void rasterizeLayer(Layer *layer,
+                    const Map *map,
+                    const CollisionCache *collisionCache,
+                    const CellLattice &lattice,
+                    const QRect &area,
+                    QBitArray *movement, QBitArray *lineOfSight)
+{
+    if (TileLayer *tileLayer = layer->asTileLayer())
+        rasterizeTileLayer(tileLayer, collisionCache, map->width(), area,
+                           movement, lineOfSight);
+    else if (ObjectGroup *objectGroup = layer->asObjectGroup())
+        rasterizeObjectGroup(objectGroup, lattice, area,
+                             movement, lineOfSight);
+}
+
+/**
+ * Returns whether the \a layer can block any cell. Tile layers can only be
+ * disabled by their "collision" property, while object layers need to have
+ * one.
+ */
+bool hasCollision(const Layer *layer)
+{
+    const QString collision = QLatin1String("collision");
+
+    if (const TileLayer *tileLayer = layer->asTileLayer())
+        return blockFlags(tileLayer->property(collision)) != 0;
+    if (const ObjectGroup *objectGroup = layer->asObjectGroup())
+        return objectGroup->hasProperty(collision);
+    return false;
+}
+
+/**
+ * Rasterizes the collision data of the given layers within a band of rows,
+ * directly into the bits of the grid. Since the bands start at a multiple of
+ * eight rows, they never share a byte, so the bands can be processed in
+ * parallel.
+ */
+class BandJob : public QRunnable
+{
+public:
+    BandJob(const QList<Layer*> *layers,
+            const Map *map,
+            const CollisionCache *collisionCache,
+            const CellLattice *lattice,
+            const QRect &area,
+            QBitArray *movement,
+            QBitArray *lineOfSight)
+        : mLayers(layers)
+        , mMap(map)
+        , mCollisionCache(collisionCache)
+        , mLattice(lattice)
+        , mArea(area)
+        , mMovement(movement)
+        , mLineOfSight(lineOfSight)
+    {
+    }
+
+    void run()
+    {
+        foreach (Layer *layer, *mLayers)
+            rasterizeLayer(layer, mMap, mCollisionCache, *mLattice, mArea,
+                           mMovement, mLineOfSight);
+    }
+
+private:
+    const QList<Layer*> *mLayers;
+    const Map *mMap;
+    const CollisionCache *mCollisionCache;
+    const CellLattice *mLattice;
+    const QRect mArea;
+    QBitArray *mMovement;
+    QBitArray *mLineOfSight;
+};
+
+void appendLittleEndian(QByteArray &data, quint32 value)
+{
+    for (int i = 0; i < 4; ++i)
+        data.append(char((value >> (i * 8)) & 0xff));
+}
+
+void appendBits(QByteArray &data, const QBitArray &bits)
+{
+    const int size = bits.size();
+    for (int i = 0; i < size; i += 8) {
+        uchar byte = 0;
+        for (int j = 0; j < 8 && i + j < size; ++j)
+            if (bits.testBit(i + j))
+                byte |= 1 << j;
+        data.append(char(byte));
+    }
+}
+
+} // anonymous namespace
+
+WalkabilityGrid::WalkabilityGrid()
+    : mWidth(0)
+    , mHeight(0)
+{
+}
+
+WalkabilityGrid::WalkabilityGrid(int width, int height)
+    : mWidth(width)
+    , mHeight(height)
+    , mMovement(width * height)
+    , mLineOfSight(width * height)
+{
+}
+
+WalkabilityGrid WalkabilityGrid::fromMap(const Map *map,
+                                         CollisionCache *collisionCache)
+{
+    WalkabilityGrid grid(map->width(), map->height());
+
+    // Compile the collision shapes up front, since the cache can't be
+    // modified while the layers are rasterized
+    collisionCache->compile(map);
+
+    QList<Layer*> layers;
+    foreach (Layer *layer, map->layers())
+        if (hasCollision(layer))
+            layers.append(layer);
+
+    if (layers.isEmpty())
+        return grid;
+
+    const CellLattice lattice = cellLattice(map);
+
+    // A few bands per thread, each a multiple of eight rows high so that
+    // the bands start on a byte boundary of the bits
+    QThreadPool threadPool;
+    const int bandCount = qMax(1, threadPool.maxThreadCount() * 4);
+    const int bandHeight = qMax(8, ((map->height() + bandCount - 1)
+                                    / bandCount + 7) & ~7);
+
+    for (int y = 0; y < map->height(); y += bandHeight) {
+        const QRect area(0, y, map->width(),
+                         qMin(bandHeight, map->height() - y));
+        threadPool.start(new BandJob(&layers, map, collisionCache, &lattice,
+                                     area,
+                                     &grid.mMovement, &grid.mLineOfSight));
+    }
+    threadPool.waitForDone();
+
+    return grid;
+}
+
+void WalkabilityGrid::update(const Map *map,
+                             CollisionCache *collisionCache,
+                             const QRegion &region)
+{
+    Q_ASSERT(map->width() == mWidth && map->height() == mHeight);
+
+    const QRegion updateRegion = region & QRect(0, 0, mWidth, mHeight);
+    if (updateRegion.isEmpty())
+        return;
+
+    collisionCache->compile(map);
+
+    const CellLattice lattice = cellLattice(map);
+
+    foreach (const QRect &area, updateRegion.rects()) {
+        for (int y = area.top(); y <= area.bottom(); ++y) {
+            const int begin = y * mWidth + area.left();
+            const int end = y * mWidth + area.right() + 1;
+            mMovement.fill(false, begin, end);
+            mLineOfSight.fill(false, begin, end);
+        }
+
+        foreach (Layer *layer, map->layers())
+            if (hasCollision(layer))
+                rasterizeLayer(layer, map, collisionCache, lattice, area,
+                               &mMovement, &mLineOfSight);
+    }
+}
+
+QByteArray WalkabilityGrid::toByteArray() const
+{
+    static const quint32 version = 1;
+
+    QByteArray data("WALK");
+    appendLittleEndian(data, version);
+    appendLittleEndian(data, mWidth);
+    appendLittleEndian(data, mHeight);
+    appendBits(data, mMovement);
+    appendBits(data, mLineOfSight);
+    return data;
+}
@@ -0,0 +1,122 @@
+/*
+ * walkabilitygrid.h
+ * Copyright 2015, Sydoria Games <luax@sydoria.fr>
+ *
+ * This file is part of libtiled.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *    1. Redistributions of source code must retain the above copyright notice,
+ *       this list of conditions and the following disclaimer.
+ *
+ *    2. Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE CONTRIBUTORS ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO
+ * EVENT SHALL THE CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#ifndef WALKABILITYGRID_H
+#define WALKABILITYGRID_H
+
+#include "tiled_global.h"
+
+#include <QBitArray>
+#include <QByteArray>
+#include <QRegion>
+
+namespace Tiled {
+
+class CollisionCache;
+class Map;
+
+/**
+ * A grid with a bit per cell telling whether the cell blocks movement and a
+ * bit per cell telling whether it blocks line of sight.
+ *
+ * The grid is derived from the collision data of a map. Tile layers block
+ * the cells whose tiles have collision shapes, as compiled by the
+ * CollisionCache. Object layers block the cells whose centers lie within
+ * their rectangles, ellipses and polygons, but only when the layer has a
+ * "collision" property, since most object layers are not about collision.
+ *
+ * The "collision" property of a layer, or of an object to override the
+ * value of its layer, selects what is blocked: "movement", "sight", "none",
+ * or anything else for both.
+ */
+class TILEDSHARED_EXPORT WalkabilityGrid
+{
+public:
+    WalkabilityGrid();
+    WalkabilityGrid(int width, int height);
+
+    /**
+     * Rasterizes the collision data of the \a map. The map is split into
+     * bands of rows, which are rasterized in parallel. Layers that can't
+     * block anything are skipped.
+     */
+    static WalkabilityGrid fromMap(const Map *map,
+                                   CollisionCache *collisionCache);
+
+    /**
+     * Rasterizes the collision data of the \a map again within \a region,
+     * given in cells. The size of the map must match the size of this grid.
+     * Meant for keeping the grid up to date with small changes, so the layers
+     * are processed on the calling thread.
+     */
+    void update(const Map *map, CollisionCache *collisionCache,
+                const QRegion &region);
+
+    int width() const { return mWidth; }
+    int height() const { return mHeight; }
+
+    bool contains(int x, int y) const
+    { return x >= 0 && y >= 0 && x < mWidth && y < mHeight; }
+
+    bool blocksMovement(int x, int y) const
+    { return mMovement.testBit(y * mWidth + x); }
+
+    bool blocksLineOfSight(int x, int y) const
+    { return mLineOfSight.testBit(y * mWidth + x); }
+
+    /**
+     * Returns the movement bits, with bit <code>y * width + x</code> set when
+     * the cell at (x, y) blocks movement.
+     */
+    const QBitArray &movementBits() const { return mMovement; }
+
+    /**
+     * Returns the line of sight bits, laid out like movementBits().
+     */
+    const QBitArray &lineOfSightBits() const { return mLineOfSight; }
+
+    /**
+     * Returns the grid in its packed binary form: the "WALK" magic, a
+     * version, the width and the height as little-endian 32-bit integers,
+     * followed by the movement and line of sight bits. Each set of bits is
+     * packed eight cells per byte, row by row, starting at the least
+     * significant bit.
+     */
+    QByteArray toByteArray() const;
+
+private:
+    int mWidth;
+    int mHeight;
+    QBitArray mMovement;
+    QBitArray mLineOfSight;
+};
+
+} // namespace Tiled
+
+#endif // WALKABILITYGRID_H
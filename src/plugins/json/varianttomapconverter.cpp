@@ -419,7 +419,7 @@ ImageLayer *VariantToMapConverter::toImageLayer(const QVariantMap &variantMap)
 
     if (!imageVariant.isNull()) {
         QString imagePath = resolvePath(mMapDir, imageVariant);
-        if (!imageLayer->loadFromImage(QImage(imagePath), imagePath)) {
+        if (!imageLayer->loadFromFile(imagePath)) {
             mError = tr("Error loading image:\n'%1'").arg(imagePath);
             return 0;
         }
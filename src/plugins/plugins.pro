@@ -7,7 +7,8 @@ SUBDIRS = csv \
           replicaisland \
           tengine \
           tmw \
-          dofus
+          dofus \
+          walkability
 
 include(python/find_python.pri)
 
@@ -0,0 +1,7 @@
+include(../plugin.pri)
+
+DEFINES += WALKABILITY_LIBRARY
+
+SOURCES += walkabilityplugin.cpp
+HEADERS += walkabilityplugin.h \
+    walkability_global.h
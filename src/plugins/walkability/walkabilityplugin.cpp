@@ -0,0 +1,87 @@
+/*
+ * Walkability Tiled Plugin
+ * Copyright 2015, Sydoria Games <luax@sydoria.fr>
+ *
+ * This file is part of Tiled.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "walkabilityplugin.h"
+
+#include "collisioncache.h"
+#include "map.h"
+#include "walkabilitygrid.h"
+
+#include <QFile>
+
+#if QT_VERSION >= 0x050100
+#define HAS_QSAVEFILE_SUPPORT
+#endif
+
+#ifdef HAS_QSAVEFILE_SUPPORT
+#include <QSaveFile>
+#endif
+
+using namespace Tiled;
+using namespace Walkability;
+
+WalkabilityPlugin::WalkabilityPlugin()
+{
+}
+
+bool WalkabilityPlugin::write(const Map *map, const QString &fileName)
+{
+#ifdef HAS_QSAVEFILE_SUPPORT
+    QSaveFile file(fileName);
+#else
+    QFile file(fileName);
+#endif
+    if (!file.open(QIODevice::WriteOnly)) {
+        mError = tr("Could not open file for writing.");
+        return false;
+    }
+
+    CollisionCache collisionCache;
+    const WalkabilityGrid grid = WalkabilityGrid::fromMap(map, &collisionCache);
+    file.write(grid.toByteArray());
+
+    if (file.error() != QFile::NoError) {
+        mError = file.errorString();
+        return false;
+    }
+
+#ifdef HAS_QSAVEFILE_SUPPORT
+    if (!file.commit()) {
+        mError = file.errorString();
+        return false;
+    }
+#endif
+
+    return true;
+}
+
+QString WalkabilityPlugin::nameFilter() const
+{
+    return tr("Walkability grid files (*.walk)");
+}
+
+QString WalkabilityPlugin::errorString() const
+{
+    return mError;
+}
+
+#if QT_VERSION < 0x050000
+Q_EXPORT_PLUGIN2(Walkability, WalkabilityPlugin)
+#endif
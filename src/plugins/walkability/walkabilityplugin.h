@@ -0,0 +1,57 @@
+/*
+ * Walkability Tiled Plugin
+ * Copyright 2015, Sydoria Games <luax@sydoria.fr>
+ *
+ * This file is part of Tiled.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef WALKABILITYPLUGIN_H
+#define WALKABILITYPLUGIN_H
+
+#include "mapwriterinterface.h"
+
+#include "walkability_global.h"
+
+namespace Walkability {
+
+/**
+ * Exports the packed walkability and line of sight grid of a map, as built
+ * by Tiled::WalkabilityGrid, for use by the server.
+ */
+class WALKABILITYSHARED_EXPORT WalkabilityPlugin : public QObject,
+                                                   public Tiled::MapWriterInterface
+{
+    Q_OBJECT
+    Q_INTERFACES(Tiled::MapWriterInterface)
+#if QT_VERSION >= 0x050000
+    Q_PLUGIN_METADATA(IID "org.mapeditor.MapWriterInterface" FILE "plugin.json")
+#endif
+
+public:
+    WalkabilityPlugin();
+
+    // MapWriterInterface
+    bool write(const Tiled::Map *map, const QString &fileName);
+    QString nameFilter() const;
+    QString errorString() const;
+
+private:
+    QString mError;
+};
+
+} // namespace Walkability
+
+#endif // WALKABILITYPLUGIN_H
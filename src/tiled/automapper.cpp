@@ -40,6 +40,8 @@
 
 #include <QDebug>
 
+#include <algorithm>
+
 using namespace Tiled;
 using namespace Tiled::Internal;
 
@@ -58,10 +60,12 @@ AutoMapper::AutoMapper(MapDocument *workingDocument, Map *rules,
     , mMapRules(rules)
     , mLayerInputRegions(0)
     , mLayerOutputRegions(0)
+    , mOwnsRules(true)
     , mRulePath(rulePath)
     , mDeleteTiles(false)
     , mAutoMappingRadius(0)
     , mNoOverlappingRules(false)
+    , mUndoEnabled(true)
 {
     Q_ASSERT(mMapRules);
 
@@ -75,6 +79,34 @@ AutoMapper::AutoMapper(MapDocument *workingDocument, Map *rules,
         return;
 }
 
+AutoMapper::AutoMapper(MapDocument *workingDocument,
+                       const AutoMapper &prototype)
+    : mMapDocument(workingDocument)
+    , mMapWork(workingDocument->map())
+    , mMapRules(prototype.mMapRules)
+    , mLayerInputRegions(prototype.mLayerInputRegions)
+    , mLayerOutputRegions(prototype.mLayerOutputRegions)
+    , mInputRules(prototype.mInputRules)
+    , mRulesInput(prototype.mRulesInput)
+    , mRulesOutput(prototype.mRulesOutput)
+    , mOwnsRules(false)
+    , mCompiled(prototype.mCompiled)
+    , mRulePath(prototype.mRulePath)
+    , mDeleteTiles(prototype.mDeleteTiles)
+    , mAutoMappingRadius(prototype.mAutoMappingRadius)
+    , mNoOverlappingRules(prototype.mNoOverlappingRules)
+    , mUndoEnabled(true)
+    , mTouchedTileLayers(prototype.mTouchedTileLayers)
+    , mTouchedObjectGroups(prototype.mTouchedObjectGroups)
+    , mError(prototype.mError)
+    , mWarning(prototype.mWarning)
+{
+    // The layer indexes are corrected for the working map by
+    // prepareAutoMap()
+    foreach (const RuleOutput *translationTable, prototype.mLayerList)
+        mLayerList.append(new RuleOutput(*translationTable));
+}
+
 AutoMapper::~AutoMapper()
 {
     cleanUpRulesMap();
@@ -228,7 +260,7 @@ bool AutoMapper::setupRuleMapTileLayers()
                 mTouchedObjectGroups.insert(name);
 
             Layer::TypeFlag type = layer->layerType();
-            int layerIndex = mMapWork->indexOfLayer(name, type);
+            int layerIndex = mMapWork ? mMapWork->indexOfLayer(name, type) : -1;
 
             bool found = false;
             foreach (RuleOutput *translationTable, mLayerList) {
@@ -285,38 +317,49 @@ bool AutoMapper::setupRuleList()
     Q_ASSERT(mLayerInputRegions);
     Q_ASSERT(mLayerOutputRegions);
 
-    QList<QRegion> combinedRegions = coherentRegions(
-            mLayerInputRegions->region() +
-            mLayerOutputRegions->region());
+    const QRegion inputRegion = mLayerInputRegions->region();
+    const QRegion outputRegion = mLayerOutputRegions->region();
 
-    qSort(combinedRegions.begin(), combinedRegions.end(), compareRuleRegion);
+    QList<QRegion> combinedRegions = coherentRegions(inputRegion +
+                                                     outputRegion);
 
-    QList<QRegion> rulesInput = coherentRegions(
-            mLayerInputRegions->region());
+    qSort(combinedRegions.begin(), combinedRegions.end(), compareRuleRegion);
 
-    QList<QRegion> rulesOutput = coherentRegions(
-            mLayerOutputRegions->region());
+    const QList<QRegion> rulesInput = coherentRegions(inputRegion);
+    const QList<QRegion> rulesOutput = coherentRegions(outputRegion);
 
     for (int i = 0; i < combinedRegions.size(); ++i) {
         mRulesInput.append(QRegion());
         mRulesOutput.append(QRegion());
     }
 
-    foreach(QRegion reg, rulesInput)
-        for (int i = 0; i < combinedRegions.size(); ++i) {
-            if (reg.intersects(combinedRegions[i])) {
-                mRulesInput[i] += reg;
-                break;
-            }
-        }
+    // Every input and output region is contained within exactly one of the
+    // combined regions. Rasterize the rule index of each cell, so that this
+    // rule can be looked up directly instead of testing every combination.
+    const QRect bounds = (inputRegion | outputRegion).boundingRect();
+    QVector<int> ruleIndexes(bounds.width() * bounds.height(), -1);
 
-    foreach(QRegion reg, rulesOutput)
-        for (int i = 0; i < combinedRegions.size(); ++i) {
-            if (reg.intersects(combinedRegions[i])) {
-                mRulesOutput[i] += reg;
-                break;
+    for (int i = 0; i < combinedRegions.size(); ++i) {
+        foreach (const QRect &rect, combinedRegions.at(i).rects()) {
+            for (int y = rect.top(); y <= rect.bottom(); ++y) {
+                int *row = ruleIndexes.data() + (y - bounds.top()) * bounds.width();
+                for (int x = rect.left(); x <= rect.right(); ++x)
+                    row[x - bounds.left()] = i;
             }
         }
+    }
+
+    foreach (const QRegion &reg, rulesInput) {
+        const QPoint p = reg.rects().first().topLeft() - bounds.topLeft();
+        const int i = ruleIndexes.at(p.x() + p.y() * bounds.width());
+        mRulesInput[i] += reg;
+    }
+
+    foreach (const QRegion &reg, rulesOutput) {
+        const QPoint p = reg.rects().first().topLeft() - bounds.topLeft();
+        const int i = ruleIndexes.at(p.x() + p.y() * bounds.width());
+        mRulesOutput[i] += reg;
+    }
 
     Q_ASSERT(mRulesInput.size() == mRulesOutput.size());
     for (int i = 0; i < mRulesInput.size(); ++i) {
@@ -341,6 +384,11 @@ bool AutoMapper::prepareAutoMap()
     if (!setupTilesets(mMapRules, mMapWork))
         return false;
 
+    if (!mCompiled)
+        compileRules();
+
+    mAppliedRuleCounts.fill(0, mRulesInput.size());
+
     return true;
 }
 
@@ -424,18 +472,29 @@ bool AutoMapper::setupTilesets(Map *src, Map *dst)
         // Merge the tile properties
         const int sharedTileCount = qMin(tileset->tileCount(),
                                          replacement->tileCount());
+        QList<Object*> tiles;
+        QVector<Properties> tileProperties;
         for (int i = 0; i < sharedTileCount; ++i) {
             Tile *replacementTile = replacement->tileAt(i);
             Properties properties = replacementTile->properties();
             properties.merge(tileset->tileAt(i)->properties());
-
+            tiles.append(replacementTile);
+            tileProperties.append(properties);
+        }
+        if (!tiles.isEmpty())
             undoStack->push(new ChangeProperties(mMapDocument,
                                                  tr("Tile"),
-                                                 replacementTile,
-                                                 properties));
+                                                 tiles,
+                                                 tileProperties));
+        if (src == mMapRules && !mOwnsRules) {
+            detachRules();
+            src = mMapRules;
         }
         src->replaceTileset(tileset, replacement);
 
+        // The compiled rules refer to the tiles of the replaced tileset
+        mCompiled.clear();
+
         tilesetManager->addReference(replacement);
         tilesetManager->removeReference(tileset);
     }
@@ -445,6 +504,18 @@ bool AutoMapper::setupTilesets(Map *src, Map *dst)
 void AutoMapper::autoMap(QRegion *where)
 {
     Q_ASSERT(mRulesInput.size() == mRulesOutput.size());
+    Q_ASSERT(mCompiled);
+
+    // look up the layers to compare the input layers with once
+    const QStringList &setLayerNames = mCompiled->setLayerNames;
+    mSetLayers.fill(0, setLayerNames.size());
+    for (int i = 0; i < setLayerNames.size(); ++i) {
+        const int index = mMapWork->indexOfLayer(setLayerNames.at(i),
+                                                 Layer::TileLayerType);
+        if (index != -1)
+            mSetLayers[i] = mMapWork->layerAt(index)->asTileLayer();
+    }
+
     // first resize the active area
     if (mAutoMappingRadius) {
         QRegion region;
@@ -469,10 +540,12 @@ void AutoMapper::autoMap(QRegion *where)
                 TileLayer *dstTileLayer = dstLayer->asTileLayer();
                 if (dstTileLayer)
                     dstTileLayer->erase(region);
-                else
+                else if (mUndoEnabled)
                     eraseRegionObjectGroup(mMapDocument,
                                            dstLayer->asObjectGroup(),
                                            region);
+                else
+                    eraseRegionObjectGroup(dstLayer->asObjectGroup(), region);
             }
         }
     }
@@ -504,11 +577,6 @@ const QRegion AutoMapper::getSetLayersRegion()
     return result;
 }
 
-static bool compareLayerTo(const TileLayer *setLayer,
-                           const QVector<TileLayer*> &listYes,
-                           const QVector<TileLayer*> &listNo,
-                           const QRegion &ruleRegion, const QPoint &offset);
-
 QRect AutoMapper::applyRule(const int ruleIndex, const QRect &where)
 {
     QRect ret;
@@ -516,9 +584,9 @@ QRect AutoMapper::applyRule(const int ruleIndex, const QRect &where)
     if (mLayerList.isEmpty())
         return ret;
 
-    const QRegion ruleInput = mRulesInput.at(ruleIndex);
+    const CompiledRule &rule = mCompiled->rules.at(ruleIndex);
     const QRegion ruleOutput = mRulesOutput.at(ruleIndex);
-    QRect rbr = ruleInput.boundingRect();
+    const QRect rbr = rule.inputBounds;
 
     // Since the rule itself is translated, we need to adjust the borders of the
     // loops. Decrease the size at all sides by one: There must be at least one
@@ -540,22 +608,16 @@ QRect AutoMapper::applyRule(const int ruleIndex, const QRect &where)
 
     for (int y = minY; y <= maxY; ++y)
     for (int x = minX; x <= maxX; ++x) {
+        const QPoint offset(x, y);
         bool anymatch = false;
-        foreach (const QString &index, mInputRules.indexes) {
-            const InputIndex &ii = mInputRules[index];
-
+        foreach (const QVector<CompiledInputName> &inputs, rule.indexes) {
             bool allLayerNamesMatch = true;
-            foreach (const QString &name, ii.names) {
-                const int i = mMapWork->indexOfLayer(name, Layer::TileLayerType);
-                if (i == -1) {
+            foreach (const CompiledInputName &input, inputs) {
+                const TileLayer *setLayer = mSetLayers.at(input.setLayer);
+                if (!setLayer || !matches(input, setLayer,
+                                          rbr, offset)) {
                     allLayerNamesMatch = false;
-                } else {
-                    const TileLayer *setLayer = mMapWork->layerAt(i)->asTileLayer();
-                    allLayerNamesMatch &= compareLayerTo(setLayer,
-                                                         ii[name].listYes,
-                                                         ii[name].listNo,
-                                                         ruleInput,
-                                                         QPoint(x, y));
+                    break;
                 }
             }
             if (allLayerNamesMatch) {
@@ -573,6 +635,7 @@ QRect AutoMapper::applyRule(const int ruleIndex, const QRect &where)
             if (!mNoOverlappingRules) {
                 copyMapRegion(ruleOutput, QPoint(x, y), mLayerList.at(r));
                 ret = ret.united(rbr.translated(QPoint(x, y)));
+                ++mAppliedRuleCounts[ruleIndex];
                 continue;
             }
 
@@ -604,6 +667,7 @@ QRect AutoMapper::applyRule(const int ruleIndex, const QRect &where)
 
             copyMapRegion(ruleOutput, QPoint(x, y), mLayerList.at(r));
             ret = ret.united(rbr.translated(QPoint(x, y)));
+            ++mAppliedRuleCounts[ruleIndex];
             for (int i = 0; i < translationTable->size(); ++i) {
                 appliedRegions[i] +=
                         ruleRegionInLayer[i].translated(x, y);
@@ -614,26 +678,227 @@ QRect AutoMapper::applyRule(const int ruleIndex, const QRect &where)
     return ret;
 }
 
+static QPair<Tile*, int> cellKey(const Cell &cell)
+{
+    const int flags = (cell.flippedHorizontally ? 1 : 0) |
+                      (cell.flippedVertically ? 2 : 0) |
+                      (cell.flippedAntiDiagonally ? 4 : 0);
+    return qMakePair(cell.tile, flags);
+}
+
+static int symbolIn(const QHash<QPair<Tile*, int>, int> &symbols,
+                    const Cell &cell)
+{
+    QHash<QPair<Tile*, int>, int>::const_iterator it =
+            symbols.constFind(cellKey(cell));
+    return it == symbols.constEnd() ? -1 : it.value();
+}
+
+int AutoMapper::symbolOf(const Cell &cell) const
+{
+    return symbolIn(mCompiled->symbols, cell);
+}
+
 /**
- * Returns a list of all cells which can be found within all tile layers
- * within the given region.
+ * Orders the checks so that those accepting the fewest cells come first,
+ * and those that only reject cells come last.
  */
-static QVector<Cell> cellsInRegion(const QVector<TileLayer*> &list,
-                                   const QRegion &r)
+static bool moreSelective(const QPair<int, int> &a, const QPair<int, int> &b)
 {
-    QVector<Cell> cells;
-    foreach (const TileLayer *tilelayer, list) {
-        foreach (const QRect &rect, r.rects()) {
-            for (int x = rect.left(); x <= rect.right(); ++x) {
-                for (int y = rect.top(); y <= rect.bottom(); ++y) {
-                    const Cell &cell = tilelayer->cellAt(x, y);
-                    if (!cells.contains(cell))
-                        cells.append(cell);
+    return a.first < b.first;
+}
+
+void AutoMapper::compileRules()
+{
+    CompiledRules *compiled = new CompiledRules;
+    QHash<QPair<Tile*, int>, int> &symbols = compiled->symbols;
+    compiled->setLayerNames = mInputRules.names.toList();
+
+    // The empty cell always gets the first symbol, since it can be part of
+    // the cells found within a rule region
+    symbols.insert(cellKey(Cell()), 0);
+
+    foreach (const QString &index, mInputRules.indexes) {
+        const InputIndex &ii = mInputRules[index];
+        foreach (const QString &name, ii.names) {
+            const InputIndexName &lists = ii[name];
+            QVector<TileLayer*> layers = lists.listYes;
+            layers += lists.listNo;
+            foreach (const TileLayer *layer, layers) {
+                foreach (const QRegion &region, mRulesInput) {
+                    foreach (const QRect &rect, region.rects()) {
+                        for (int y = rect.top(); y <= rect.bottom(); ++y) {
+                            for (int x = rect.left(); x <= rect.right(); ++x) {
+                                if (!layer->contains(x, y))
+                                    continue;
+                                const QPair<Tile*, int> key =
+                                        cellKey(layer->cellAt(x, y));
+                                if (!symbols.contains(key))
+                                    symbols.insert(key, symbols.size());
+                            }
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    const int symbolCount = symbols.size();
+
+    foreach (const QRegion &region, mRulesInput) {
+        CompiledRule rule;
+        rule.inputBounds = region.boundingRect();
+
+        foreach (const QString &index, mInputRules.indexes) {
+            const InputIndex &ii = mInputRules[index];
+            QVector<CompiledInputName> inputs;
+            bool canMatch = true;
+
+            foreach (const QString &name, ii.names) {
+                const InputIndexName &lists = ii[name];
+
+                CompiledInputName input;
+                input.setLayer = compiled->setLayerNames.indexOf(name);
+                input.hasYes = !lists.listYes.isEmpty();
+                input.hasNo = !lists.listNo.isEmpty();
+
+                // Without any condition, a rule is assumed to be erroneous
+                if (!input.hasYes && !input.hasNo) {
+                    canMatch = false;
+                    break;
                 }
+
+                // Collect all cells, including the empty cell, found within
+                // the whole rule region for the exception in matches()
+                if (input.hasYes && !input.hasNo) {
+                    input.regionCells = QBitArray(symbolCount);
+                    foreach (const TileLayer *layer, lists.listYes) {
+                        foreach (const QRect &rect, region.rects()) {
+                            for (int y = rect.top(); y <= rect.bottom(); ++y) {
+                                for (int x = rect.left(); x <= rect.right(); ++x) {
+                                    if (layer->contains(x, y))
+                                        input.regionCells.setBit(
+                                                symbolIn(symbols, layer->cellAt(x, y)));
+                                }
+                            }
+                        }
+                    }
+                }
+
+                QVector<CompiledCellCheck> checks;
+                QVector<QPair<int, int> > order;
+
+                foreach (const QRect &rect, region.rects()) {
+                    for (int y = rect.top(); y <= rect.bottom(); ++y) {
+                        for (int x = rect.left(); x <= rect.right(); ++x) {
+                            CompiledCellCheck check;
+                            check.pos = QPoint(x, y);
+                            check.yes = QBitArray(symbolCount);
+                            check.no = QBitArray(symbolCount);
+                            check.yesDefined = false;
+                            bool noDefined = false;
+                            int yesCount = 0;
+
+                            foreach (const TileLayer *layer, lists.listYes) {
+                                if (!layer->contains(x, y)) {
+                                    canMatch = false;
+                                    continue;
+                                }
+                                const Cell &cell = layer->cellAt(x, y);
+                                if (cell.isEmpty())
+                                    continue;
+                                const int symbol = symbolIn(symbols, cell);
+                                if (!check.yes.testBit(symbol)) {
+                                    check.yes.setBit(symbol);
+                                    ++yesCount;
+                                }
+                                check.yesDefined = true;
+                            }
+                            foreach (const TileLayer *layer, lists.listNo) {
+                                if (!layer->contains(x, y)) {
+                                    canMatch = false;
+                                    continue;
+                                }
+                                const Cell &cell = layer->cellAt(x, y);
+                                if (cell.isEmpty())
+                                    continue;
+                                check.no.setBit(symbolIn(symbols, cell));
+                                noDefined = true;
+                            }
+
+                            // Leave out the positions where any cell is fine
+                            if (!check.yesDefined && !noDefined &&
+                                    (!input.hasYes || input.hasNo))
+                                continue;
+
+                            order.append(qMakePair(check.yesDefined ?
+                                                       yesCount :
+                                                       symbolCount + 1,
+                                                   checks.size()));
+                            checks.append(check);
+                        }
+                    }
+                }
+
+                std::stable_sort(order.begin(), order.end(), moreSelective);
+                input.checks.reserve(checks.size());
+                for (int i = 0; i < order.size(); ++i)
+                    input.checks.append(checks.at(order.at(i).second));
+
+                inputs.append(input);
             }
+
+            if (canMatch)
+                rule.indexes.append(inputs);
         }
+
+        compiled->rules.append(rule);
     }
-    return cells;
+
+    mCompiled = QSharedPointer<const CompiledRules>(compiled);
+}
+
+void AutoMapper::detachRules()
+{
+    if (mOwnsRules)
+        return;
+
+    Map *rules = new Map(*mMapRules);
+    TilesetManager::instance()->addReferences(rules->tilesets());
+
+    // Refer to the layers of the copy instead
+    QHash<Layer*, Layer*> layers;
+    for (int i = 0; i < mMapRules->layerCount(); ++i)
+        layers.insert(mMapRules->layerAt(i), rules->layerAt(i));
+
+    mLayerInputRegions = static_cast<TileLayer*>(
+                layers.value(mLayerInputRegions));
+    mLayerOutputRegions = static_cast<TileLayer*>(
+                layers.value(mLayerOutputRegions));
+
+    for (InputLayers::iterator it = mInputRules.begin();
+         it != mInputRules.end(); ++it) {
+        for (InputIndex::iterator jt = it->begin(); jt != it->end(); ++jt) {
+            for (int i = 0; i < jt->listYes.size(); ++i)
+                jt->listYes[i] = static_cast<TileLayer*>(
+                            layers.value(jt->listYes.at(i)));
+            for (int i = 0; i < jt->listNo.size(); ++i)
+                jt->listNo[i] = static_cast<TileLayer*>(
+                            layers.value(jt->listNo.at(i)));
+        }
+    }
+
+    foreach (RuleOutput *translationTable, mLayerList) {
+        RuleOutput translated;
+        translated.index = translationTable->index;
+        RuleOutput::const_iterator it = translationTable->constBegin();
+        for (; it != translationTable->constEnd(); ++it)
+            translated.insert(layers.value(it.key()), it.value());
+        *translationTable = translated;
+    }
+
+    mMapRules = rules;
+    mOwnsRules = true;
 }
 
 /**
@@ -696,94 +961,52 @@ static QVector<Cell> cellsInRegion(const QVector<TileLayer*> &list,
  * If all positions are considered good, return true.
  * return false otherwise.
  *
+ * The rules are compiled beforehand by compileRules(), so the cells are
+ * compared by their symbol against the bitsets of each position.
+ *
  * @return bool, if the tile layer matches the given list of layers.
  */
-static bool compareLayerTo(const TileLayer *setLayer,
-                           const QVector<TileLayer*> &listYes,
-                           const QVector<TileLayer*> &listNo,
-                           const QRegion &ruleRegion, const QPoint &offset)
+bool AutoMapper::matches(const CompiledInputName &input,
+                         const TileLayer *setLayer,
+                         const QRect &inputBounds,
+                         const QPoint &offset) const
 {
-    if (listYes.isEmpty() && listNo.isEmpty())
+    // All positions of the rule need to be within the set layer. Since the
+    // layer is rectangular, it is enough to check the corners of the bounds.
+    if (!inputBounds.isEmpty() &&
+            (!setLayer->contains(inputBounds.topLeft() + offset) ||
+             !setLayer->contains(inputBounds.bottomRight() + offset)))
         return false;
 
-    QVector<Cell> cells;
-    if (listYes.isEmpty())
-        cells = cellsInRegion(listNo, ruleRegion);
-    if (listNo.isEmpty())
-        cells = cellsInRegion(listYes, ruleRegion);
+    for (int i = 0, i_end = input.checks.size(); i < i_end; ++i) {
+        const CompiledCellCheck &check = input.checks.at(i);
+        const int symbol = symbolOf(setLayer->cellAt(check.pos + offset));
 
-    foreach (const QRect &rect, ruleRegion.rects()) {
-        for (int x = rect.left(); x <= rect.right(); ++x) {
-            for (int y = rect.top(); y <= rect.bottom(); ++y) {
-                // this is only used in the case where only one list has layers
-                // it is needed for the exception mentioned above
-                bool ruleDefinedListYes = false;
-
-                bool matchListYes = false;
-                bool matchListNo  = false;
-
-                if (!setLayer->contains(x + offset.x(), y + offset.y()))
-                    return false;
-
-                const Cell &c1 = setLayer->cellAt(x + offset.x(),
-                                                  y + offset.y());
-
-                // ruleDefined will be set when there is a tile in at least
-                // one layer. if there is a tile in at least one layer, only
-                // the given tiles in the different listYes layers are valid.
-                // if there is given no tile at all in the listYes layers,
-                // consider all tiles valid.
-
-                foreach (const TileLayer *comparedTileLayer, listYes) {
-
-                    if (!comparedTileLayer->contains(x, y))
-                        return false;
-
-                    const Cell &c2 = comparedTileLayer->cellAt(x, y);
-                    if (!c2.isEmpty())
-                        ruleDefinedListYes = true;
-
-                    if (!c2.isEmpty() && c1 == c2)
-                        matchListYes = true;
-                }
-                foreach (const TileLayer *comparedTileLayer, listNo) {
-
-                    if (!comparedTileLayer->contains(x, y))
-                        return false;
-
-                    const Cell &c2 = comparedTileLayer->cellAt(x, y);
-
-                    if (!c2.isEmpty() && c1 == c2)
-                        matchListNo = true;
-                }
+        const bool matchListYes = symbol != -1 && check.yes.testBit(symbol);
+        const bool matchListNo = symbol != -1 && check.no.testBit(symbol);
 
-                // when there are only layers in the listNo
-                // check only if these layers are unmatched
-                // no need to check explicitly the exception in this case.
-                if (listYes.isEmpty()) {
-                    if (matchListNo)
-                        return false;
-                    else
-                        continue;
-                }
-                // when there are only layers in the listYes
-                // check if these layers are matched, or if the exception works
-                if (listNo.isEmpty()) {
-                    if (matchListYes)
-                        continue;
-                    if (!ruleDefinedListYes && !cells.contains(c1))
-                        continue;
-                    return false;
-                }
+        // when there are only layers in the listNo
+        // check only if these layers are unmatched
+        if (!input.hasYes) {
+            if (matchListNo)
+                return false;
+            continue;
+        }
 
-                // there are layers in both lists:
-                // no need to consider ruleDefinedListXXX
-                if ((matchListYes || !ruleDefinedListYes) && !matchListNo)
-                    continue;
-                else
-                    return false;
-            }
+        // when there are only layers in the listYes
+        // check if these layers are matched, or if the exception works
+        if (!input.hasNo) {
+            if (matchListYes)
+                continue;
+            if (!check.yesDefined &&
+                    !(symbol != -1 && input.regionCells.testBit(symbol)))
+                continue;
+            return false;
         }
+
+        // there are layers in both lists
+        if (!((matchListYes || !check.yesDefined) && !matchListNo))
+            return false;
     }
     return true;
 }
@@ -860,7 +1083,10 @@ void AutoMapper::copyObjectRegion(ObjectGroup *srcLayer, int srcX, int srcY,
         clones.append(clone);
         clone->setX(clone->x() + pixelOffset.x());
         clone->setY(clone->y() + pixelOffset.y());
-        undo->push(new AddMapObject(mMapDocument, dstLayer, clone));
+        if (mUndoEnabled)
+            undo->push(new AddMapObject(mMapDocument, dstLayer, clone));
+        else
+            dstLayer->addObject(clone);
     }
 }
 
@@ -912,15 +1138,18 @@ void AutoMapper::cleanUpRulesMap()
     if (!mMapRules)
         return;
 
-    TilesetManager *tilesetManager = TilesetManager::instance();
-    tilesetManager->removeReferences(mMapRules->tilesets());
-
-    delete mMapRules;
+    // A shared rules map is owned by the prototype
+    if (mOwnsRules) {
+        TilesetManager *tilesetManager = TilesetManager::instance();
+        tilesetManager->removeReferences(mMapRules->tilesets());
+        delete mMapRules;
+    }
     mMapRules = 0;
 
     cleanUpRuleMapLayers();
     mRulesInput.clear();
     mRulesOutput.clear();
+    mCompiled.clear();
 }
 
 void AutoMapper::cleanUpRuleMapLayers()
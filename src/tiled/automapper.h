@@ -21,21 +21,28 @@
 #ifndef AUTOMAPPER_H
 #define AUTOMAPPER_H
 
+#include <QBitArray>
+#include <QHash>
 #include <QMap>
 #include <QList>
+#include <QPair>
 
 #include <QRegion>
 
 #include <QSet>
+#include <QSharedPointer>
 #include <QString>
+#include <QStringList>
 #include <QVector>
 
 namespace Tiled {
 
+class Cell;
 class Layer;
 class Map;
 class MapObject;
 class ObjectGroup;
+class Tile;
 class TileLayer;
 class Tileset;
 
@@ -69,6 +76,80 @@ public:
     QString index;
 };
 
+/**
+ * A single position of a compiled rule, describing which cells are accepted
+ * there. The cells are referred to by their symbol, see AutoMapper::symbolOf.
+ */
+class CompiledCellCheck
+{
+public:
+    QPoint pos;         // position within the rules map
+    QBitArray yes;      // cells found at this position in the input layers
+    QBitArray no;       // cells found at this position in the inputnot layers
+    bool yesDefined;    // whether any cell was found in the input layers
+};
+
+/**
+ * The checks of all input and inputnot layers with the same index and name,
+ * which are compared against the layer with that name in the working map.
+ */
+class CompiledInputName
+{
+public:
+    int setLayer;       // index into CompiledRules::setLayerNames
+    bool hasYes;        // whether there are input layers
+    bool hasNo;         // whether there are inputnot layers
+
+    /**
+     * All the cells, including empty ones, found in the input layers within
+     * the whole rule region. Used when there are no inputnot layers.
+     */
+    QBitArray regionCells;
+
+    /**
+     * The positions to check, most selective first so that mismatches are
+     * rejected early. Positions that accept any cell are left out.
+     */
+    QVector<CompiledCellCheck> checks;
+};
+
+/**
+ * A rule compiled for matching. The rule matches at a certain offset when
+ * all names of any of its input indexes match.
+ */
+class CompiledRule
+{
+public:
+    QRect inputBounds;
+    QVector<QVector<CompiledInputName> > indexes;
+};
+
+/**
+ * All rules of a rules map compiled for matching. They only depend on the
+ * rules map, so they are shared by the automappers using the same rules and
+ * never change once compiled.
+ */
+class CompiledRules
+{
+public:
+    /**
+     * The rules, with the same indexes as AutoMapper::mRulesInput.
+     */
+    QVector<CompiledRule> rules;
+
+    /**
+     * Maps each cell (tile and flip flags) used in the input layers to a
+     * symbol, which is the bit used for it in the compiled rules.
+     */
+    QHash<QPair<Tile*, int>, int> symbols;
+
+    /**
+     * The names of the layers of the working map that are compared against
+     * the input layers.
+     */
+    QStringList setLayerNames;
+};
+
 
 /**
  * This class does all the work for the automapping feature.
@@ -94,6 +175,18 @@ public:
      */
     AutoMapper(MapDocument *workingDocument, Map *rules, 
                const QString &rulePath);
+
+    /**
+     * Constructs an AutoMapper working on \a workingDocument, which shares
+     * the rules map and the compiled rules of \a prototype instead of setting
+     * them up again. The prototype needs to outlive this AutoMapper and its
+     * rules should be compiled already.
+     *
+     * The shared rules map is never changed. When the tilesets of the working
+     * map require changing it, this AutoMapper switches to its own copy.
+     */
+    AutoMapper(MapDocument *workingDocument, const AutoMapper &prototype);
+
     ~AutoMapper();
 
     /**
@@ -122,6 +215,21 @@ public:
      */
     void autoMap(QRegion *where);
 
+    /**
+     * Sets whether autoMap() adds and removes objects through the undo stack
+     * of the working document, which is the default. Without undo, autoMap()
+     * only changes the working map itself, so it may run on another thread
+     * than the one the working document lives in.
+     */
+    void setUndoEnabled(bool enabled) { mUndoEnabled = enabled; }
+
+    /**
+     * Compiles the input regions of all rules for matching. This is done by
+     * prepareAutoMap() when needed, but may be done up front on an AutoMapper
+     * that serves as a prototype for others.
+     */
+    void compileRules();
+
     /**
      * This cleans all datastructures, which are setup via prepareAutoMap,
      * so the auto mapper becomes ready for its next automatic mapping.
@@ -141,6 +249,17 @@ public:
      */
     QString warningString() const { return mWarning; }
 
+    /**
+     * Returns the file path of the rules map.
+     */
+    QString rulePath() const { return mRulePath; }
+
+    /**
+     * Returns for each rule how many times it was applied since the last
+     * call to prepareAutoMap().
+     */
+    const QVector<int> &appliedRuleCounts() const { return mAppliedRuleCounts; }
+
 private:
     /**
      * Reads the map properties of the rulesmap.
@@ -237,6 +356,25 @@ private:
      */
     QRect applyRule(const int ruleIndex, const QRect &where);
 
+    /**
+     * Switches from a rules map shared with the prototype to an own copy,
+     * before the rules map gets changed.
+     */
+    void detachRules();
+
+    /**
+     * Returns the symbol of the given cell, or -1 when this cell is not used
+     * in any of the input layers of the rules map.
+     */
+    int symbolOf(const Cell &cell) const;
+
+    /**
+     * Returns whether the compiled \a input matches the \a setLayer when the
+     * rule is translated by \a offset.
+     */
+    bool matches(const CompiledInputName &input, const TileLayer *setLayer,
+                 const QRect &inputBounds, const QPoint &offset) const;
+
     /**
      * Cleans up the data structes filled by setupRuleMapLayers(),
      * so the next rule can be processed.
@@ -314,6 +452,28 @@ private:
      */
     QList<QRegion> mRulesOutput;
 
+    /**
+     * Whether mMapRules is owned, rather than shared with a prototype.
+     */
+    bool mOwnsRules;
+
+    /**
+     * The compiled rules, which are null until compiled and whenever the
+     * rules map has changed since.
+     */
+    QSharedPointer<const CompiledRules> mCompiled;
+
+    /**
+     * How many times each rule was applied, see appliedRuleCounts().
+     */
+    QVector<int> mAppliedRuleCounts;
+
+    /**
+     * The layers compared against the input layers, as found at the start of
+     * autoMap(), by the index of their name in CompiledRules::setLayerNames.
+     */
+    QVector<const TileLayer*> mSetLayers;
+
     /**
      * The inner set with layers to indexes is needed for translating
      * tile layers from mMapRules to mMapWork.
@@ -354,6 +514,8 @@ private:
      */
     bool mNoOverlappingRules;
 
+    bool mUndoEnabled;
+
     QSet<QString> mTouchedTileLayers;
 
     QSet<QString> mTouchedObjectGroups;
@@ -110,7 +110,7 @@ void AutomappingManager::autoMapInternal(const QRegion &where,
         mError += automapper->errorString();
     }
 
-    mMapDocument->emitRegionChanged(*passedRegion);
+    mMapDocument->emitRegionChanged(*passedRegion, 0);
     delete passedRegion;
 
     if (!mWarning.isEmpty())
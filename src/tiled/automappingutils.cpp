@@ -47,6 +47,16 @@ void eraseRegionObjectGroup(MapDocument *mapDocument,
     }
 }
 
+void eraseRegionObjectGroup(ObjectGroup *layer, const QRegion &where)
+{
+    foreach (MapObject *obj, layer->objects()) {
+        if (where.intersects(obj->bounds().toAlignedRect())) {
+            layer->removeObject(obj);
+            delete obj;
+        }
+    }
+}
+
 QRegion tileRegionOfObjectGroup(ObjectGroup *layer)
 {
     QRegion ret;
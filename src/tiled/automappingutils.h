@@ -39,6 +39,12 @@ void eraseRegionObjectGroup(MapDocument *mapDocument,
                             ObjectGroup *layer,
                             const QRegion &where);
 
+/**
+ * Like the above, but removes and deletes the objects directly instead of
+ * going through the undo stack.
+ */
+void eraseRegionObjectGroup(ObjectGroup *layer, const QRegion &where);
+
 QRegion tileRegionOfObjectGroup(ObjectGroup *layer);
 
 } // namespace Internal
@@ -0,0 +1,325 @@
+/*
+ * batchautomapper.cpp
+ * Copyright 2015, Sydoria Games <luax@sydoria.fr>
+ *
+ * This file is part of Tiled.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "batchautomapper.h"
+
+#include "automapper.h"
+#include "map.h"
+#include "mapdocument.h"
+#include "tilesetmanager.h"
+#include "tmxmapreader.h"
+#include "tmxmapwriter.h"
+
+#include <QElapsedTimer>
+#include <QFile>
+#include <QFileInfo>
+#include <QMutex>
+#include <QRunnable>
+#include <QTextStream>
+#include <QThreadPool>
+#include <QVector>
+#include <QWaitCondition>
+
+#include <cstdio>
+
+namespace Tiled {
+namespace Internal {
+
+/**
+ * A queue of finished jobs, which is filled by the thread pool and emptied by
+ * the thread that runs the batch.
+ */
+class FinishedJobs
+{
+public:
+    void add(AutoMapJob *job)
+    {
+        QMutexLocker locker(&mMutex);
+        mJobs.append(job);
+        mJobAdded.wakeOne();
+    }
+
+    AutoMapJob *take()
+    {
+        QMutexLocker locker(&mMutex);
+        while (mJobs.isEmpty())
+            mJobAdded.wait(&mMutex);
+        return mJobs.takeFirst();
+    }
+
+private:
+    QMutex mMutex;
+    QWaitCondition mJobAdded;
+    QList<AutoMapJob*> mJobs;
+};
+
+/**
+ * Applies the automappers to their working map. Everything that needs the
+ * tileset manager, the undo stack or may affect other documents is done by
+ * prepare() and finish(), so that the job only touches its own map.
+ */
+class AutoMapJob : public QRunnable
+{
+public:
+    AutoMapJob()
+        : finishedJobs(0)
+        , mapDocument(0)
+        , prepareTime(0)
+        , autoMapTime(0)
+    {
+        setAutoDelete(false);
+    }
+
+    void run()
+    {
+        QElapsedTimer timer;
+        timer.start();
+
+        const Map *map = mapDocument->map();
+        QRegion where(0, 0, map->width(), map->height());
+        foreach (AutoMapper *autoMapper, autoMappers)
+            autoMapper->autoMap(&where);
+
+        autoMapTime = timer.elapsed();
+        finishedJobs->add(this);
+    }
+
+    FinishedJobs *finishedJobs;
+    QString fileName;
+    MapDocument *mapDocument;
+    QVector<AutoMapper*> autoMappers;
+    qint64 prepareTime;
+    qint64 autoMapTime;
+};
+
+} // namespace Internal
+} // namespace Tiled
+
+using namespace Tiled;
+using namespace Tiled::Internal;
+
+BatchAutomapper::BatchAutomapper()
+{
+}
+
+BatchAutomapper::~BatchAutomapper()
+{
+    qDeleteAll(mAutoMappers);
+}
+
+bool BatchAutomapper::loadRules(const QString &filePath)
+{
+    mError.clear();
+    return loadRulesFile(filePath);
+}
+
+/**
+ * Parses a rules file the same way as AutomappingManager::loadFile(), but
+ * sets up the automappers without a working document and compiles their
+ * rules right away.
+ */
+bool BatchAutomapper::loadRulesFile(const QString &filePath)
+{
+    bool ret = true;
+    const QString absPath = QFileInfo(filePath).path();
+    QFile rulesFile(filePath);
+
+    if (!rulesFile.exists()) {
+        mError += tr("No rules file found at:\n%1").arg(filePath)
+                  + QLatin1Char('\n');
+        return false;
+    }
+    if (!rulesFile.open(QIODevice::ReadOnly)) {
+        mError += tr("Error opening rules file:\n%1").arg(filePath)
+                  + QLatin1Char('\n');
+        return false;
+    }
+
+    QTextStream in(&rulesFile);
+    QString line = in.readLine();
+
+    for (; !line.isNull(); line = in.readLine()) {
+        QString rulePath = line.trimmed();
+        if (rulePath.isEmpty()
+                || rulePath.startsWith(QLatin1Char('#'))
+                || rulePath.startsWith(QLatin1String("//")))
+            continue;
+
+        if (QFileInfo(rulePath).isRelative())
+            rulePath = absPath + QLatin1Char('/') + rulePath;
+
+        if (!QFileInfo(rulePath).exists()) {
+            mError += tr("File not found:\n%1").arg(rulePath) + QLatin1Char('\n');
+            ret = false;
+            continue;
+        }
+        if (rulePath.endsWith(QLatin1String(".tmx"), Qt::CaseInsensitive)) {
+            TmxMapReader mapReader;
+
+            Map *rules = mapReader.read(rulePath);
+
+            if (!rules) {
+                mError += tr("Opening rules map failed:\n%1").arg(
+                        mapReader.errorString()) + QLatin1Char('\n');
+                ret = false;
+                continue;
+            }
+
+            TilesetManager::instance()->addReferences(rules->tilesets());
+            AutoMapper *autoMapper = new AutoMapper(0, rules, rulePath);
+
+            if (!autoMapper->errorString().isEmpty()) {
+                mError += autoMapper->errorString();
+                delete autoMapper;
+                ret = false;
+                continue;
+            }
+
+            autoMapper->compileRules();
+            mAutoMappers.append(autoMapper);
+        }
+        if (rulePath.endsWith(QLatin1String(".txt"), Qt::CaseInsensitive)) {
+            if (!loadRulesFile(rulePath))
+                ret = false;
+        }
+    }
+    return ret;
+}
+
+int BatchAutomapper::run(const QStringList &fileNames)
+{
+    QThreadPool *threadPool = QThreadPool::globalInstance();
+    FinishedJobs finishedJobs;
+
+    // Limit the amount of maps in memory at the same time
+    const int maxPendingJobs = threadPool->maxThreadCount() * 2;
+    int pendingJobs = 0;
+    int failures = 0;
+
+    foreach (const QString &fileName, fileNames) {
+        while (pendingJobs >= maxPendingJobs) {
+            if (!finish(finishedJobs.take()))
+                ++failures;
+            --pendingJobs;
+        }
+
+        AutoMapJob *job = prepare(fileName);
+        if (!job) {
+            ++failures;
+            continue;
+        }
+
+        job->finishedJobs = &finishedJobs;
+        threadPool->start(job);
+        ++pendingJobs;
+    }
+
+    while (pendingJobs > 0) {
+        if (!finish(finishedJobs.take()))
+            ++failures;
+        --pendingJobs;
+    }
+
+    return failures;
+}
+
+/**
+ * Loads the map and sets up the automappers for it. This happens on the
+ * calling thread, since it creates pixmaps for the tilesets and registers
+ * them with the tileset manager.
+ */
+AutoMapJob *BatchAutomapper::prepare(const QString &fileName)
+{
+    QElapsedTimer timer;
+    timer.start();
+
+    TmxMapReader reader;
+    Map *map = reader.read(fileName);
+    if (!map) {
+        qWarning("%s: %s", qPrintable(fileName),
+                 qPrintable(reader.errorString()));
+        return 0;
+    }
+
+    AutoMapJob *job = new AutoMapJob;
+    job->fileName = fileName;
+    job->mapDocument = new MapDocument(map, fileName);
+
+    foreach (const AutoMapper *prototype, mAutoMappers) {
+        AutoMapper *autoMapper = new AutoMapper(job->mapDocument, *prototype);
+        autoMapper->setUndoEnabled(false);
+
+        if (autoMapper->prepareAutoMap()) {
+            job->autoMappers.append(autoMapper);
+            continue;
+        }
+
+        qWarning("%s: %s", qPrintable(fileName),
+                 qPrintable(autoMapper->errorString()));
+        delete autoMapper;
+    }
+
+    job->prepareTime = timer.elapsed();
+    return job;
+}
+
+/**
+ * Cleans up after the automappers, saves the map and reports on it. Takes
+ * ownership of the \a job.
+ */
+bool BatchAutomapper::finish(AutoMapJob *job)
+{
+    QElapsedTimer timer;
+    timer.start();
+
+    QTextStream out(stdout);
+    QString fired;
+
+    foreach (AutoMapper *autoMapper, job->autoMappers) {
+        autoMapper->cleanAll();
+
+        const QVector<int> &counts = autoMapper->appliedRuleCounts();
+        for (int i = 0; i < counts.size(); ++i) {
+            if (counts.at(i) == 0)
+                continue;
+            fired += QString(QLatin1String("    %1 rule %2: %3\n"))
+                    .arg(autoMapper->rulePath()).arg(i).arg(counts.at(i));
+        }
+    }
+
+    TmxMapWriter writer;
+    const bool success = writer.write(job->mapDocument->map(), job->fileName);
+    if (!success)
+        qWarning("%s: %s", qPrintable(job->fileName),
+                 qPrintable(writer.errorString()));
+
+    out << tr("%1: loaded in %2 ms, automapped in %3 ms, saved in %4 ms")
+           .arg(job->fileName)
+           .arg(job->prepareTime)
+           .arg(job->autoMapTime)
+           .arg(timer.elapsed()) << '\n' << fired;
+    out.flush();
+
+    qDeleteAll(job->autoMappers);
+    delete job->mapDocument;
+    delete job;
+
+    return success;
+}
@@ -0,0 +1,92 @@
+/*
+ * batchautomapper.h
+ * Copyright 2015, Sydoria Games <luax@sydoria.fr>
+ *
+ * This file is part of Tiled.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef BATCHAUTOMAPPER_H
+#define BATCHAUTOMAPPER_H
+
+#include <QCoreApplication>
+#include <QList>
+#include <QString>
+#include <QStringList>
+
+namespace Tiled {
+namespace Internal {
+
+class AutoMapJob;
+class AutoMapper;
+
+/**
+ * Applies automapping rules to many maps without the editor, as done by the
+ * --automap command line option.
+ *
+ * The rules file and the rule maps it lists are read and compiled only once.
+ * Each map is then loaded and prepared on the calling thread, with
+ * automappers sharing the compiled rules. The actual matching of the rules
+ * runs on the global thread pool, one working document per job. It changes
+ * the working map directly rather than through the undo stack, so the job
+ * doesn't touch the objects living on the calling thread. The results are
+ * written back to the map files.
+ */
+class BatchAutomapper
+{
+    Q_DECLARE_TR_FUNCTIONS(BatchAutomapper)
+
+public:
+    BatchAutomapper();
+    ~BatchAutomapper();
+
+    /**
+     * Loads the rules file at \a filePath, along with all the rule maps and
+     * rules files it refers to.
+     *
+     * @return whether all rules could be loaded
+     */
+    bool loadRules(const QString &filePath);
+
+    /**
+     * Applies the loaded rules to each of the given map files and saves
+     * them. The time taken for each map and the rules that were applied are
+     * written to the standard output.
+     *
+     * @return the number of maps that could not be processed
+     */
+    int run(const QStringList &fileNames);
+
+    QString errorString() const { return mError; }
+
+private:
+    bool loadRulesFile(const QString &filePath);
+
+    AutoMapJob *prepare(const QString &fileName);
+    bool finish(AutoMapJob *job);
+
+    /**
+     * An automapper with compiled rules for each rule map. They serve as
+     * prototypes for the automappers of each job, which share their rules.
+     */
+    QList<AutoMapper*> mAutoMappers;
+
+    QString mError;
+};
+
+} // namespace Internal
+} // namespace Tiled
+
+#endif // BATCHAUTOMAPPER_H
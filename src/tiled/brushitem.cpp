@@ -84,6 +84,16 @@ void BrushItem::setTileLayerPosition(const QPoint &pos)
     updateBoundingRect();
 }
 
+void BrushItem::setTileLayerCell(int x, int y, const Cell &cell)
+{
+    if (!mTileLayer)
+        return;
+
+    mTileLayer->setCell(x, y, cell);
+    updateBoundingRect();
+    update();
+}
+
 void BrushItem::setTileRegion(const QRegion &region)
 {
     if (mRegion == region)
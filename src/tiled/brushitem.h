@@ -26,6 +26,7 @@
 
 namespace Tiled {
 
+class Cell;
 class TileLayer;
 
 namespace Internal {
@@ -68,6 +69,13 @@ public:
      */
     void setTileLayerPosition(const QPoint &pos);
 
+    /**
+     * Changes a single cell of the tile layer, if one is set. Unlike
+     * setTileLayer(), this doesn't copy the whole layer. The cell at the
+     * given local coordinates should not be empty before or after.
+     */
+    void setTileLayerCell(int x, int y, const Cell &cell);
+
     /**
      * Sets the region of tiles that this brush item occupies.
      */
@@ -248,7 +248,7 @@ void BucketFillTool::makeConnections()
         return;
 
     // Overlay may need to be cleared if a region changed
-    connect(mapDocument(), SIGNAL(regionChanged(QRegion)),
+    connect(mapDocument(), SIGNAL(regionChanged(QRegion,Layer*)),
             this, SLOT(clearOverlay()));
 
     // Overlay needs to be cleared if we switch to another layer
@@ -266,7 +266,7 @@ void BucketFillTool::clearConnections(MapDocument *mapDocument)
     if (!mapDocument)
         return;
 
-    disconnect(mapDocument, SIGNAL(regionChanged(QRegion)),
+    disconnect(mapDocument, SIGNAL(regionChanged(QRegion,Layer*)),
                this, SLOT(clearOverlay()));
 
     disconnect(mapDocument, SIGNAL(currentLayerIndexChanged(int)),
@@ -27,14 +27,37 @@
 using namespace Tiled;
 using namespace Tiled::Internal;
 
+/*
+ * The commands in this file change the properties of all their objects in a
+ * single pass, so that the document only reports the change once. Except for
+ * ChangeProperties, they apply their change to the current properties of each
+ * object, since a command may be part of a macro in which the same objects
+ * change more than once.
+ */
+
 ChangeProperties::ChangeProperties(MapDocument *mapDocument,
                                    const QString &kind,
                                    Object *object,
                                    const Properties &newProperties)
     : mMapDocument(mapDocument)
-    , mObject(object)
+{
+    mObjects.append(object);
+    mNewProperties.append(newProperties);
+
+    setText(QCoreApplication::translate("Undo Commands",
+                                        "Change %1 Properties").arg(kind));
+}
+
+ChangeProperties::ChangeProperties(MapDocument *mapDocument,
+                                   const QString &kind,
+                                   const QList<Object*> &objects,
+                                   const QVector<Properties> &newProperties)
+    : mMapDocument(mapDocument)
+    , mObjects(objects)
     , mNewProperties(newProperties)
 {
+    Q_ASSERT(objects.size() == newProperties.size());
+
     setText(QCoreApplication::translate("Undo Commands",
                                         "Change %1 Properties").arg(kind));
 }
@@ -51,8 +74,12 @@ void ChangeProperties::undo()
 
 void ChangeProperties::swapProperties()
 {
-    const Properties oldProperties = mObject->properties();
-    mMapDocument->setProperties(mObject, mNewProperties);
+    QVector<Properties> oldProperties;
+    oldProperties.reserve(mObjects.size());
+    foreach (Object *object, mObjects)
+        oldProperties.append(object->properties());
+
+    mMapDocument->setProperties(mObjects, mNewProperties);
     mNewProperties = oldProperties;
 }
 
@@ -66,8 +93,33 @@ SetProperty::SetProperty(MapDocument *mapDocument,
     , mMapDocument(mapDocument)
     , mObjects(objects)
     , mName(name)
-    , mValue(value)
 {
+    for (int i = 0; i < mObjects.size(); ++i)
+        mValues.append(value);
+
+    init();
+}
+
+SetProperty::SetProperty(MapDocument *mapDocument,
+                         const QList<Object*> &objects,
+                         const QString &name,
+                         const QStringList &values,
+                         QUndoCommand *parent)
+    : QUndoCommand(parent)
+    , mMapDocument(mapDocument)
+    , mObjects(objects)
+    , mName(name)
+    , mValues(values)
+{
+    Q_ASSERT(objects.size() == values.size());
+
+    init();
+}
+
+void SetProperty::init()
+{
+    mProperties.reserve(mObjects.size());
+
     foreach (Object *obj, mObjects) {
         ObjectProperty prop;
         prop.existed = obj->hasProperty(mName);
@@ -83,18 +135,33 @@ SetProperty::SetProperty(MapDocument *mapDocument,
 
 void SetProperty::undo()
 {
+    QVector<Properties> properties;
+    properties.reserve(mObjects.size());
+
     for (int i = 0; i < mObjects.size(); ++i) {
-        if (mProperties[i].existed)
-            mMapDocument->setProperty(mObjects[i], mName, mProperties[i].previousValue);
+        Properties objectProperties = mObjects.at(i)->properties();
+        if (mProperties.at(i).existed)
+            objectProperties.insert(mName, mProperties.at(i).previousValue);
         else
-            mMapDocument->removeProperty(mObjects[i], mName);
+            objectProperties.remove(mName);
+        properties.append(objectProperties);
     }
+
+    mMapDocument->setProperties(mObjects, properties);
 }
 
 void SetProperty::redo()
 {
-    foreach (Object *obj, mObjects)
-        mMapDocument->setProperty(obj, mName, mValue);
+    QVector<Properties> properties;
+    properties.reserve(mObjects.size());
+
+    for (int i = 0; i < mObjects.size(); ++i) {
+        Properties objectProperties = mObjects.at(i)->properties();
+        objectProperties.insert(mName, mValues.at(i));
+        properties.append(objectProperties);
+    }
+
+    mMapDocument->setProperties(mObjects, properties);
 }
 
 
@@ -107,22 +174,44 @@ RemoveProperty::RemoveProperty(MapDocument *mapDocument,
     , mObjects(objects)
     , mName(name)
 {
-    foreach (Object *obj, mObjects)
+    mPreviousValues.reserve(mObjects.size());
+    mExisted.reserve(mObjects.size());
+
+    foreach (Object *obj, mObjects) {
         mPreviousValues.append(obj->property(mName));
+        mExisted.append(obj->hasProperty(mName));
+    }
 
     setText(QCoreApplication::translate("Undo Commands", "Remove Property"));
 }
 
 void RemoveProperty::undo()
 {
-    for (int i = 0; i < mObjects.size(); ++i)
-        mMapDocument->setProperty(mObjects[i], mName, mPreviousValues[i]);
+    QVector<Properties> properties;
+    properties.reserve(mObjects.size());
+
+    for (int i = 0; i < mObjects.size(); ++i) {
+        Properties objectProperties = mObjects.at(i)->properties();
+        if (mExisted.at(i))
+            objectProperties.insert(mName, mPreviousValues.at(i));
+        properties.append(objectProperties);
+    }
+
+    mMapDocument->setProperties(mObjects, properties);
 }
 
 void RemoveProperty::redo()
 {
-    foreach (Object *obj, mObjects)
-        mMapDocument->removeProperty(obj, mName);
+    QVector<Properties> properties;
+    properties.reserve(mObjects.size());
+
+    foreach (Object *obj, mObjects) {
+        Properties objectProperties = obj->properties();
+        objectProperties.remove(mName);
+        properties.append(objectProperties);
+    }
+
+    mMapDocument->setProperties(mObjects, properties);
 }
 
 
@@ -133,19 +222,22 @@ RenameProperty::RenameProperty(MapDocument *mapDocument,
 {
     setText(QCoreApplication::translate("Undo Commands", "Rename Property"));
 
-    // Remove the old name from all objects
-    new RemoveProperty(mapDocument, objects, oldName, this);
-
     // Different objects may have different values for the same property,
     // or may not have a value at all.
+    QList<Object*> objectsWithProperty;
+    QStringList values;
+
     foreach (Object *object, objects) {
         if (!object->hasProperty(oldName))
             continue;
 
-        QList<Object*> objects;
-        objects.append(object);
-
-        const QString value = object->property(oldName);
-        new SetProperty(mapDocument, objects, newName, value, this);
+        objectsWithProperty.append(object);
+        values.append(object->property(oldName));
     }
+
+    // Remove the old name from all objects
+    new RemoveProperty(mapDocument, objects, oldName, this);
+
+    if (!objectsWithProperty.isEmpty())
+        new SetProperty(mapDocument, objectsWithProperty, newName, values, this);
 }
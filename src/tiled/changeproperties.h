@@ -23,7 +23,9 @@
 
 #include "object.h"
 
+#include <QList>
 #include <QString>
+#include <QStringList>
 #include <QUndoCommand>
 #include <QVector>
 
@@ -47,6 +49,21 @@ public:
                      const QString &kind,
                      Object *object,
                      const Properties &newProperties);
+
+    /**
+     * Constructs a new 'Change Properties' command that replaces the
+     * properties of many objects at once, as a single undo step.
+     *
+     * @param mapDocument  the map document of the objects' map
+     * @param kind         the kind of properties (Map, Layer, Object, etc.)
+     * @param objects      the objects of which the properties should be changed
+     * @param newProperties the new properties for each of the \a objects
+     */
+    ChangeProperties(MapDocument *mapDocument,
+                     const QString &kind,
+                     const QList<Object*> &objects,
+                     const QVector<Properties> &newProperties);
+
     void undo();
     void redo();
 
@@ -54,8 +71,8 @@ private:
     void swapProperties();
 
     MapDocument *mMapDocument;
-    Object *mObject;
-    Properties mNewProperties;
+    QList<Object*> mObjects;
+    QVector<Properties> mNewProperties;
 };
 
 class SetProperty : public QUndoCommand
@@ -75,10 +92,27 @@ public:
                 const QString &value,
                 QUndoCommand *parent = 0);
 
+    /**
+     * Constructs a new 'Set Property' command that gives each of the
+     * \a objects its own value, like when numbering a range of tiles.
+     *
+     * @param mapDocument  the map document of the objects' map
+     * @param objects      the objects of which the property should be changed
+     * @param name         the name of the property to be changed
+     * @param values       the new value of the property for each object
+     */
+    SetProperty(MapDocument *mapDocument,
+                const QList<Object*> &objects,
+                const QString &name,
+                const QStringList &values,
+                QUndoCommand *parent = 0);
+
     void undo();
     void redo();
 
 private:
+    void init();
+
     struct ObjectProperty {
         QString previousValue;
         bool existed;
@@ -87,7 +121,7 @@ private:
     MapDocument *mMapDocument;
     QList<Object*> mObjects;
     QString mName;
-    QString mValue;
+    QStringList mValues;
 };
 
 class RemoveProperty : public QUndoCommand
@@ -112,6 +146,7 @@ private:
     MapDocument *mMapDocument;
     QList<Object*> mObjects;
     QVector<QString> mPreviousValues;
+    QVector<bool> mExisted;
     QString mName;
 };
 
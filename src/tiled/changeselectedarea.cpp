@@ -31,23 +31,25 @@ ChangeSelectedArea::ChangeSelectedArea(MapDocument *mapDocument,
     : QUndoCommand(QCoreApplication::translate("Undo Commands",
                                                "Change Selection"))
     , mMapDocument(mapDocument)
-    , mSelection(newSelection)
+    , mDelta(newSelection.xored(mapDocument->selectedArea()))
 {
 }
 
 void ChangeSelectedArea::undo()
 {
-    swapSelection();
+    toggleDelta();
 }
 
 void ChangeSelectedArea::redo()
 {
-    swapSelection();
+    toggleDelta();
 }
 
-void ChangeSelectedArea::swapSelection()
+/**
+ * Since the selection only changes through this command, xoring the delta
+ * with the current selection alternates between the old and new selection.
+ */
+void ChangeSelectedArea::toggleDelta()
 {
-    const QRegion oldSelection = mMapDocument->selectedArea();
-    mMapDocument->setSelectedArea(mSelection);
-    mSelection = oldSelection;
+    mMapDocument->setSelectedArea(mMapDocument->selectedArea().xored(mDelta));
 }
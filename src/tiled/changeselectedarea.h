@@ -29,6 +29,11 @@ namespace Internal {
 
 class MapDocument;
 
+/**
+ * Changes the selected area. Rather than both the old and the new
+ * selection, only the tiles that change their selected state are stored.
+ * This is usually a small part of the selection on large maps.
+ */
 class ChangeSelectedArea: public QUndoCommand
 {
 public:
@@ -43,10 +48,10 @@ public:
     void redo();
 
 private:
-    void swapSelection();
+    void toggleDelta();
 
     MapDocument *mMapDocument;
-    QRegion mSelection;
+    QRegion mDelta;
 };
 
 } // namespace Internal
@@ -3,6 +3,7 @@
 #include "mapdocument.h"
 #include "objectgroup.h"
 #include "tile.h"
+#include "tilesetmanager.h"
 
 #include <QCoreApplication>
 
@@ -28,6 +29,7 @@ ChangeTileObjectGroup::~ChangeTileObjectGroup()
 void ChangeTileObjectGroup::swap()
 {
     mObjectGroup = mTile->swapObjectGroup(mObjectGroup);
+    TilesetManager::instance()->collisionCache()->invalidate(mTile);
     mMapDocument->emitTileObjectGroupChanged(mTile);
 }
 
@@ -22,6 +22,7 @@
 #include "documentmanager.h"
 
 #include "abstracttool.h"
+#include "editjournal.h"
 #include "filesystemwatcher.h"
 #include "map.h"
 #include "mapdocument.h"
@@ -30,6 +31,7 @@
 #include "mapview.h"
 #include "movabletabwidget.h"
 #include "pluginmanager.h"
+#include "preferences.h"
 #include "tmxmapreader.h"
 #include "zoomable.h"
 
@@ -259,6 +261,9 @@ void DocumentManager::addDocument(MapDocument *mapDocument)
     mDocuments.append(mapDocument);
     mUndoGroup->addStack(mapDocument->undoStack());
 
+    // The journal is owned by the document
+    new EditJournal(mapDocument);
+
     if (!mapDocument->fileName().isEmpty())
         mFileSystemWatcher->addPath(mapDocument->fileName());
 
@@ -271,7 +276,11 @@ void DocumentManager::addDocument(MapDocument *mapDocument)
 
     const int documentIndex = mDocuments.size() - 1;
 
-    mTabWidget->addTab(container, mapDocument->displayName());
+    QString tabText = mapDocument->displayName();
+    if (mapDocument->isModified()) // only when recovered
+        tabText.prepend(QLatin1Char('*'));
+
+    mTabWidget->addTab(container, tabText);
     mTabWidget->setTabToolTip(documentIndex, mapDocument->fileName());
     connect(mapDocument, SIGNAL(fileNameChanged(QString,QString)),
             SLOT(fileNameChanged(QString,QString)));
@@ -300,6 +309,7 @@ void DocumentManager::closeDocumentAt(int index)
 
     QWidget *mapViewContainer = mTabWidget->widget(index);
     mDocuments.removeAt(index);
+    mRecentDocuments.removeOne(mapDocument);
     mTabWidget->removeTab(index);
     delete mapViewContainer;
 
@@ -377,8 +387,16 @@ void DocumentManager::currentIndexChanged()
 
     MapDocument *mapDocument = currentDocument();
 
-    if (mapDocument)
+    if (mapDocument) {
+        // Restore the document before anybody gets to see it
+        mapDocument->wakeUp();
+        viewForDocument(mapDocument)->mapScene()->wakeUp();
+
+        mRecentDocuments.removeOne(mapDocument);
+        mRecentDocuments.prepend(mapDocument);
+
         mUndoGroup->setActiveStack(mapDocument->undoStack());
+    }
 
     emit currentDocumentChanged(mapDocument);
 
@@ -387,6 +405,36 @@ void DocumentManager::currentIndexChanged()
         mapScene->enableSelectedTool();
         mSceneWithTool = mapScene;
     }
+
+    hibernateInactiveDocuments();
+}
+
+/**
+ * Hibernates the least recently used documents once the tile layers of the
+ * inactive documents take more memory than the configured threshold. Their
+ * scenes are cleared as well, since the items can be recreated from the map.
+ */
+void DocumentManager::hibernateInactiveDocuments()
+{
+    const int threshold = Preferences::instance()->hibernationThreshold();
+    if (threshold <= 0)
+        return;
+
+    const qint64 budget = qint64(threshold) * 1024 * 1024;
+    const MapDocument *current = currentDocument();
+    qint64 usage = 0;
+
+    foreach (MapDocument *mapDocument, mRecentDocuments) {
+        if (mapDocument == current)
+            continue;
+
+        usage += mapDocument->tileMemoryUsage();
+        if (usage <= budget)
+            continue;
+
+        viewForDocument(mapDocument)->mapScene()->hibernate();
+        mapDocument->hibernate();
+    }
 }
 
 void DocumentManager::setSelectedTool(AbstractTool *tool)
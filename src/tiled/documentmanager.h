@@ -199,8 +199,16 @@ private:
     DocumentManager(QObject *parent = 0);
     ~DocumentManager();
 
+    void hibernateInactiveDocuments();
+
     QList<MapDocument*> mDocuments;
 
+    /**
+     * The documents in the order they were last activated, most recent
+     * first. Determines which documents are hibernated first.
+     */
+    QList<MapDocument*> mRecentDocuments;
+
     MovableTabWidget *mTabWidget;
     QUndoGroup *mUndoGroup;
     AbstractTool *mSelectedTool;
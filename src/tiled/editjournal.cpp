@@ -0,0 +1,1224 @@
+/*
+ * editjournal.cpp
+ * Copyright 2015, Sydoria Games <luax@sydoria.fr>
+ *
+ * This file is part of Tiled.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "editjournal.h"
+
+#include "gidmapper.h"
+#include "imagelayer.h"
+#include "map.h"
+#include "mapdocument.h"
+#include "mapobject.h"
+#include "objectgroup.h"
+#include "terrain.h"
+#include "tile.h"
+#include "tilelayer.h"
+#include "tileset.h"
+#include "tmxmapreader.h"
+#include "tmxmapwriter.h"
+
+#include <QCryptographicHash>
+#include <QDataStream>
+#include <QDateTime>
+#include <QDir>
+#include <QFileInfo>
+#include <QVector>
+
+#if QT_VERSION >= 0x050000
+#include <QStandardPaths>
+#else
+#include <QDesktopServices>
+#endif
+
+using namespace Tiled;
+using namespace Tiled::Internal;
+
+static const quint32 journalMagic = 0x544a4e4c; // "TJNL"
+static const quint32 journalVersion = 2;
+static const int streamVersion = QDataStream::Qt_4_6;
+
+enum RecordType {
+    CheckpointRecord = 1,
+    TileRecord = 2,
+    LayerAddedRecord = 3,
+    LayerRemovedRecord = 4,
+    LayerRecord = 5,
+    ObjectRecord = 6,
+    ObjectRemovedRecord = 7,
+    ObjectOrderRecord = 8,
+    PropertiesRecord = 9,
+    TileAttributesRecord = 10,
+    TilesetRecord = 11
+};
+
+/**
+ * The time in milliseconds the document has to be left alone before a
+ * pending checkpoint is written.
+ */
+static const int checkpointDelay = 2000;
+
+/**
+ * The amount of records after which the journal is compacted.
+ */
+static const qint64 maxBytesSinceCheckpoint = 4 * 1024 * 1024;
+
+/**
+ * The journal applies to a file only as long as that file is unchanged.
+ */
+static void writeHeader(QDataStream &out, const QString &fileName)
+{
+    const QFileInfo fileInfo(fileName);
+    out << journalMagic << journalVersion
+        << fileInfo.absoluteFilePath() << fileInfo.lastModified();
+}
+
+static bool readHeader(QDataStream &in, const QString &fileName)
+{
+    quint32 magic;
+    quint32 version;
+    QString filePath;
+    QDateTime lastModified;
+    in >> magic >> version >> filePath >> lastModified;
+
+    const QFileInfo fileInfo(fileName);
+    return in.status() == QDataStream::Ok
+            && magic == journalMagic
+            && version == journalVersion
+            && filePath == fileInfo.absoluteFilePath()
+            && lastModified == fileInfo.lastModified();
+}
+
+/**
+ * Writes the cells of \a tileLayer within \a region as rows of global tile
+ * IDs. The region is in map coordinates.
+ */
+static void writeCells(QDataStream &out, const TileLayer *tileLayer,
+                       const QRegion &region, const GidMapper &gidMapper)
+{
+    const QVector<QRect> rects = (region & tileLayer->bounds()).rects();
+    out << qint32(rects.size());
+
+    foreach (const QRect &rect, rects) {
+        out << qint32(rect.x()) << qint32(rect.y())
+            << qint32(rect.width()) << qint32(rect.height());
+
+        for (int y = rect.top(); y <= rect.bottom(); ++y) {
+            for (int x = rect.left(); x <= rect.right(); ++x) {
+                const Cell &cell = tileLayer->cellAt(x - tileLayer->x(),
+                                                     y - tileLayer->y());
+                out << quint32(gidMapper.cellToGid(cell));
+            }
+        }
+    }
+}
+
+/**
+ * Reads cells written by writeCells() and applies them to \a tileLayer, when
+ * given. Returns false when they are incomplete.
+ */
+static bool readCells(QDataStream &in, TileLayer *tileLayer,
+                      const GidMapper &gidMapper)
+{
+    qint32 rectCount;
+    in >> rectCount;
+
+    QVector<QRect> rects;
+    QVector<quint32> gids;
+
+    for (int i = 0; i < rectCount && in.status() == QDataStream::Ok; ++i) {
+        qint32 x, y, width, height;
+        in >> x >> y >> width >> height;
+        rects.append(QRect(x, y, width, height));
+
+        const int count = qMax(0, width) * qMax(0, height);
+        for (int j = 0; j < count && in.status() == QDataStream::Ok; ++j) {
+            quint32 gid;
+            in >> gid;
+            gids.append(gid);
+        }
+    }
+
+    if (in.status() != QDataStream::Ok || rectCount < 0)
+        return false;
+
+    if (!tileLayer)
+        return true;
+
+    int index = 0;
+
+    foreach (const QRect &rect, rects) {
+        for (int y = rect.top(); y <= rect.bottom(); ++y) {
+            for (int x = rect.left(); x <= rect.right(); ++x) {
+                bool ok;
+                const Cell cell = gidMapper.gidToCell(gids.at(index++), ok);
+                const int localX = x - tileLayer->x();
+                const int localY = y - tileLayer->y();
+                if (ok && tileLayer->contains(localX, localY))
+                    tileLayer->setCell(localX, localY, cell);
+            }
+        }
+    }
+
+    return true;
+}
+
+static void writeMapObject(QDataStream &out, const MapObject *object,
+                           const GidMapper &gidMapper)
+{
+    out << qint32(object->id()) << object->name() << object->type()
+        << object->position() << object->size()
+        << double(object->rotation()) << object->isVisible()
+        << qint32(object->shape()) << object->polygon()
+        << quint32(gidMapper.cellToGid(object->cell()))
+        << object->properties();
+}
+
+/**
+ * Reads an object written by writeMapObject(). Returns 0 when it is
+ * incomplete.
+ */
+static MapObject *readMapObject(QDataStream &in, const GidMapper &gidMapper)
+{
+    qint32 id;
+    QString name;
+    QString type;
+    QPointF position;
+    QSizeF size;
+    double rotation;
+    bool visible;
+    qint32 shape;
+    QPolygonF polygon;
+    quint32 gid;
+    Properties properties;
+
+    in >> id >> name >> type >> position >> size >> rotation >> visible
+       >> shape >> polygon >> gid >> properties;
+
+    if (in.status() != QDataStream::Ok)
+        return 0;
+
+    MapObject *object = new MapObject(name, type, position, size);
+    object->setId(id);
+    object->setRotation(rotation);
+    object->setVisible(visible);
+    object->setShape(MapObject::Shape(shape));
+    object->setPolygon(polygon);
+    object->setProperties(properties);
+
+    bool ok;
+    const Cell cell = gidMapper.gidToCell(gid, ok);
+    if (ok)
+        object->setCell(cell);
+
+    return object;
+}
+
+static void writeObjectGroupObjects(QDataStream &out,
+                                    const ObjectGroup *objectGroup,
+                                    const GidMapper &gidMapper)
+{
+    out << qint32(objectGroup->objectCount());
+    foreach (const MapObject *object, objectGroup->objects())
+        writeMapObject(out, object, gidMapper);
+}
+
+static bool readObjectGroupObjects(QDataStream &in, ObjectGroup *objectGroup,
+                                   const GidMapper &gidMapper)
+{
+    qint32 count;
+    in >> count;
+
+    for (int i = 0; i < count; ++i) {
+        MapObject *object = readMapObject(in, gidMapper);
+        if (!object)
+            return false;
+        objectGroup->addObject(object);
+    }
+
+    return in.status() == QDataStream::Ok && count >= 0;
+}
+
+static MapObject *findMapObject(const Map *map, int id)
+{
+    foreach (ObjectGroup *objectGroup, map->objectGroups())
+        foreach (MapObject *object, objectGroup->objects())
+            if (object->id() == id)
+                return object;
+    return 0;
+}
+
+static void removeMapObject(const Map *map, int id)
+{
+    if (MapObject *object = findMapObject(map, id)) {
+        object->objectGroup()->removeObject(object);
+        delete object;
+    }
+}
+
+/**
+ * Writes the attributes of \a layer that can change without replacing it.
+ */
+static void writeLayerAttributes(QDataStream &out, const Layer *layer)
+{
+    out << layer->name() << layer->isVisible() << double(layer->opacity())
+        << qint32(layer->level()) << qint32(layer->x()) << qint32(layer->y());
+
+    if (const ObjectGroup *objectGroup = dynamic_cast<const ObjectGroup*>(layer))
+        out << objectGroup->color() << qint32(objectGroup->drawOrder());
+    else if (const ImageLayer *imageLayer = dynamic_cast<const ImageLayer*>(layer))
+        out << imageLayer->imageSource() << imageLayer->transparentColor();
+}
+
+static bool readLayerAttributes(QDataStream &in, Layer *layer)
+{
+    QString name;
+    bool visible;
+    double opacity;
+    qint32 level, x, y;
+    in >> name >> visible >> opacity >> level >> x >> y;
+
+    if (ObjectGroup *objectGroup = layer->asObjectGroup()) {
+        QColor color;
+        qint32 drawOrder;
+        in >> color >> drawOrder;
+        if (in.status() != QDataStream::Ok)
+            return false;
+
+        objectGroup->setColor(color);
+        objectGroup->setDrawOrder(ObjectGroup::DrawOrder(drawOrder));
+    } else if (ImageLayer *imageLayer = layer->asImageLayer()) {
+        QString source;
+        QColor transparentColor;
+        in >> source >> transparentColor;
+        if (in.status() != QDataStream::Ok)
+            return false;
+
+        if (source != imageLayer->imageSource() ||
+                transparentColor != imageLayer->transparentColor()) {
+            imageLayer->setTransparentColor(transparentColor);
+            if (source.isEmpty())
+                imageLayer->resetImage();
+            else
+                imageLayer->loadFromFile(source);
+        }
+    }
+
+    if (in.status() != QDataStream::Ok)
+        return false;
+
+    layer->setName(name);
+    layer->setVisible(visible);
+    layer->setOpacity(opacity);
+    layer->setLevel(level);
+    layer->setPosition(x, y);
+    return true;
+}
+
+static void writeLayer(QDataStream &out, const Layer *layer,
+                       const GidMapper &gidMapper)
+{
+    out << quint8(layer->layerType())
+        << qint32(layer->width()) << qint32(layer->height());
+    writeLayerAttributes(out, layer);
+    out << layer->properties();
+
+    if (const TileLayer *tileLayer = dynamic_cast<const TileLayer*>(layer))
+        writeCells(out, tileLayer, tileLayer->region(), gidMapper);
+    else if (const ObjectGroup *objectGroup = dynamic_cast<const ObjectGroup*>(layer))
+        writeObjectGroupObjects(out, objectGroup, gidMapper);
+}
+
+/**
+ * Reads a layer written by writeLayer(). Returns 0 when it is incomplete.
+ */
+static Layer *readLayer(QDataStream &in, const GidMapper &gidMapper)
+{
+    quint8 type;
+    qint32 width, height;
+    in >> type >> width >> height;
+    if (in.status() != QDataStream::Ok)
+        return 0;
+
+    Layer *layer;
+    switch (type) {
+    case Layer::TileLayerType:
+        layer = new TileLayer(QString(), 0, 0, width, height);
+        break;
+    case Layer::ObjectGroupType:
+        layer = new ObjectGroup(QString(), 0, 0, width, height);
+        break;
+    case Layer::ImageLayerType:
+        layer = new ImageLayer(QString(), 0, 0, width, height);
+        break;
+    default:
+        return 0;
+    }
+
+    Properties properties;
+    bool complete = readLayerAttributes(in, layer);
+    in >> properties;
+    layer->setProperties(properties);
+
+    if (!complete || in.status() != QDataStream::Ok) {
+        complete = false;
+    } else if (TileLayer *tileLayer = layer->asTileLayer()) {
+        complete = readCells(in, tileLayer, gidMapper);
+    } else if (ObjectGroup *objectGroup = layer->asObjectGroup()) {
+        complete = readObjectGroupObjects(in, objectGroup, gidMapper);
+    }
+
+    if (!complete) {
+        delete layer;
+        return 0;
+    }
+
+    return layer;
+}
+
+/**
+ * Writes a reference to the \a object that holds properties. Returns false
+ * when the object is not part of the \a map.
+ */
+static bool writeObjectReference(QDataStream &out, Object *object,
+                                 const Map *map)
+{
+    out << quint8(object->typeId());
+
+    switch (object->typeId()) {
+    case Object::MapType:
+        return object == map;
+    case Object::LayerType: {
+        const int index = map->layers().indexOf(static_cast<Layer*>(object));
+        out << qint32(index);
+        return index != -1;
+    }
+    case Object::MapObjectType:
+        out << qint32(static_cast<MapObject*>(object)->id());
+        return static_cast<MapObject*>(object)->objectGroup() != 0;
+    case Object::TilesetType: {
+        const int index = map->indexOfTileset(static_cast<Tileset*>(object));
+        out << qint32(index);
+        return index != -1;
+    }
+    case Object::TileType: {
+        const Tile *tile = static_cast<Tile*>(object);
+        const int index = map->indexOfTileset(tile->tileset());
+        out << qint32(index) << qint32(tile->id());
+        return index != -1;
+    }
+    case Object::TerrainType: {
+        const Terrain *terrain = static_cast<Terrain*>(object);
+        const int index = map->indexOfTileset(terrain->tileset());
+        out << qint32(index) << qint32(terrain->id());
+        return index != -1;
+    }
+    }
+
+    return false;
+}
+
+/**
+ * Reads a reference written by writeObjectReference(). Sets \a object to 0
+ * when it doesn't refer to anything in the \a map. Returns false when the
+ * reference is incomplete.
+ */
+static bool readObjectReference(QDataStream &in, Map *map, Object **object)
+{
+    quint8 type;
+    qint32 index = 0;
+    qint32 id = 0;
+
+    in >> type;
+    if (type == Object::LayerType || type == Object::MapObjectType ||
+            type == Object::TilesetType)
+        in >> index;
+    else if (type == Object::TileType || type == Object::TerrainType)
+        in >> index >> id;
+
+    *object = 0;
+    if (in.status() != QDataStream::Ok)
+        return false;
+
+    const bool validTileset = index >= 0 && index < map->tilesetCount();
+
+    switch (type) {
+    case Object::MapType:
+        *object = map;
+        break;
+    case Object::LayerType:
+        if (index >= 0 && index < map->layerCount())
+            *object = map->layerAt(index);
+        break;
+    case Object::MapObjectType:
+        *object = findMapObject(map, index);
+        break;
+    case Object::TilesetType:
+        if (validTileset)
+            *object = map->tilesetAt(index);
+        break;
+    case Object::TileType:
+        if (validTileset)
+            *object = map->tilesetAt(index)->tileAt(id);
+        break;
+    case Object::TerrainType:
+        if (validTileset && id >= 0 && id < map->tilesetAt(index)->terrainCount())
+            *object = map->tilesetAt(index)->terrain(id);
+        break;
+    }
+
+    return true;
+}
+
+/**
+ * Reads a record of the given \a type and applies it to the \a map. Returns
+ * false when the record is incomplete, which happens when it was being
+ * written during the crash. Records referring to things that don't exist
+ * are skipped.
+ */
+static bool readRecord(QDataStream &in, quint8 type, Map *map)
+{
+    const GidMapper gidMapper(map->tilesets());
+
+    switch (type) {
+    case TileRecord: {
+        qint32 layerIndex;
+        in >> layerIndex;
+
+        TileLayer *tileLayer = 0;
+        if (layerIndex >= 0 && layerIndex < map->layerCount())
+            tileLayer = map->layerAt(layerIndex)->asTileLayer();
+
+        return in.status() == QDataStream::Ok
+                && readCells(in, tileLayer, gidMapper);
+    }
+    case LayerAddedRecord: {
+        qint32 index;
+        in >> index;
+
+        Layer *layer = readLayer(in, gidMapper);
+        if (!layer)
+            return false;
+
+        map->insertLayer(qBound(0, int(index), map->layerCount()), layer);
+        return true;
+    }
+    case LayerRemovedRecord: {
+        qint32 index;
+        in >> index;
+        if (in.status() != QDataStream::Ok)
+            return false;
+
+        if (index >= 0 && index < map->layerCount())
+            delete map->takeLayerAt(index);
+        return true;
+    }
+    case LayerRecord: {
+        qint32 index;
+        in >> index;
+        if (in.status() != QDataStream::Ok)
+            return false;
+
+        // Skipping needs a layer of the same type to read into
+        if (index >= 0 && index < map->layerCount())
+            return readLayerAttributes(in, map->layerAt(index));
+        return false;
+    }
+    case ObjectRecord: {
+        qint32 layerIndex;
+        qint32 index;
+        in >> layerIndex >> index;
+
+        MapObject *object = readMapObject(in, gidMapper);
+        if (!object)
+            return false;
+
+        removeMapObject(map, object->id());
+
+        ObjectGroup *objectGroup = 0;
+        if (layerIndex >= 0 && layerIndex < map->layerCount())
+            objectGroup = map->layerAt(layerIndex)->asObjectGroup();
+
+        if (objectGroup)
+            objectGroup->insertObject(qBound(0, int(index),
+                                             objectGroup->objectCount()),
+                                      object);
+        else
+            delete object;
+        return true;
+    }
+    case ObjectRemovedRecord: {
+        qint32 id;
+        in >> id;
+        if (in.status() != QDataStream::Ok)
+            return false;
+
+        removeMapObject(map, id);
+        return true;
+    }
+    case ObjectOrderRecord: {
+        qint32 layerIndex;
+        qint32 first;
+        QVector<qint32> ids;
+        in >> layerIndex >> first >> ids;
+        if (in.status() != QDataStream::Ok)
+            return false;
+
+        ObjectGroup *objectGroup = 0;
+        if (layerIndex >= 0 && layerIndex < map->layerCount())
+            objectGroup = map->layerAt(layerIndex)->asObjectGroup();
+        if (!objectGroup)
+            return true;
+
+        // Move each object to its position in the changed range
+        for (int i = 0; i < ids.size(); ++i) {
+            const int to = first + i;
+            for (int from = 0; from < objectGroup->objectCount(); ++from) {
+                if (objectGroup->objectAt(from)->id() == ids.at(i)) {
+                    if (from != to && to < objectGroup->objectCount()) {
+                        MapObject *object = objectGroup->objectAt(from);
+                        objectGroup->removeObjectAt(from);
+                        objectGroup->insertObject(to, object);
+                    }
+                    break;
+                }
+            }
+        }
+        return true;
+    }
+    case PropertiesRecord: {
+        Object *object;
+        Properties properties;
+        if (!readObjectReference(in, map, &object))
+            return false;
+        in >> properties;
+        if (in.status() != QDataStream::Ok)
+            return false;
+
+        if (object)
+            object->setProperties(properties);
+        return true;
+    }
+    case TileAttributesRecord: {
+        qint32 tilesetIndex;
+        qint32 tileId;
+        quint32 terrain;
+        float probability;
+        QVector<qint32> frameData;
+        bool hasObjectGroup;
+        in >> tilesetIndex >> tileId >> terrain >> probability >> frameData
+           >> hasObjectGroup;
+
+        ObjectGroup *objectGroup = 0;
+        if (hasObjectGroup) {
+            objectGroup = new ObjectGroup;
+            if (!readObjectGroupObjects(in, objectGroup, gidMapper)) {
+                delete objectGroup;
+                return false;
+            }
+        }
+
+        if (in.status() != QDataStream::Ok) {
+            delete objectGroup;
+            return false;
+        }
+
+        Tile *tile = 0;
+        if (tilesetIndex >= 0 && tilesetIndex < map->tilesetCount())
+            tile = map->tilesetAt(tilesetIndex)->tileAt(tileId);
+        if (!tile) {
+            delete objectGroup;
+            return true;
+        }
+
+        QVector<Frame> frames;
+        for (int i = 0; i + 1 < frameData.size(); i += 2) {
+            const Frame frame = { frameData.at(i), frameData.at(i + 1) };
+            frames.append(frame);
+        }
+
+        tile->setTerrain(terrain);
+        tile->setTerrainProbability(probability);
+        tile->setFrames(frames);
+        tile->setObjectGroup(objectGroup);
+        return true;
+    }
+    case TilesetRecord: {
+        qint32 index;
+        QString name;
+        QPoint tileOffset;
+        in >> index >> name >> tileOffset;
+        if (in.status() != QDataStream::Ok)
+            return false;
+
+        if (index >= 0 && index < map->tilesetCount()) {
+            Tileset *tileset = map->tilesetAt(index);
+            tileset->setName(name);
+            tileset->setTileOffset(tileOffset);
+        }
+        return true;
+    }
+    }
+
+    return false;
+}
+
+EditJournal::EditJournal(MapDocument *mapDocument)
+    : QObject(mapDocument)
+    , mMapDocument(mapDocument)
+    , mFileName(mapDocument->fileName())
+    , mBytesSinceCheckpoint(0)
+    , mCheckpointQueued(false)
+{
+    mCheckpointTimer.setInterval(checkpointDelay);
+    mCheckpointTimer.setSingleShot(true);
+    connect(&mCheckpointTimer, SIGNAL(timeout()), SLOT(writeCheckpoint()));
+
+    connect(mapDocument, SIGNAL(regionChanged(QRegion,Layer*)),
+            SLOT(regionChanged(QRegion,Layer*)));
+
+    connect(mapDocument, SIGNAL(layerAdded(int)), SLOT(layerAdded(int)));
+    connect(mapDocument, SIGNAL(layerRemoved(int)), SLOT(layerRemoved(int)));
+    connect(mapDocument, SIGNAL(layerChanged(int)), SLOT(layerChanged(int)));
+    connect(mapDocument, SIGNAL(objectGroupChanged(ObjectGroup*)),
+            SLOT(objectGroupChanged(ObjectGroup*)));
+    connect(mapDocument, SIGNAL(imageLayerChanged(ImageLayer*)),
+            SLOT(imageLayerChanged(ImageLayer*)));
+
+    connect(mapDocument, SIGNAL(objectsAdded(QList<MapObject*>)),
+            SLOT(objectsChanged(QList<MapObject*>)));
+    connect(mapDocument, SIGNAL(objectsRemoved(QList<MapObject*>)),
+            SLOT(objectsRemoved(QList<MapObject*>)));
+    connect(mapDocument, SIGNAL(objectsChanged(QList<MapObject*>)),
+            SLOT(objectsChanged(QList<MapObject*>)));
+    connect(mapDocument, SIGNAL(objectsIndexChanged(ObjectGroup*,int,int)),
+            SLOT(objectsIndexChanged(ObjectGroup*,int,int)));
+
+    connect(mapDocument, SIGNAL(propertyAdded(Object*,QString)),
+            SLOT(propertiesChanged(Object*)));
+    connect(mapDocument, SIGNAL(propertyRemoved(Object*,QString)),
+            SLOT(propertiesChanged(Object*)));
+    connect(mapDocument, SIGNAL(propertyChanged(Object*,QString)),
+            SLOT(propertiesChanged(Object*)));
+    connect(mapDocument, SIGNAL(propertiesChanged(Object*)),
+            SLOT(propertiesChanged(Object*)));
+    connect(mapDocument, SIGNAL(propertiesChanged(QList<Object*>)),
+            SLOT(propertiesChanged(QList<Object*>)));
+
+    connect(mapDocument, SIGNAL(tileTerrainChanged(QList<Tile*>)),
+            SLOT(tilesChanged(QList<Tile*>)));
+    connect(mapDocument, SIGNAL(tileObjectGroupChanged(Tile*)),
+            SLOT(tileChanged(Tile*)));
+    connect(mapDocument, SIGNAL(tileAnimationChanged(Tile*)),
+            SLOT(tileChanged(Tile*)));
+    connect(mapDocument, SIGNAL(tilesetNameChanged(Tileset*)),
+            SLOT(tilesetChanged(Tileset*)));
+    connect(mapDocument, SIGNAL(tilesetTileOffsetChanged(Tileset*)),
+            SLOT(tilesetChanged(Tileset*)));
+
+    // Embedded tilesets and changes to the map are only covered by
+    // checkpoints. The records refer to the tilesets by index.
+    connect(mapDocument, SIGNAL(mapChanged()), SLOT(queueCheckpoint()));
+    connect(mapDocument, SIGNAL(tilesetAdded(int,Tileset*)),
+            SLOT(queueCheckpoint()));
+    connect(mapDocument, SIGNAL(tilesetRemoved(Tileset*)),
+            SLOT(queueCheckpoint()));
+    connect(mapDocument, SIGNAL(tilesetMoved(int,int)),
+            SLOT(queueCheckpoint()));
+
+    connect(mapDocument, SIGNAL(aboutToHibernate()), SLOT(flushCheckpoint()));
+    connect(mapDocument, SIGNAL(modifiedChanged()), SLOT(modifiedChanged()));
+    connect(mapDocument, SIGNAL(saved()), SLOT(reset()));
+    connect(mapDocument, SIGNAL(fileNameChanged(QString,QString)),
+            SLOT(reset()));
+
+    // A recovered document differs from its file before any edit is made
+    if (mapDocument->isModified())
+        writeCheckpoint();
+}
+
+EditJournal::~EditJournal()
+{
+    mFile.close();
+    if (!mFileName.isEmpty())
+        discard(mFileName);
+}
+
+QString EditJournal::journalPath(const QString &fileName)
+{
+#if QT_VERSION >= 0x050000
+    const QString dataLocation =
+            QStandardPaths::writableLocation(QStandardPaths::DataLocation);
+#else
+    const QString dataLocation =
+            QDesktopServices::storageLocation(QDesktopServices::DataLocation);
+#endif
+
+    const QByteArray filePath = QFileInfo(fileName).absoluteFilePath().toUtf8();
+    const QByteArray hash =
+            QCryptographicHash::hash(filePath, QCryptographicHash::Md5).toHex();
+
+    return dataLocation + QLatin1String("/journals/")
+            + QString::fromLatin1(hash) + QLatin1String(".journal");
+}
+
+bool EditJournal::canRecover(const QString &fileName)
+{
+    QFile file(journalPath(fileName));
+    if (!file.open(QIODevice::ReadOnly))
+        return false;
+
+    QDataStream in(&file);
+    in.setVersion(streamVersion);
+    return readHeader(in, fileName) && !in.atEnd();
+}
+
+Map *EditJournal::recover(const Map *savedMap, const QString &fileName,
+                          QString *error)
+{
+    QFile file(journalPath(fileName));
+    if (!file.open(QIODevice::ReadOnly)) {
+        *error = tr("Unable to read the recovery journal: %1")
+                .arg(file.errorString());
+        return 0;
+    }
+
+    QDataStream in(&file);
+    in.setVersion(streamVersion);
+
+    if (!readHeader(in, fileName)) {
+        *error = tr("The recovery journal does not belong to this map.");
+        return 0;
+    }
+
+    Map *map = new Map(*savedMap);
+    map->setNextObjectId(savedMap->nextObjectId());
+
+    const QString mapPath = QFileInfo(fileName).absolutePath();
+
+    while (!in.atEnd()) {
+        quint8 type;
+        in >> type;
+
+        if (type == CheckpointRecord) {
+            QByteArray data;
+            in >> data;
+            if (in.status() != QDataStream::Ok)
+                break;
+
+            // Only the first record can be a checkpoint, so there is no
+            // need to care about the tilesets of the map it replaces
+            TmxMapReader reader;
+            Map *checkpoint = reader.fromByteArray(data, mapPath);
+            if (!checkpoint) {
+                *error = reader.errorString();
+                delete map;
+                return 0;
+            }
+
+            delete map;
+            map = checkpoint;
+        } else if (!readRecord(in, type, map)) {
+            break;
+        }
+    }
+
+    // Objects recorded since the checkpoint may use IDs beyond it
+    foreach (ObjectGroup *objectGroup, map->objectGroups())
+        foreach (MapObject *object, objectGroup->objects())
+            if (object->id() >= map->nextObjectId())
+                map->setNextObjectId(object->id() + 1);
+
+    return map;
+}
+
+void EditJournal::discard(const QString &fileName)
+{
+    QFile::remove(journalPath(fileName));
+}
+
+void EditJournal::regionChanged(const QRegion &region, Layer *layer)
+{
+    TileLayer *tileLayer = layer ? layer->asTileLayer() : 0;
+    const int layerIndex = mMapDocument->map()->layers().indexOf(layer);
+    if (!tileLayer || layerIndex == -1 || !isRecording())
+        return;
+
+    const GidMapper gidMapper(mMapDocument->map()->tilesets());
+
+    QByteArray record;
+    QDataStream out(&record, QIODevice::WriteOnly);
+    out.setVersion(streamVersion);
+    out << quint8(TileRecord) << qint32(layerIndex);
+    writeCells(out, tileLayer, region, gidMapper);
+
+    appendRecord(record);
+}
+
+void EditJournal::layerAdded(int index)
+{
+    if (!isRecording())
+        return;
+
+    const Map *map = mMapDocument->map();
+    const GidMapper gidMapper(map->tilesets());
+
+    QByteArray record;
+    QDataStream out(&record, QIODevice::WriteOnly);
+    out.setVersion(streamVersion);
+    out << quint8(LayerAddedRecord) << qint32(index);
+    writeLayer(out, map->layerAt(index), gidMapper);
+
+    appendRecord(record);
+}
+
+void EditJournal::layerRemoved(int index)
+{
+    if (!isRecording())
+        return;
+
+    QByteArray record;
+    QDataStream out(&record, QIODevice::WriteOnly);
+    out.setVersion(streamVersion);
+    out << quint8(LayerRemovedRecord) << qint32(index);
+
+    appendRecord(record);
+}
+
+void EditJournal::layerChanged(int index)
+{
+    recordLayerAttributes(mMapDocument->map()->layerAt(index));
+}
+
+void EditJournal::objectGroupChanged(ObjectGroup *objectGroup)
+{
+    recordLayerAttributes(objectGroup);
+}
+
+void EditJournal::imageLayerChanged(ImageLayer *imageLayer)
+{
+    recordLayerAttributes(imageLayer);
+}
+
+void EditJournal::recordLayerAttributes(Layer *layer)
+{
+    const int index = mMapDocument->map()->layers().indexOf(layer);
+    if (index == -1 || !isRecording())
+        return;
+
+    QByteArray record;
+    QDataStream out(&record, QIODevice::WriteOnly);
+    out.setVersion(streamVersion);
+    out << quint8(LayerRecord) << qint32(index);
+    writeLayerAttributes(out, layer);
+
+    appendRecord(record);
+}
+
+/**
+ * Added and changed objects are both written as a whole, replacing any
+ * object with the same ID.
+ */
+void EditJournal::objectsChanged(const QList<MapObject*> &objects)
+{
+    if (!isRecording())
+        return;
+
+    const Map *map = mMapDocument->map();
+    const GidMapper gidMapper(map->tilesets());
+
+    QByteArray record;
+    QDataStream out(&record, QIODevice::WriteOnly);
+    out.setVersion(streamVersion);
+
+    foreach (MapObject *object, objects) {
+        ObjectGroup *objectGroup = object->objectGroup();
+        const int layerIndex = map->layers().indexOf(objectGroup);
+        if (layerIndex == -1)
+            continue;
+
+        out << quint8(ObjectRecord) << qint32(layerIndex)
+            << qint32(objectGroup->objects().indexOf(object));
+        writeMapObject(out, object, gidMapper);
+    }
+
+    appendRecord(record);
+}
+
+void EditJournal::objectsRemoved(const QList<MapObject*> &objects)
+{
+    if (!isRecording())
+        return;
+
+    QByteArray record;
+    QDataStream out(&record, QIODevice::WriteOnly);
+    out.setVersion(streamVersion);
+
+    foreach (const MapObject *object, objects)
+        out << quint8(ObjectRemovedRecord) << qint32(object->id());
+
+    appendRecord(record);
+}
+
+void EditJournal::objectsIndexChanged(ObjectGroup *objectGroup,
+                                      int first, int last)
+{
+    const int layerIndex = mMapDocument->map()->layers().indexOf(objectGroup);
+    if (layerIndex == -1 || !isRecording())
+        return;
+
+    QVector<qint32> ids;
+    for (int i = first; i <= last; ++i)
+        ids.append(objectGroup->objectAt(i)->id());
+
+    QByteArray record;
+    QDataStream out(&record, QIODevice::WriteOnly);
+    out.setVersion(streamVersion);
+    out << quint8(ObjectOrderRecord) << qint32(layerIndex) << qint32(first)
+        << ids;
+
+    appendRecord(record);
+}
+
+void EditJournal::propertiesChanged(Object *object)
+{
+    propertiesChanged(QList<Object*>() << object);
+}
+
+void EditJournal::propertiesChanged(const QList<Object*> &objects)
+{
+    if (!isRecording())
+        return;
+
+    QByteArray record;
+
+    foreach (Object *object, objects) {
+        QByteArray objectRecord;
+        QDataStream out(&objectRecord, QIODevice::WriteOnly);
+        out.setVersion(streamVersion);
+        out << quint8(PropertiesRecord);
+        if (!writeObjectReference(out, object, mMapDocument->map()))
+            continue;
+        out << object->properties();
+        record += objectRecord;
+    }
+
+    appendRecord(record);
+}
+
+void EditJournal::tilesChanged(const QList<Tile*> &tiles)
+{
+    if (!isRecording())
+        return;
+
+    const Map *map = mMapDocument->map();
+    const GidMapper gidMapper(map->tilesets());
+
+    QByteArray record;
+    QDataStream out(&record, QIODevice::WriteOnly);
+    out.setVersion(streamVersion);
+
+    foreach (Tile *tile, tiles) {
+        const int tilesetIndex = map->indexOfTileset(tile->tileset());
+        if (tilesetIndex == -1)
+            continue;
+
+        QVector<qint32> frameData;
+        foreach (const Frame &frame, tile->frames())
+            frameData << frame.tileId << frame.duration;
+
+        out << quint8(TileAttributesRecord)
+            << qint32(tilesetIndex) << qint32(tile->id())
+            << quint32(tile->terrain()) << tile->terrainProbability()
+            << frameData << (tile->objectGroup() != 0);
+
+        if (tile->objectGroup())
+            writeObjectGroupObjects(out, tile->objectGroup(), gidMapper);
+    }
+
+    appendRecord(record);
+}
+
+void EditJournal::tileChanged(Tile *tile)
+{
+    tilesChanged(QList<Tile*>() << tile);
+}
+
+void EditJournal::tilesetChanged(Tileset *tileset)
+{
+    const int index = mMapDocument->map()->indexOfTileset(tileset);
+    if (index == -1 || !isRecording())
+        return;
+
+    QByteArray record;
+    QDataStream out(&record, QIODevice::WriteOnly);
+    out.setVersion(streamVersion);
+    out << quint8(TilesetRecord) << qint32(index)
+        << tileset->name() << tileset->tileOffset();
+
+    appendRecord(record);
+}
+
+/**
+ * Returns whether changes need to be recorded. They don't when a checkpoint
+ * is about to store the whole map anyway.
+ */
+bool EditJournal::isRecording() const
+{
+    return !mFileName.isEmpty() && !mCheckpointQueued;
+}
+
+void EditJournal::appendRecord(const QByteArray &record)
+{
+    if (record.isEmpty() || !openForAppending())
+        return;
+
+    mFile.write(record);
+    mFile.flush();
+
+    mBytesSinceCheckpoint += record.size();
+    if (mBytesSinceCheckpoint > maxBytesSinceCheckpoint)
+        scheduleCheckpoint();
+}
+
+/**
+ * Writes a checkpoint once control returns to the event loop, so that the
+ * steps of a compound edit share a single checkpoint.
+ */
+void EditJournal::queueCheckpoint()
+{
+    if (mFileName.isEmpty() || mCheckpointQueued)
+        return;
+
+    mCheckpointQueued = true;
+    QMetaObject::invokeMethod(this, "writeCheckpoint", Qt::QueuedConnection);
+}
+
+void EditJournal::scheduleCheckpoint()
+{
+    if (!mFileName.isEmpty())
+        mCheckpointTimer.start();
+}
+
+/**
+ * Writes the whole map to a new journal, which then replaces the current
+ * one. This way the journal is never left without a usable state.
+ */
+void EditJournal::writeCheckpoint()
+{
+    mCheckpointTimer.stop();
+    mCheckpointQueued = false;
+
+    if (mFileName.isEmpty() || mMapDocument->isHibernated())
+        return;
+
+    const QString path = journalPath(mFileName);
+    const QString newPath = path + QLatin1String(".new");
+    QDir().mkpath(QFileInfo(path).path());
+
+    QFile file(newPath);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate))
+        return;
+
+    TmxMapWriter writer;
+    QDataStream out(&file);
+    out.setVersion(streamVersion);
+    writeHeader(out, mFileName);
+    // References to external files are stored relative to the map, like
+    // when the map itself is saved, so that they don't depend on the working
+    // directory of the process that recovers the journal
+    const QString mapPath = QFileInfo(mFileName).absolutePath();
+    out << quint8(CheckpointRecord)
+        << writer.toByteArray(mMapDocument->map(), mapPath);
+    file.close();
+
+    if (out.status() != QDataStream::Ok || file.error() != QFile::NoError) {
+        file.remove();
+        return;
+    }
+
+    mFile.close();
+    QFile::remove(path);
+    if (!QFile::rename(newPath, path))
+        return;
+
+    mFile.setFileName(path);
+    mFile.open(QIODevice::WriteOnly | QIODevice::Append);
+    mBytesSinceCheckpoint = 0;
+}
+
+/**
+ * Writes a pending checkpoint right away, since the map can't be written
+ * while the document is hibernated.
+ */
+void EditJournal::flushCheckpoint()
+{
+    if (mCheckpointTimer.isActive() || mCheckpointQueued)
+        writeCheckpoint();
+}
+
+void EditJournal::modifiedChanged()
+{
+    // Back at the saved state, so there is nothing to recover
+    if (!mMapDocument->isModified())
+        reset();
+}
+
+/**
+ * Removes the journal and starts over for the current file name of the
+ * document.
+ */
+void EditJournal::reset()
+{
+    mCheckpointTimer.stop();
+    mCheckpointQueued = false;
+    mFile.close();
+
+    if (!mFileName.isEmpty())
+        discard(mFileName);
+
+    mFileName = mMapDocument->fileName();
+    mBytesSinceCheckpoint = 0;
+}
+
+/**
+ * Opens the journal when this is the first change since the document was
+ * loaded or saved, in which case any previous journal is overwritten.
+ */
+bool EditJournal::openForAppending()
+{
+    if (mFile.isOpen())
+        return true;
+    if (mFileName.isEmpty())
+        return false;
+
+    const QString path = journalPath(mFileName);
+    QDir().mkpath(QFileInfo(path).path());
+
+    mFile.setFileName(path);
+    if (!mFile.open(QIODevice::WriteOnly | QIODevice::Truncate))
+        return false;
+
+    QDataStream out(&mFile);
+    out.setVersion(streamVersion);
+    writeHeader(out, mFileName);
+    mFile.flush();
+
+    mBytesSinceCheckpoint = 0;
+    return true;
+}
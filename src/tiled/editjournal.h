@@ -0,0 +1,134 @@
+/*
+ * editjournal.h
+ * Copyright 2015, Sydoria Games <luax@sydoria.fr>
+ *
+ * This file is part of Tiled.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef EDITJOURNAL_H
+#define EDITJOURNAL_H
+
+#include <QFile>
+#include <QList>
+#include <QObject>
+#include <QRegion>
+#include <QTimer>
+
+namespace Tiled {
+
+class ImageLayer;
+class Layer;
+class Map;
+class MapObject;
+class Object;
+class ObjectGroup;
+class Tile;
+class Tileset;
+
+namespace Internal {
+
+class MapDocument;
+
+/**
+ * Keeps a recovery journal for a map document, so that its unsaved changes
+ * survive a crash.
+ *
+ * Each change is appended to the journal as a small record, which is cheap
+ * enough to do for every edit: the changed region of a tile layer as rows of
+ * global tile IDs, the changed objects, the changed properties, the added or
+ * removed layer, and so on. Only changes to the tilesets or to the map itself
+ * are covered by a checkpoint, which stores the whole map and replaces the
+ * contents of the journal. Those are written once the current edit is done,
+ * rather than for each of its steps. Checkpoints are otherwise only written
+ * to compact the journal, once the records pile up and the document has been
+ * idle for a moment.
+ *
+ * The journal is removed when the document is saved, when it returns to its
+ * saved state and when it is closed.
+ */
+class EditJournal : public QObject
+{
+    Q_OBJECT
+
+public:
+    /**
+     * Constructor. The journal is owned by the \a mapDocument.
+     */
+    explicit EditJournal(MapDocument *mapDocument);
+    ~EditJournal();
+
+    /**
+     * Returns whether a journal with changes to the map saved at
+     * \a fileName was left behind, and still applies to that file.
+     */
+    static bool canRecover(const QString &fileName);
+
+    /**
+     * Applies the journal left behind for \a fileName to a copy of the
+     * \a savedMap. Returns the recovered map, or 0 when the journal could not
+     * be read, in which case \a error is set.
+     */
+    static Map *recover(const Map *savedMap, const QString &fileName,
+                        QString *error);
+
+    /**
+     * Removes the journal for the map saved at \a fileName.
+     */
+    static void discard(const QString &fileName);
+
+private slots:
+    void regionChanged(const QRegion &region, Layer *layer);
+    void layerAdded(int index);
+    void layerRemoved(int index);
+    void layerChanged(int index);
+    void objectGroupChanged(ObjectGroup *objectGroup);
+    void imageLayerChanged(ImageLayer *imageLayer);
+    void objectsChanged(const QList<MapObject*> &objects);
+    void objectsRemoved(const QList<MapObject*> &objects);
+    void objectsIndexChanged(ObjectGroup *objectGroup, int first, int last);
+    void propertiesChanged(Object *object);
+    void propertiesChanged(const QList<Object*> &objects);
+    void tilesChanged(const QList<Tile*> &tiles);
+    void tileChanged(Tile *tile);
+    void tilesetChanged(Tileset *tileset);
+
+    void queueCheckpoint();
+    void scheduleCheckpoint();
+    void writeCheckpoint();
+    void flushCheckpoint();
+    void modifiedChanged();
+    void reset();
+
+private:
+    static QString journalPath(const QString &fileName);
+
+    bool isRecording() const;
+    void appendRecord(const QByteArray &record);
+    void recordLayerAttributes(Layer *layer);
+    bool openForAppending();
+
+    MapDocument *mMapDocument;
+    QString mFileName;
+    QFile mFile;
+    qint64 mBytesSinceCheckpoint;
+    QTimer mCheckpointTimer;
+    bool mCheckpointQueued;
+};
+
+} // namespace Internal
+} // namespace Tiled
+
+#endif // EDITJOURNAL_H
@@ -35,6 +35,12 @@ FileSystemWatcher::FileSystemWatcher(QObject *parent) :
             SLOT(onFileChanged(QString)));
     connect(mWatcher, SIGNAL(directoryChanged(QString)),
             SLOT(onDirectoryChanged(QString)));
+
+    mChangedPathsTimer.setInterval(100);
+    mChangedPathsTimer.setSingleShot(true);
+
+    connect(&mChangedPathsTimer, SIGNAL(timeout()),
+            SLOT(reportChangedPaths()));
 }
 
 void FileSystemWatcher::addPath(const QString &path)
@@ -43,7 +49,7 @@ void FileSystemWatcher::addPath(const QString &path)
     if (!QFile::exists(path))
         return;
 
-    QMap<QString, int>::iterator entry = mWatchCount.find(path);
+    QHash<QString, int>::iterator entry = mWatchCount.find(path);
     if (entry == mWatchCount.end()) {
         mWatcher->addPath(path);
         mWatchCount.insert(path, 1);
@@ -55,7 +61,7 @@ void FileSystemWatcher::addPath(const QString &path)
 
 void FileSystemWatcher::removePath(const QString &path)
 {
-    QMap<QString, int>::iterator entry = mWatchCount.find(path);
+    QHash<QString, int>::iterator entry = mWatchCount.find(path);
     if (entry == mWatchCount.end()) {
         if (QFile::exists(path))
             qWarning() << "FileSystemWatcher: Path was never added:" << path;
@@ -68,22 +74,40 @@ void FileSystemWatcher::removePath(const QString &path)
     if (entry.value() == 0) {
         mWatchCount.erase(entry);
         mWatcher->removePath(path);
+        mChangedPaths.remove(path);
     }
 }
 
 void FileSystemWatcher::onFileChanged(const QString &path)
 {
-    // If the file was replaced, the watcher is automatically removed and needs
-    // to be re-added to keep watching it for changes. This happens commonly
-    // with applications that do atomic saving.
-    if (!mWatcher->files().contains(path))
-        if (QFile::exists(path))
-            mWatcher->addPath(path);
-
-    emit fileChanged(path);
+    mChangedPaths.insert(path);
+    mChangedPathsTimer.start();
 }
 
 void FileSystemWatcher::onDirectoryChanged(const QString &path)
 {
     emit directoryChanged(path);
 }
+
+void FileSystemWatcher::reportChangedPaths()
+{
+    QStringList paths = mChangedPaths.toList();
+    mChangedPaths.clear();
+    paths.sort();
+
+    // If a file was replaced, the watcher is automatically removed and needs
+    // to be re-added to keep watching it for changes. This happens commonly
+    // with applications that do atomic saving. The list of watched files is
+    // copied only once for all changed files.
+    const QSet<QString> watched = mWatcher->files().toSet();
+
+    foreach (const QString &path, paths) {
+        if (!watched.contains(path) && mWatchCount.contains(path))
+            if (QFile::exists(path))
+                mWatcher->addPath(path);
+
+        emit fileChanged(path);
+    }
+
+    emit filesChanged(paths);
+}
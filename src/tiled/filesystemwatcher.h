@@ -21,8 +21,11 @@
 #ifndef FILESYSTEMWATCHER_H
 #define FILESYSTEMWATCHER_H
 
-#include <QMap>
+#include <QHash>
 #include <QObject>
+#include <QSet>
+#include <QStringList>
+#include <QTimer>
 
 class QFileSystemWatcher;
 
@@ -35,6 +38,10 @@ namespace Internal {
  * doesn't exist.
  *
  * It's meant to be used as drop-in replacement for QFileSystemWatcher.
+ * However, file changes are not reported right away. They are collected for
+ * a short while, so that a burst of changes (like a bulk update of many
+ * files, or an application saving a file in several steps) is reported only
+ * once per file, and also as a single list.
  */
 class FileSystemWatcher : public QObject
 {
@@ -46,17 +53,36 @@ public:
     void addPath(const QString &path);
     void removePath(const QString &path);
 
+    /**
+     * Sets the time in milliseconds to wait for further changes before
+     * reporting the changed files. Each change restarts the wait.
+     */
+    void setChangeInterval(int msec) { mChangedPathsTimer.setInterval(msec); }
+    int changeInterval() const { return mChangedPathsTimer.interval(); }
+
 signals:
     void fileChanged(const QString &path);
+
+    /**
+     * Emitted after fileChanged() has been emitted for each of the
+     * changed \a paths. The paths are sorted, so that the files within the
+     * same directory are next to each other.
+     */
+    void filesChanged(const QStringList &paths);
+
     void directoryChanged(const QString &path);
 
 private slots:
     void onFileChanged(const QString &path);
     void onDirectoryChanged(const QString &path);
+    void reportChangedPaths();
 
 private:
     QFileSystemWatcher *mWatcher;
-    QMap<QString, int> mWatchCount;
+    QHash<QString, int> mWatchCount;
+
+    QSet<QString> mChangedPaths;
+    QTimer mChangedPathsTimer;
 };
 
 } // namespace Internal
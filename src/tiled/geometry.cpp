@@ -143,51 +143,105 @@ QVector<QPoint> pointsOnLine(int x0, int y0, int x1, int y1)
 }
 
 /**
- * Checks if a given rectangle \a rect is coherent to another given \a region.
- * 'coherent' means that either the rectangle is overlapping the region or
- * the rectangle contains at least one tile, which is a direct neighbour
- * to a tile, which belongs to the region.
+ * Returns the representative of the set \a index belongs to, compressing the
+ * path along the way.
  */
-static bool isCoherentTo(const QRect &rect, const QRegion &region)
+static int findSet(QVector<int> &parents, int index)
 {
-    // check if the region is coherent at top or bottom
-    if (region.intersects(rect.adjusted(0, -1, 0, 1)))
-        return true;
-
-    // check if the region is coherent at left or right side
-    if (region.intersects(rect.adjusted(-1, 0, 1, 0)))
-        return true;
+    while (parents.at(index) != index) {
+        parents[index] = parents.at(parents.at(index));
+        index = parents.at(index);
+    }
+    return index;
+}
 
-    return false;
+static void uniteSets(QVector<int> &parents, int a, int b)
+{
+    a = findSet(parents, a);
+    b = findSet(parents, b);
+    if (a != b)
+        parents[qMax(a, b)] = qMin(a, b);
 }
 
 /**
  * Calculates all coherent regions occupied by the given \a region.
  * Returns a list of regions, where each region is coherent in itself.
+ *
+ * 'coherent' means that the tiles are direct (not diagonal) neighbours.
+ *
+ * The rectangles of a QRegion are stored in bands of equal height, sorted by
+ * y and then by x. This is used to label the connected components with a
+ * union-find in a single sweep: rectangles can only touch within a band, or
+ * when they overlap horizontally in two consecutive bands that touch.
  */
 QList<QRegion> coherentRegions(const QRegion &region)
 {
-    QList<QRegion> result;
-    QVector<QRect> rects = region.rects();
-
-    while (!rects.isEmpty()) {
-        QRegion newCoherentRegion = rects.last();
-        rects.pop_back();
-
-        // Add up all coherent rects until there is no rect left which is
-        // coherent to the newly created region.
-        bool foundRect = true;
-        while (foundRect) {
-            foundRect = false;
-            for (int i = rects.size() - 1; i >= 0; --i) {
-                if (isCoherentTo(rects.at(i), newCoherentRegion)) {
-                    newCoherentRegion += rects.at(i);
-                    rects.remove(i);
-                    foundRect = true;
-                }
+    const QVector<QRect> rects = region.rects();
+    const int count = rects.size();
+
+    QVector<int> parents(count);
+    for (int i = 0; i < count; ++i)
+        parents[i] = i;
+
+    int previousBandStart = -1;
+    int previousBandEnd = -1;
+    int bandStart = 0;
+
+    while (bandStart < count) {
+        const int bandTop = rects.at(bandStart).top();
+        int bandEnd = bandStart + 1;
+        while (bandEnd < count && rects.at(bandEnd).top() == bandTop)
+            ++bandEnd;
+
+        // Rectangles abutting within the band
+        for (int i = bandStart + 1; i < bandEnd; ++i)
+            if (rects.at(i - 1).right() + 1 >= rects.at(i).left())
+                uniteSets(parents, i - 1, i);
+
+        // Rectangles overlapping horizontally with the band above
+        if (previousBandStart != -1 &&
+                rects.at(previousBandStart).bottom() + 1 == bandTop) {
+            int a = previousBandStart;
+            int b = bandStart;
+            while (a < previousBandEnd && b < bandEnd) {
+                const QRect &above = rects.at(a);
+                const QRect &below = rects.at(b);
+                if (above.left() <= below.right() &&
+                        below.left() <= above.right())
+                    uniteSets(parents, a, b);
+
+                if (above.right() < below.right())
+                    ++a;
+                else
+                    ++b;
             }
         }
-        result += newCoherentRegion;
+
+        previousBandStart = bandStart;
+        previousBandEnd = bandEnd;
+        bandStart = bandEnd;
+    }
+
+    // Collect the rectangles of each component. They remain sorted and
+    // banded, so they can be set on the resulting regions directly.
+    QVector<int> componentIndexes(count, -1);
+    QVector<QVector<QRect> > components;
+
+    for (int i = 0; i < count; ++i) {
+        const int root = findSet(parents, i);
+        if (componentIndexes.at(root) == -1) {
+            componentIndexes[root] = components.size();
+            components.append(QVector<QRect>());
+        }
+        components[componentIndexes.at(root)].append(rects.at(i));
+    }
+
+    QList<QRegion> result;
+    foreach (const QVector<QRect> &componentRects, components) {
+        QRegion coherentRegion;
+        coherentRegion.setRects(componentRects.constData(),
+                                componentRects.size());
+        result.append(coherentRegion);
     }
     return result;
 }
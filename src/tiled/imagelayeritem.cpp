@@ -58,5 +58,6 @@ void ImageLayerItem::paint(QPainter *painter,
 {
     // TODO: Display a border around the layer when selected
     MapRenderer *renderer = mMapDocument->renderer();
-    renderer->drawImageLayer(painter, mLayer, option->exposedRect);
+    renderer->drawImageLayer(painter, mLayer, option->exposedRect,
+                             ImagePyramid::DrawAvailableTiles);
 }
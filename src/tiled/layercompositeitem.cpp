@@ -0,0 +1,199 @@
+/*
+ * layercompositeitem.cpp
+ * Copyright 2015, Sydoria Games <luax@sydoria.fr>
+ *
+ * This file is part of Tiled.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "layercompositeitem.h"
+
+#include "imagelayer.h"
+#include "map.h"
+#include "mapdocument.h"
+#include "maprenderer.h"
+#include "tilelayer.h"
+
+#include <QPainter>
+#include <QStyleOptionGraphicsItem>
+
+#include <cmath>
+
+using namespace Tiled;
+using namespace Tiled::Internal;
+
+/**
+ * The size of a cached chunk in device pixels.
+ */
+static const int chunkSize = 256;
+
+/**
+ * The maximum amount of cached chunks, about 64 MB worth of pixels.
+ */
+static const int maxChunks = 256;
+
+LayerCompositeItem::LayerCompositeItem(const QList<Layer*> &layers,
+                                       qreal opacityFactor,
+                                       MapDocument *mapDocument)
+    : mLayers(layers)
+    , mOpacityFactor(opacityFactor)
+    , mMapDocument(mapDocument)
+    , mScale(0)
+{
+    setFlag(QGraphicsItem::ItemUsesExtendedStyleOption);
+
+    syncWithLayers();
+}
+
+void LayerCompositeItem::syncWithLayers()
+{
+    prepareGeometryChange();
+
+    MapRenderer *renderer = mMapDocument->renderer();
+    QRectF boundingRect;
+
+    foreach (Layer *layer, mLayers) {
+        if (TileLayer *tileLayer = layer->asTileLayer()) {
+            const QMargins margins = tileLayer->drawMargins();
+            boundingRect |= QRectF(renderer->boundingRect(tileLayer->bounds()))
+                    .adjusted(-margins.left(),
+                              -margins.top(),
+                              margins.right(),
+                              margins.bottom());
+        } else if (ImageLayer *imageLayer = layer->asImageLayer()) {
+            boundingRect |= renderer->boundingRect(imageLayer);
+        }
+    }
+
+    mBoundingRect = boundingRect;
+    invalidate();
+}
+
+void LayerCompositeItem::invalidate(const QRectF &rect)
+{
+    if (mScale > 0) {
+        const qreal size = chunkSize / mScale;
+        const int left = std::floor(rect.left() / size);
+        const int top = std::floor(rect.top() / size);
+        const int right = std::floor(rect.right() / size);
+        const int bottom = std::floor(rect.bottom() / size);
+
+        for (int y = top; y <= bottom; ++y)
+            for (int x = left; x <= right; ++x)
+                mChunks.remove(ChunkIndex(x, y));
+    }
+}
+
+void LayerCompositeItem::invalidate()
+{
+    mChunks.clear();
+    update();
+}
+
+QRectF LayerCompositeItem::boundingRect() const
+{
+    return mBoundingRect;
+}
+
+void LayerCompositeItem::paint(QPainter *painter,
+                               const QStyleOptionGraphicsItem *option,
+                               QWidget *)
+{
+    const qreal scale = QStyleOptionGraphicsItem::levelOfDetailFromTransform(
+                painter->worldTransform());
+
+    if (scale != mScale) {
+        mChunks.clear();
+        mScale = scale;
+    }
+
+    const QRectF exposed = option->exposedRect & mBoundingRect;
+    if (exposed.isEmpty())
+        return;
+
+    const qreal size = chunkSize / mScale;
+    const int left = std::floor(exposed.left() / size);
+    const int top = std::floor(exposed.top() / size);
+    const int right = std::floor(exposed.right() / size);
+    const int bottom = std::floor(exposed.bottom() / size);
+
+    // Make room when the exposed chunks wouldn't fit in the cache
+    const int exposedChunks = (right - left + 1) * (bottom - top + 1);
+    if (mChunks.size() + exposedChunks > maxChunks)
+        mChunks.clear();
+
+    for (int y = top; y <= bottom; ++y) {
+        for (int x = left; x <= right; ++x) {
+            const ChunkIndex index(x, y);
+
+            QPixmap chunk = mChunks.value(index);
+            if (chunk.isNull()) {
+                bool complete;
+                chunk = renderChunk(index, &complete);
+
+                // Chunks missing parts of an image layer are rendered again
+                // once its tiles are decoded
+                if (complete && exposedChunks <= maxChunks)
+                    mChunks.insert(index, chunk);
+            }
+
+            painter->drawPixmap(chunkRect(index), chunk, QRectF(chunk.rect()));
+        }
+    }
+}
+
+QRectF LayerCompositeItem::chunkRect(const ChunkIndex &index) const
+{
+    const qreal size = chunkSize / mScale;
+    return QRectF(index.first * size, index.second * size, size, size);
+}
+
+/**
+ * Renders the visible layers within the given chunk at the current scale.
+ * Since alpha blending is associative, blending the composite onto the
+ * layers below it gives the same result as blending each layer separately.
+ *
+ * \a complete is set to whether the image layers could be fully drawn.
+ */
+QPixmap LayerCompositeItem::renderChunk(const ChunkIndex &index,
+                                        bool *complete) const
+{
+    const QRectF rect = chunkRect(index);
+
+    QPixmap chunk(chunkSize, chunkSize);
+    chunk.fill(Qt::transparent);
+
+    QPainter painter(&chunk);
+    painter.scale(mScale, mScale);
+    painter.translate(-rect.topLeft());
+
+    MapRenderer *renderer = mMapDocument->renderer();
+    *complete = true;
+
+    foreach (Layer *layer, mLayers) {
+        if (!layer->isVisible())
+            continue;
+
+        painter.setOpacity(layer->opacity() * mOpacityFactor);
+
+        if (TileLayer *tileLayer = layer->asTileLayer())
+            renderer->drawTileLayer(&painter, tileLayer, rect);
+        else if (ImageLayer *imageLayer = layer->asImageLayer())
+            *complete &= renderer->drawImageLayer(&painter, imageLayer, rect,
+                                                  ImagePyramid::DrawAvailableTiles);
+    }
+
+    return chunk;
+}
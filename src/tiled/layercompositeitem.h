@@ -0,0 +1,106 @@
+/*
+ * layercompositeitem.h
+ * Copyright 2015, Sydoria Games <luax@sydoria.fr>
+ *
+ * This file is part of Tiled.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef LAYERCOMPOSITEITEM_H
+#define LAYERCOMPOSITEITEM_H
+
+#include <QGraphicsItem>
+#include <QHash>
+#include <QList>
+#include <QPair>
+#include <QPixmap>
+
+namespace Tiled {
+
+class Layer;
+
+namespace Internal {
+
+class MapDocument;
+
+/**
+ * A graphics item that displays a run of tile and image layers flattened
+ * into a single image. Used by the MapScene for the layers that are not
+ * being edited while highlighting the current layer.
+ *
+ * The composite is cached in chunks of a fixed size in device pixels, which
+ * are rendered when they are first exposed and kept until they are
+ * invalidated or the scale changes. This way repainting the stack of layers
+ * around the current layer only costs a pixmap blit per chunk.
+ */
+class LayerCompositeItem : public QGraphicsItem
+{
+public:
+    /**
+     * Constructor.
+     *
+     * @param layers         the tile and image layers to be displayed, from
+     *                       bottom to top
+     * @param opacityFactor  factor applied to the opacity of each layer
+     * @param mapDocument    the map document owning the map of the layers
+     */
+    LayerCompositeItem(const QList<Layer*> &layers,
+                       qreal opacityFactor,
+                       MapDocument *mapDocument);
+
+    const QList<Layer*> &layers() const { return mLayers; }
+
+    /**
+     * Updates the size of this item. Should be called when the size of one
+     * of the layers, or of the map, has changed.
+     */
+    void syncWithLayers();
+
+    /**
+     * Drops the cached chunks overlapping \a rect, given in scene
+     * coordinates. Repainting the area is left to the caller.
+     */
+    void invalidate(const QRectF &rect);
+
+    /**
+     * Drops all cached chunks and schedules a repaint.
+     */
+    void invalidate();
+
+    // QGraphicsItem
+    QRectF boundingRect() const;
+    void paint(QPainter *painter,
+               const QStyleOptionGraphicsItem *option,
+               QWidget *widget = 0);
+
+private:
+    typedef QPair<int, int> ChunkIndex;
+
+    QRectF chunkRect(const ChunkIndex &index) const;
+    QPixmap renderChunk(const ChunkIndex &index, bool *complete) const;
+
+    QList<Layer*> mLayers;
+    qreal mOpacityFactor;
+    MapDocument *mMapDocument;
+    QRectF mBoundingRect;
+
+    qreal mScale;
+    QHash<ChunkIndex, QPixmap> mChunks;
+};
+
+} // namespace Internal
+} // namespace Tiled
+
+#endif // LAYERCOMPOSITEITEM_H
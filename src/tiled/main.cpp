@@ -20,6 +20,7 @@
  * this program. If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include "batchautomapper.h"
 #include "commandlineparser.h"
 #include "mainwindow.h"
 #include "languagemanager.h"
@@ -59,12 +60,14 @@ public:
     bool showedVersion;
     bool disableOpenGL;
     bool exportMap;
+    bool autoMap;
 
 private:
     void showVersion();
     void justQuit();
     void setDisableOpenGL();
     void setExportMap();
+    void setAutoMap();
 
     // Convenience wrapper around registerOption
     template <void (CommandLineHandler::*memberFunction)()>
@@ -87,6 +90,7 @@ CommandLineHandler::CommandLineHandler()
     , showedVersion(false)
     , disableOpenGL(false)
     , exportMap(false)
+    , autoMap(false)
 {
     option<&CommandLineHandler::showVersion>(
                 QLatin1Char('v'),
@@ -107,6 +111,11 @@ CommandLineHandler::CommandLineHandler()
                 QChar(),
                 QLatin1String("--export-map"),
                 QLatin1String("Export the specified tmx file to target"));
+
+    option<&CommandLineHandler::setAutoMap>(
+                QChar(),
+                QLatin1String("--automap"),
+                QLatin1String("Apply the rules file to the specified tmx files"));
 }
 
 void CommandLineHandler::showVersion()
@@ -134,6 +143,11 @@ void CommandLineHandler::setExportMap()
     exportMap = true;
 }
 
+void CommandLineHandler::setAutoMap()
+{
+    autoMap = true;
+}
+
 int main(int argc, char *argv[])
 {
     /*
@@ -256,6 +270,25 @@ int main(int argc, char *argv[])
         return 0;
     }
 
+    if (commandLine.autoMap) {
+        QStringList files = commandLine.filesToOpen();
+        if (files.length() < 2) {
+            qWarning() << qPrintable(QCoreApplication::translate("Command line",
+                                                                 "Automap syntax is --automap <rules file> <tmx files>"));
+            return 1;
+        }
+        const QString rulesFile = files.takeFirst();
+
+        BatchAutomapper batchAutomapper;
+        if (!batchAutomapper.loadRules(rulesFile)) {
+            qWarning() << qPrintable(batchAutomapper.errorString());
+            return 1;
+        }
+
+        const int failures = batchAutomapper.run(files);
+        return failures == 0 ? 0 : 1;
+    }
+
     MainWindow w;
     w.show();
 
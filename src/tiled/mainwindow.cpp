@@ -39,6 +39,7 @@
 #include "createpolygonobjecttool.h"
 #include "createpolylineobjecttool.h"
 #include "documentmanager.h"
+#include "editjournal.h"
 #include "editpolygontool.h"
 #include "eraser.h"
 #include "erasetiles.h"
@@ -63,6 +64,7 @@
 #include "objectselectiontool.h"
 #include "objectgroup.h"
 #include "offsetmapdialog.h"
+#include "pathfindingtool.h"
 #include "preferences.h"
 #include "preferencesdialog.h"
 #include "propertiesdock.h"
@@ -97,6 +99,7 @@
 #include <QMimeData>
 #include <QCloseEvent>
 #include <QComboBox>
+#include <QDir>
 #include <QFileDialog>
 #include <QMessageBox>
 #include <QScrollBar>
@@ -271,6 +274,7 @@ MainWindow::MainWindow(QWidget *parent, Qt::WindowFlags flags)
     mLayerMenu->addAction(mActionHandler->actionAddImageLayer());
     mLayerMenu->addAction(mActionHandler->actionDuplicateLayer());
     mLayerMenu->addAction(mActionHandler->actionMergeLayerDown());
+    mLayerMenu->addAction(mActionHandler->actionFlattenLayers());
     mLayerMenu->addAction(mActionHandler->actionRemoveLayer());
     mLayerMenu->addSeparator();
     mLayerMenu->addAction(mActionHandler->actionSelectPreviousLayer());
@@ -408,6 +412,7 @@ MainWindow::MainWindow(QWidget *parent, Qt::WindowFlags flags)
     toolBar->addAction(mToolManager->registerTool(mBucketFillTool));
     toolBar->addAction(mToolManager->registerTool(new Eraser(this)));
     toolBar->addAction(mToolManager->registerTool(new TileSelectionTool(this)));
+    toolBar->addAction(mToolManager->registerTool(new PathfindingTool(this)));
     //toolBar->addSeparator();
     //toolBar->addAction(mToolManager->registerTool(new ObjectSelectionTool(this)));
     //toolBar->addAction(mToolManager->registerTool(new EditPolygonTool(this)));
@@ -614,11 +619,46 @@ bool MainWindow::openFile(const QString &fileName,
         return false;
     }
 
+    if (EditJournal::canRecover(fileName))
+        mapDocument = recoverChanges(mapDocument);
+
     mDocumentManager->addDocument(mapDocument);
     setRecentFile(fileName);
     return true;
 }
 
+MapDocument *MainWindow::recoverChanges(MapDocument *mapDocument)
+{
+    const QString fileName = mapDocument->fileName();
+
+    int ret = QMessageBox::question(
+            this, tr("Recover Unsaved Changes"),
+            tr("Tiled was closed while there were unsaved changes to %1. "
+               "Do you want to recover them?")
+            .arg(QDir::toNativeSeparators(fileName)),
+            QMessageBox::Yes | QMessageBox::No);
+
+    if (ret != QMessageBox::Yes) {
+        EditJournal::discard(fileName);
+        return mapDocument;
+    }
+
+    QString error;
+    Map *map = EditJournal::recover(mapDocument->map(), fileName, &error);
+    if (!map) {
+        QMessageBox::critical(this, tr("Error Recovering Changes"), error);
+        return mapDocument;
+    }
+
+    MapDocument *recovered = new MapDocument(map, fileName);
+    recovered->setReaderPluginFileName(mapDocument->readerPluginFileName());
+    recovered->setWriterPluginFileName(mapDocument->writerPluginFileName());
+    recovered->markRecovered();
+
+    delete mapDocument;
+    return recovered;
+}
+
 bool MainWindow::openFile(const QString &fileName)
 {
     return openFile(fileName, 0);
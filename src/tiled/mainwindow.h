@@ -196,6 +196,15 @@ private:
       */
     bool confirmAllSave();
 
+    /**
+     * Offers to recover the changes to the given document that were lost
+     * when Tiled was closed unexpectedly.
+     *
+     * @return the document to use, which replaces \a mapDocument when the
+     *         changes were recovered
+     */
+    MapDocument *recoverChanges(MapDocument *mapDocument);
+
     /**
      * Save the current map to the given file name. When saved succesfully, the
      * file is added to the list of recent files.
@@ -50,6 +50,7 @@
 #include "terrainmodel.h"
 #include "tile.h"
 #include "tilelayer.h"
+#include "tilepainter.h"
 #include "tilesetmanager.h"
 #include "tileset.h"
 #include "tmxmapreader.h"
@@ -57,11 +58,107 @@
 
 #include <QFileInfo>
 #include <QRect>
+#include <QRunnable>
+#include <QThreadPool>
 #include <QUndoStack>
+#include <QVector>
 
 using namespace Tiled;
 using namespace Tiled::Internal;
 
+namespace {
+
+/**
+ * The amount of rows of the upper layer scanned by a single job when
+ * merging tile layers.
+ */
+const int mergeBandHeight = 64;
+
+/**
+ * Finds the runs of cells within a band of rows of the upper layer that
+ * would change the lower layer when painted onto it. The runs are stored
+ * in map coordinates.
+ */
+class ChangedRunsJob : public QRunnable
+{
+public:
+    ChangedRunsJob(const TileLayer *lower, const TileLayer *upper,
+                   int top, int bottom,
+                   QVector<QRect> *runs)
+        : mLower(lower)
+        , mUpper(upper)
+        , mOffset(upper->position() - lower->position())
+        , mTop(top)
+        , mBottom(bottom)
+        , mRuns(runs)
+    {}
+
+    void run()
+    {
+        const int width = mUpper->width();
+
+        for (int y = mTop; y <= mBottom; ++y) {
+            for (int x = 0; x < width; ++x) {
+                if (!changes(x, y))
+                    continue;
+
+                const int start = x;
+                while (x + 1 < width && changes(x + 1, y))
+                    ++x;
+
+                mRuns->append(QRect(start + mUpper->x(), y + mUpper->y(),
+                                    x - start + 1, 1));
+            }
+        }
+    }
+
+private:
+    bool changes(int x, int y) const
+    {
+        const Cell &cell = mUpper->cellAt(x, y);
+        return !cell.isEmpty() &&
+                cell != mLower->cellAt(x + mOffset.x(), y + mOffset.y());
+    }
+
+    const TileLayer *mLower;
+    const TileLayer *mUpper;
+    const QPoint mOffset;
+    const int mTop;
+    const int mBottom;
+    QVector<QRect> *mRuns;
+};
+
+} // anonymous namespace
+
+/**
+ * Returns the region of cells of \a lower that would change when \a upper
+ * is painted onto it. The bands of rows are scanned in parallel.
+ */
+static QRegion changedRegion(const TileLayer *lower, const TileLayer *upper)
+{
+    const int bandCount =
+            (upper->height() + mergeBandHeight - 1) / mergeBandHeight;
+    QVector<QVector<QRect> > bands(bandCount);
+
+    QThreadPool threadPool;
+    for (int i = 0; i < bandCount; ++i) {
+        const int top = i * mergeBandHeight;
+        const int bottom = qMin(top + mergeBandHeight, upper->height()) - 1;
+        threadPool.start(new ChangedRunsJob(lower, upper, top, bottom,
+                                            &bands[i]));
+    }
+    threadPool.waitForDone();
+
+    QVector<QRect> runs;
+    foreach (const QVector<QRect> &band, bands)
+        runs += band;
+
+    // The runs are one row high and sorted, so they form a valid region
+    QRegion region;
+    region.setRects(runs.constData(), runs.size());
+    return region;
+}
+
 MapDocument::MapDocument(Map *map, const QString &fileName):
     mFileName(fileName),
     mMap(map),
@@ -70,7 +167,8 @@ MapDocument::MapDocument(Map *map, const QString &fileName):
     mRenderer(0),
     mMapObjectModel(new MapObjectModel(this)),
     mTerrainModel(new TerrainModel(this, this)),
-    mUndoStack(new QUndoStack(this))
+    mUndoStack(new QUndoStack(this)),
+    mRecovered(false)
 {
     createRenderer();
 
@@ -127,6 +225,9 @@ bool MapDocument::save(QString *error)
 
 bool MapDocument::save(const QString &fileName, QString *error)
 {
+    // The writers need the cells
+    wakeUp();
+
     PluginManager *pm = PluginManager::instance();
 
     MapWriterInterface *chosenWriter = 0;
@@ -143,7 +244,13 @@ bool MapDocument::save(const QString &fileName, QString *error)
         return false;
     }
 
+    const bool wasRecovered = mRecovered;
+    mRecovered = false;
+
     undoStack()->setClean();
+    if (wasRecovered)
+        emit modifiedChanged();
+
     setFileName(fileName);
     mLastSaved = QFileInfo(fileName).lastModified();
 
@@ -225,7 +332,49 @@ QString MapDocument::displayName() const
  */
 bool MapDocument::isModified() const
 {
-    return !mUndoStack->isClean();
+    return mRecovered || !mUndoStack->isClean();
+}
+
+void MapDocument::markRecovered()
+{
+    mRecovered = true;
+    emit modifiedChanged();
+}
+
+qint64 MapDocument::tileMemoryUsage() const
+{
+    if (isHibernated())
+        return 0;
+
+    qint64 usage = 0;
+    foreach (const Layer *layer, mMap->layers())
+        if (const TileLayer *tileLayer = layer->asTileLayer())
+            usage += qint64(tileLayer->width()) * tileLayer->height()
+                    * sizeof(Cell);
+
+    return usage;
+}
+
+void MapDocument::hibernate()
+{
+    if (isHibernated())
+        return;
+
+    emit aboutToHibernate();
+
+    foreach (Layer *layer, mMap->layers())
+        if (TileLayer *tileLayer = layer->asTileLayer())
+            mHibernatedCells.insert(tileLayer, tileLayer->compressCells());
+}
+
+void MapDocument::wakeUp()
+{
+    QHash<TileLayer*, QByteArray>::const_iterator it = mHibernatedCells.begin();
+    QHash<TileLayer*, QByteArray>::const_iterator it_end = mHibernatedCells.end();
+    for (; it != it_end; ++it)
+        it.key()->uncompressCells(it.value());
+
+    mHibernatedCells.clear();
 }
 
 void MapDocument::setCurrentLayerIndex(int index)
@@ -474,6 +623,20 @@ void MapDocument::mergeLayerDown()
     if (!lowerLayer->canMergeWith(upperLayer))
         return;
 
+    TileLayer *lowerTileLayer = lowerLayer->asTileLayer();
+    TileLayer *upperTileLayer = upperLayer->asTileLayer();
+
+    // When the lower layer covers the upper one, only the cells that change
+    // need to be painted onto it
+    if (lowerTileLayer && upperTileLayer &&
+            lowerTileLayer->bounds().contains(upperTileLayer->bounds())) {
+        mUndoStack->beginMacro(tr("Merge Layer Down"));
+        paintTileLayerOnto(lowerTileLayer, upperTileLayer);
+        mUndoStack->push(new RemoveLayer(this, mCurrentLayerIndex));
+        mUndoStack->endMacro();
+        return;
+    }
+
     Layer *merged = lowerLayer->mergedWith(upperLayer);
 
     mUndoStack->beginMacro(tr("Merge Layer Down"));
@@ -483,6 +646,75 @@ void MapDocument::mergeLayerDown()
     mUndoStack->endMacro();
 }
 
+/**
+ * Paints all visible tile layers onto the lowest visible tile layer, and
+ * removes them. Stops at the first visible tile layer that extends beyond
+ * the lowest one, since the layers above it can't be moved below it. Also
+ * stops at the first visible layer of another type above the lowest one,
+ * since moving tiles below it would change what is drawn on top.
+ */
+void MapDocument::flattenVisibleTileLayers()
+{
+    TileLayer *target = 0;
+    QList<int> flattened;
+
+    for (int i = 0; i < mMap->layerCount(); ++i) {
+        Layer *layer = mMap->layerAt(i);
+        if (!layer->isVisible())
+            continue;
+
+        TileLayer *tileLayer = layer->asTileLayer();
+        if (!tileLayer) {
+            if (target)
+                break;
+            continue;
+        }
+
+        if (!target)
+            target = tileLayer;
+        else if (target->bounds().contains(tileLayer->bounds()))
+            flattened.append(i);
+        else
+            break;
+    }
+
+    if (flattened.isEmpty())
+        return;
+
+    mUndoStack->beginMacro(tr("Flatten Visible Tile Layers"));
+
+    foreach (int index, flattened)
+        paintTileLayerOnto(target, mMap->layerAt(index)->asTileLayer());
+
+    for (int i = flattened.size() - 1; i >= 0; --i)
+        mUndoStack->push(new RemoveLayer(this, flattened.at(i)));
+
+    mUndoStack->endMacro();
+}
+
+/**
+ * Paints the non-empty cells of \a upper onto \a lower, which needs to
+ * cover it. The undo command only stores the cells that actually changed.
+ */
+void MapDocument::paintTileLayerOnto(TileLayer *lower, const TileLayer *upper)
+{
+    const QRegion changed = changedRegion(lower, upper);
+    if (changed.isEmpty())
+        return;
+
+    const QRect bounds = changed.boundingRect();
+    TileLayer *source = upper->copy(changed.translated(-upper->position()));
+    TileLayer *erased = lower->copy(changed.translated(-lower->position()));
+
+    // The whole upper layer is merged, regardless of the tile selection
+    TilePainter painter(this, lower);
+    painter.restoreCells(bounds.x(), bounds.y(), source, changed);
+
+    mUndoStack->push(new PaintTileLayer(this, lower,
+                                        bounds.x(), bounds.y(),
+                                        source, erased, changed));
+}
+
 /**
  * Moves the given layer up. Does nothing when no valid layer index is
  * given.
@@ -671,15 +903,20 @@ void MapDocument::unifyTilesets(Map *map)
         // Merge the tile properties
         const int sharedTileCount = qMin(tileset->tileCount(),
                                          replacement->tileCount());
+        QList<Object*> tiles;
+        QVector<Properties> tileProperties;
         for (int i = 0; i < sharedTileCount; ++i) {
             Tile *replacementTile = replacement->tileAt(i);
             Properties properties = replacementTile->properties();
             properties.merge(tileset->tileAt(i)->properties());
+            tiles.append(replacementTile);
+            tileProperties.append(properties);
+        }
+        if (!tiles.isEmpty())
             undoCommands.append(new ChangeProperties(this,
                                                      tr("Tile"),
-                                                     replacementTile,
-                                                     properties));
-        }
+                                                     tiles,
+                                                     tileProperties));
         map->replaceTileset(tileset, replacement);
 
         tilesetManager->addReference(replacement);
@@ -702,6 +939,7 @@ void MapDocument::unifyTilesets(Map *map)
 void MapDocument::emitTilesetChanged(Tileset *tileset)
 {
     Q_ASSERT(mMap->tilesets().contains(tileset));
+    TilesetManager::instance()->collisionCache()->invalidate(tileset);
     emit tilesetChanged(tileset);
 }
 
@@ -905,6 +1143,17 @@ void MapDocument::setProperties(Object *object, const Properties &properties)
     emit propertiesChanged(object);
 }
 
+void MapDocument::setProperties(const QList<Object*> &objects,
+                                const QVector<Properties> &properties)
+{
+    Q_ASSERT(objects.size() == properties.size());
+
+    for (int i = 0; i < objects.size(); ++i)
+        objects.at(i)->setProperties(properties.at(i));
+
+    emit propertiesChanged(objects);
+}
+
 void MapDocument::removeProperty(Object *object, const QString &name)
 {
     object->removeProperty(name);
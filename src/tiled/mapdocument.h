@@ -27,11 +27,14 @@
 #include "tiled.h"
 #include "mapobject.h"
 
+#include <QByteArray>
 #include <QDateTime>
+#include <QHash>
 #include <QList>
 #include <QObject>
 #include <QRegion>
 #include <QString>
+#include <QVector>
 
 class QModelIndex;
 class QPoint;
@@ -126,8 +129,32 @@ public:
 
     bool isModified() const;
 
+    /**
+     * Marks the document as modified until it is saved. Used for maps that
+     * were recovered from an edit journal, since their changes are not on
+     * the undo stack.
+     */
+    void markRecovered();
+
     QDateTime lastSaved() const { return mLastSaved; }
 
+    /**
+     * Returns an estimate of the memory taken by the tile layers of the map,
+     * in bytes. Returns 0 while hibernated.
+     */
+    qint64 tileMemoryUsage() const;
+
+    /**
+     * Compresses the cells of all tile layers to save memory while the
+     * document isn't being edited. The cells may not be accessed until the
+     * document is woken up again.
+     *
+     * Layers that are only referenced by the undo stack are left alone.
+     */
+    void hibernate();
+    void wakeUp();
+    bool isHibernated() const { return !mHibernatedCells.isEmpty(); }
+
     /**
      * Returns the map instance. Be aware that directly modifying the map will
      * not allow the GUI to update itself appropriately.
@@ -172,6 +199,7 @@ public:
     void addLayer(Layer::TypeFlag layerType);
     void duplicateLayer();
     void mergeLayerDown();
+    void flattenVisibleTileLayers();
     void moveLayerUp(int index);
     void moveLayerDown(int index);
     void removeLayer(int index);
@@ -193,6 +221,14 @@ public:
     void setProperties(Object *object, const Properties &properties);
     void removeProperty(Object *object, const QString &name);
 
+    /**
+     * Replaces the properties of each of the \a objects with the matching
+     * entry of \a properties. The change is reported once for all objects,
+     * which keeps tagging a large selection fast.
+     */
+    void setProperties(const QList<Object*> &objects,
+                       const QVector<Properties> &properties);
+
     /**
      * Returns the layer model. Can be used to modify the layer stack of the
      * map, and to display the layer stack in a view.
@@ -269,7 +305,7 @@ public:
     void unifyTilesets(Map *map);
 
     void emitMapChanged();
-    void emitRegionChanged(const QRegion &region);
+    void emitRegionChanged(const QRegion &region, Layer *layer);
     void emitRegionEdited(const QRegion &region, Layer *layer);
     void emitTileLayerDrawMarginsChanged(TileLayer *layer);
     void emitTilesetChanged(Tileset *tileset);
@@ -333,9 +369,10 @@ signals:
 
     /**
      * Emitted when a certain region of the map changes. The region is given in
-     * tile coordinates.
+     * tile coordinates. The \a layer is the layer that changed, or 0 when
+     * the change may affect several layers.
      */
-    void regionChanged(const QRegion &region);
+    void regionChanged(const QRegion &region, Layer *layer);
 
     /**
      * Emitted when a certain region of the map was edited by user input.
@@ -394,6 +431,16 @@ signals:
     void propertyChanged(Object *object, const QString &name);
     void propertiesChanged(Object *object);
 
+    /**
+     * Emitted when the properties of the \a objects were changed at once.
+     */
+    void propertiesChanged(const QList<Object*> &objects);
+
+    /**
+     * Emitted before the tile layers are compressed by hibernate().
+     */
+    void aboutToHibernate();
+
 private slots:
     void onObjectsRemoved(const QList<MapObject*> &objects);
 
@@ -411,6 +458,7 @@ private slots:
 private:
     void setFileName(const QString &fileName);
     void deselectObjects(const QList<MapObject*> &objects);
+    void paintTileLayerOnto(TileLayer *lower, const TileLayer *upper);
 
     QString mFileName;
     QString mLastExportFileName;
@@ -437,6 +485,8 @@ private:
     TerrainModel *mTerrainModel;
     QUndoStack *mUndoStack;
     QDateTime mLastSaved;
+    bool mRecovered;
+    QHash<TileLayer*, QByteArray> mHibernatedCells;
 };
 
 inline QString MapDocument::lastExportFileName() const
@@ -492,9 +542,10 @@ inline void MapDocument::emitMapChanged()
  * Emits the region changed signal for the specified region. The region
  * should be in tile coordinates. This method is used by the TilePainter.
  */
-inline void MapDocument::emitRegionChanged(const QRegion &region)
+inline void MapDocument::emitRegionChanged(const QRegion &region,
+                                           Layer *layer)
 {
-    emit regionChanged(region);
+    emit regionChanged(region, layer);
 }
 
 /**
@@ -67,6 +67,8 @@ MapDocumentActionHandler::MapDocumentActionHandler(QObject *parent)
 
     mActionMergeLayerDown = new QAction(this);
 
+    mActionFlattenLayers = new QAction(this);
+
     mActionRemoveLayer = new QAction(this);
     mActionRemoveLayer->setIcon(
             QIcon(QLatin1String(":/images/16x16/edit-delete.png")));
@@ -120,6 +122,8 @@ MapDocumentActionHandler::MapDocumentActionHandler(QObject *parent)
             SLOT(duplicateLayer()));
     connect(mActionMergeLayerDown, SIGNAL(triggered()),
             SLOT(mergeLayerDown()));
+    connect(mActionFlattenLayers, SIGNAL(triggered()),
+            SLOT(flattenLayers()));
     connect(mActionSelectPreviousLayer, SIGNAL(triggered()),
             SLOT(selectPreviousLayer()));
     connect(mActionSelectNextLayer, SIGNAL(triggered()),
@@ -154,6 +158,7 @@ void MapDocumentActionHandler::retranslateUi()
     mActionAddImageLayer->setText(tr("Add &Image Layer"));
     mActionDuplicateLayer->setText(tr("&Duplicate Layer"));
     mActionMergeLayerDown->setText(tr("&Merge Layer Down"));
+    mActionFlattenLayers->setText(tr("&Flatten Visible Tile Layers"));
     mActionRemoveLayer->setText(tr("&Remove Layer"));
     mActionSelectPreviousLayer->setText(tr("Select Pre&vious Layer"));
     mActionSelectNextLayer->setText(tr("Select &Next Layer"));
@@ -283,6 +288,12 @@ void MapDocumentActionHandler::mergeLayerDown()
         mMapDocument->mergeLayerDown();
 }
 
+void MapDocumentActionHandler::flattenLayers()
+{
+    if (mMapDocument)
+        mMapDocument->flattenVisibleTileLayers();
+}
+
 void MapDocumentActionHandler::selectPreviousLayer()
 {
     if (mMapDocument) {
@@ -390,6 +401,7 @@ void MapDocumentActionHandler::updateActions()
 
     mActionDuplicateLayer->setEnabled(currentLayerIndex >= 0);
     mActionMergeLayerDown->setEnabled(canMergeDown);
+    mActionFlattenLayers->setEnabled(layerCount > 1);
     mActionSelectPreviousLayer->setEnabled(hasPreviousLayer);
     mActionSelectNextLayer->setEnabled(hasNextLayer);
     mActionMoveLayerUp->setEnabled(hasPreviousLayer);
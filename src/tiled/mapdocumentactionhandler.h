@@ -62,6 +62,7 @@ public:
     QAction *actionAddImageLayer() const { return mActionAddImageLayer; }
     QAction *actionDuplicateLayer() const { return mActionDuplicateLayer; }
     QAction *actionMergeLayerDown() const { return mActionMergeLayerDown; }
+    QAction *actionFlattenLayers() const { return mActionFlattenLayers; }
     QAction *actionRemoveLayer() const { return mActionRemoveLayer; }
     QAction *actionSelectPreviousLayer() const
     { return mActionSelectPreviousLayer; }
@@ -91,6 +92,7 @@ public slots:
     void addImageLayer();
     void duplicateLayer();
     void mergeLayerDown();
+    void flattenLayers();
     void selectPreviousLayer();
     void selectNextLayer();
     void moveLayerUp();
@@ -118,6 +120,7 @@ private:
     QAction *mActionAddImageLayer;
     QAction *mActionDuplicateLayer;
     QAction *mActionMergeLayerDown;
+    QAction *mActionFlattenLayers;
     QAction *mActionRemoveLayer;
     QAction *mActionSelectPreviousLayer;
     QAction *mActionSelectNextLayer;
@@ -38,10 +38,13 @@
 #include "tileselectionitem.h"
 #include "imagelayer.h"
 #include "imagelayeritem.h"
+#include "imagepyramid.h"
+#include "layercompositeitem.h"
 #include "toolmanager.h"
 #include "tilesetmanager.h"
 
 #include <QGraphicsSceneMouseEvent>
+#include <QStyleOptionGraphicsItem>
 #include <QPainter>
 #include <QKeyEvent>
 #include <QApplication>
@@ -54,24 +57,52 @@ using namespace Tiled::Internal;
 static const qreal darkeningFactor = 0.6;
 static const qreal opacityFactor = 0.4;
 
+/**
+ * The interval at which changed regions are repainted, about one frame at
+ * 60 Hz.
+ */
+static const int repaintInterval = 16;
+
+/**
+ * Beyond this amount of rects, a dirty region is replaced by its bounding
+ * rect, since repainting a bit more is cheaper than handling many updates.
+ */
+static const int maxDirtyRects = 16;
+
+/**
+ * The size of a cached grid chunk in device pixels. Since the grid only
+ * covers the visible area, a modest amount of chunks is enough.
+ */
+static const int gridChunkSize = 256;
+static const int maxGridChunks = 128;
+
 MapScene::MapScene(QObject *parent):
     QGraphicsScene(parent),
     mMapDocument(0),
+    mHibernatedDocument(0),
     mSelectedTool(0),
     mActiveTool(0),
     mUnderMouse(false),
     mCurrentModifiers(Qt::NoModifier),
     mDarkRectangle(new QGraphicsRectItem),
-    mDefaultBackgroundColor(Qt::darkGray)
+    mDefaultBackgroundColor(Qt::darkGray),
+    mGridScale(0)
 {
     setBackgroundBrush(mDefaultBackgroundColor);
 
+    mRepaintTimer.setSingleShot(true);
+    mRepaintTimer.setInterval(repaintInterval);
+    connect(&mRepaintTimer, SIGNAL(timeout()), SLOT(flushDirtyRegion()));
+
     TilesetManager *tilesetManager = TilesetManager::instance();
     connect(tilesetManager, SIGNAL(tilesetChanged(Tileset*)),
             this, SLOT(tilesetChanged(Tileset*)));
     connect(tilesetManager, SIGNAL(repaintTileset(Tileset*)),
             this, SLOT(tilesetChanged(Tileset*)));
 
+    connect(ImagePyramidNotifier::instance(), SIGNAL(tilesDecoded()),
+            this, SLOT(imageTilesDecoded()));
+
     Preferences *prefs = Preferences::instance();
     connect(prefs, SIGNAL(showGridChanged(bool)), SLOT(setGridVisible(bool)));
     connect(prefs, SIGNAL(showTileObjectOutlinesChanged(bool)),
@@ -115,6 +146,9 @@ void MapScene::setMapDocument(MapDocument *mapDocument)
     }
 
     mMapDocument = mapDocument;
+    mHibernatedDocument = 0;
+    mDirtyRegion = QRegion();
+    mRepaintTimer.stop();
 
     if (mMapDocument) {
         MapRenderer *renderer = mMapDocument->renderer();
@@ -123,8 +157,8 @@ void MapScene::setMapDocument(MapDocument *mapDocument)
 
         connect(mMapDocument, SIGNAL(mapChanged()),
                 this, SLOT(mapChanged()));
-        connect(mMapDocument, SIGNAL(regionChanged(QRegion)),
-                this, SLOT(repaintRegion(QRegion)));
+        connect(mMapDocument, SIGNAL(regionChanged(QRegion,Layer*)),
+                this, SLOT(repaintRegion(QRegion,Layer*)));
         connect(mMapDocument, SIGNAL(tileLayerDrawMarginsChanged(TileLayer*)),
                 this, SLOT(tileLayerDrawMarginsChanged(TileLayer*)));
         connect(mMapDocument, SIGNAL(layerAdded(int)),
@@ -156,6 +190,29 @@ void MapScene::setMapDocument(MapDocument *mapDocument)
     refreshScene();
 }
 
+void MapScene::hibernate()
+{
+    if (!mMapDocument)
+        return;
+
+    MapDocument *mapDocument = mMapDocument;
+    const QRectF rect = sceneRect();
+
+    setMapDocument(0);
+    setSceneRect(rect);
+    mHibernatedDocument = mapDocument;
+}
+
+void MapScene::wakeUp()
+{
+    if (!mHibernatedDocument)
+        return;
+
+    MapDocument *mapDocument = mHibernatedDocument;
+    mHibernatedDocument = 0;
+    setMapDocument(mapDocument);
+}
+
 void MapScene::setSelectedObjectItems(const QSet<MapObjectItem *> &items)
 {
     // Inform the map document about the newly selected objects
@@ -177,6 +234,8 @@ void MapScene::refreshScene()
 {
     mLayerItems.clear();
     mObjectItems.clear();
+    mLayerComposites.clear();
+    clearGridCache();
 
     removeItem(mDarkRectangle);
     clear();
@@ -254,6 +313,8 @@ void MapScene::updateCurrentLayerHighlight()
 
     const int currentLayerIndex = mMapDocument->currentLayerIndex();
 
+    removeLayerComposites();
+
     if (!mHighlightCurrentLayer || currentLayerIndex == -1) {
         mDarkRectangle->setVisible(false);
 
@@ -276,19 +337,121 @@ void MapScene::updateCurrentLayerHighlight()
         const qreal multiplier = (currentLayerIndex < i) ? opacityFactor : 1;
         mLayerItems.at(i)->setOpacity(layer->opacity() * multiplier);
     }
+
+    createLayerComposites(currentLayerIndex);
+}
+
+/**
+ * Replaces each run of tile and image layers below and above the current
+ * layer by a LayerCompositeItem. Object groups are left as they are, since
+ * their objects need to stay interactive.
+ */
+void MapScene::createLayerComposites(int currentLayerIndex)
+{
+    const Map *map = mMapDocument->map();
+    const int layerCount = mLayerItems.size();
+
+    QList<Layer*> run;
+    int runStart = 0;
+
+    for (int i = 0; i <= layerCount; ++i) {
+        Layer *layer = i < layerCount ? map->layerAt(i) : 0;
+        const bool composited = layer && i != currentLayerIndex &&
+                !layer->isObjectGroup();
+
+        if (composited) {
+            if (run.isEmpty())
+                runStart = i;
+            run.append(layer);
+            continue;
+        }
+
+        if (run.isEmpty())
+            continue;
+
+        const qreal multiplier = (currentLayerIndex < runStart) ? opacityFactor
+                                                                : 1;
+        LayerCompositeItem *composite = new LayerCompositeItem(run,
+                                                               multiplier,
+                                                               mMapDocument);
+        composite->setZValue(runStart);
+        addItem(composite);
+        mLayerComposites.append(composite);
+
+        for (int j = runStart; j < runStart + run.size(); ++j)
+            mLayerItems.at(j)->setVisible(false);
+
+        run.clear();
+    }
+}
+
+void MapScene::removeLayerComposites()
+{
+    if (mLayerComposites.isEmpty())
+        return;
+
+    qDeleteAll(mLayerComposites);
+    mLayerComposites.clear();
+
+    for (int i = 0; i < mLayerItems.size(); ++i) {
+        const Layer *layer = mMapDocument->map()->layerAt(i);
+        mLayerItems.at(i)->setVisible(layer->isVisible());
+    }
+}
+
+LayerCompositeItem *MapScene::layerCompositeFor(const Layer *layer) const
+{
+    foreach (LayerCompositeItem *composite, mLayerComposites)
+        foreach (const Layer *compositeLayer, composite->layers())
+            if (compositeLayer == layer)
+                return composite;
+
+    return 0;
 }
 
-void MapScene::repaintRegion(const QRegion &region)
+void MapScene::repaintRegion(const QRegion &region, Layer *layer)
 {
     const MapRenderer *renderer = mMapDocument->renderer();
-    const QMargins margins = mMapDocument->map()->drawMargins();
+    QMargins margins = mMapDocument->map()->drawMargins();
+    if (layer && layer->isTileLayer())
+        margins = static_cast<TileLayer*>(layer)->drawMargins();
+
+    QVector<QRect> rects = region.rects();
+    if (rects.size() > maxDirtyRects) {
+        rects.clear();
+        rects.append(region.boundingRect());
+    }
 
-    foreach (const QRect &r, region.rects()) {
-        update(renderer->boundingRect(r).adjusted(-margins.left(),
-                                                  -margins.top(),
-                                                  margins.right(),
-                                                  margins.bottom()));
+    LayerCompositeItem *composite = layer ? layerCompositeFor(layer) : 0;
+
+    foreach (const QRect &r, rects) {
+        const QRect sceneRect = renderer->boundingRect(r).adjusted(-margins.left(),
+                                                                   -margins.top(),
+                                                                   margins.right(),
+                                                                   margins.bottom());
+        mDirtyRegion += sceneRect;
+
+        if (composite) {
+            composite->invalidate(sceneRect);
+        } else if (!layer) {
+            foreach (LayerCompositeItem *item, mLayerComposites)
+                item->invalidate(sceneRect);
+        }
     }
+
+    if (mDirtyRegion.rectCount() > maxDirtyRects)
+        mDirtyRegion = mDirtyRegion.boundingRect();
+
+    if (!mRepaintTimer.isActive())
+        mRepaintTimer.start();
+}
+
+void MapScene::flushDirtyRegion()
+{
+    foreach (const QRect &r, mDirtyRegion.rects())
+        update(r);
+
+    mDirtyRegion = QRegion();
 }
 
 void MapScene::enableSelectedTool()
@@ -331,6 +494,8 @@ void MapScene::currentLayerIndexChanged()
  */
 void MapScene::mapChanged()
 {
+    clearGridCache();
+
     const QSize mapSize = mMapDocument->renderer()->mapSize();
     setSceneRect(0, 0, mapSize.width(), mapSize.height());
     mDarkRectangle->setRect(0, 0, mapSize.width(), mapSize.height());
@@ -343,6 +508,9 @@ void MapScene::mapChanged()
     foreach (MapObjectItem *item, mObjectItems)
         item->syncWithMapObject();
 
+    foreach (LayerCompositeItem *composite, mLayerComposites)
+        composite->syncWithLayers();
+
     const Map *map = mMapDocument->map();
     if (map->backgroundColor().isValid())
         setBackgroundBrush(map->backgroundColor());
@@ -355,8 +523,11 @@ void MapScene::tilesetChanged(Tileset *tileset)
     if (!mMapDocument)
         return;
 
-    if (mMapDocument->map()->tilesets().contains(tileset))
+    if (mMapDocument->map()->tilesets().contains(tileset)) {
+        foreach (LayerCompositeItem *composite, mLayerComposites)
+            composite->invalidate();
         update();
+    }
 }
 
 void MapScene::tileLayerDrawMarginsChanged(TileLayer *tileLayer)
@@ -364,6 +535,9 @@ void MapScene::tileLayerDrawMarginsChanged(TileLayer *tileLayer)
     const int index = mMapDocument->map()->layers().indexOf(tileLayer);
     TileLayerItem *item = static_cast<TileLayerItem*>(mLayerItems.at(index));
     item->syncWithTileLayer();
+
+    if (LayerCompositeItem *composite = layerCompositeFor(tileLayer))
+        composite->syncWithLayers();
 }
 
 void MapScene::layerAdded(int index)
@@ -376,12 +550,16 @@ void MapScene::layerAdded(int index)
     int z = 0;
     foreach (QGraphicsItem *item, mLayerItems)
         item->setZValue(z++);
+
+    updateCurrentLayerHighlight();
 }
 
 void MapScene::layerRemoved(int index)
 {
     delete mLayerItems.at(index);
     mLayerItems.remove(index);
+
+    updateCurrentLayerHighlight();
 }
 
 /**
@@ -400,6 +578,11 @@ void MapScene::layerChanged(int index)
         multiplier = opacityFactor;
 
     layerItem->setOpacity(layer->opacity() * multiplier);
+
+    if (LayerCompositeItem *composite = layerCompositeFor(layer)) {
+        layerItem->setVisible(false);
+        composite->invalidate();
+    }
 }
 
 /**
@@ -423,6 +606,34 @@ void MapScene::imageLayerChanged(ImageLayer *imageLayer)
 
     item->syncWithImageLayer();
     item->update();
+
+    if (LayerCompositeItem *composite = layerCompositeFor(imageLayer))
+        composite->syncWithLayers();
+}
+
+/**
+ * Repaints the image layers, which may have been drawn before their tiles
+ * were decoded.
+ */
+void MapScene::imageTilesDecoded()
+{
+    if (!mMapDocument)
+        return;
+
+    const Map *map = mMapDocument->map();
+    const int count = qMin(mLayerItems.size(), map->layerCount());
+    for (int i = 0; i < count; ++i)
+        if (map->layerAt(i)->isImageLayer())
+            mLayerItems.at(i)->update();
+
+    foreach (LayerCompositeItem *composite, mLayerComposites) {
+        foreach (const Layer *layer, composite->layers()) {
+            if (layer->isImageLayer()) {
+                composite->update();
+                break;
+            }
+        }
+    }
 }
 
 /**
@@ -437,6 +648,9 @@ void MapScene::tilesetTileOffsetChanged(Tileset *tileset)
         if (TileLayerItem *tli = dynamic_cast<TileLayerItem*>(item))
             tli->syncWithTileLayer();
 
+    foreach (LayerCompositeItem *composite, mLayerComposites)
+        composite->syncWithLayers();
+
     foreach (MapObjectItem *item, mObjectItems) {
         const Cell &cell = item->mapObject()->cell();
         if (!cell.isEmpty() && cell.tile->tileset() == tileset)
@@ -611,8 +825,81 @@ void MapScene::drawForeground(QPainter *painter, const QRectF &rect)
     if (!mMapDocument || !mGridVisible)
         return;
 
-    Preferences *prefs = Preferences::instance();
-    mMapDocument->renderer()->drawGrid(painter, rect, prefs->gridColor());
+    const QColor gridColor = Preferences::instance()->gridColor();
+    const qreal scale = QStyleOptionGraphicsItem::levelOfDetailFromTransform(
+                painter->worldTransform());
+
+    if (scale != mGridScale || gridColor != mGridColor) {
+        clearGridCache();
+        mGridScale = scale;
+        mGridColor = gridColor;
+    }
+
+    // Include the lines on the edge of the map
+    const qreal pixel = 1 / mGridScale;
+    const QRectF exposed = rect & sceneRect().adjusted(-pixel, -pixel,
+                                                       pixel, pixel);
+    if (exposed.isEmpty())
+        return;
+
+    const qreal size = gridChunkSize / mGridScale;
+    const int left = std::floor(exposed.left() / size);
+    const int top = std::floor(exposed.top() / size);
+    const int right = std::floor(exposed.right() / size);
+    const int bottom = std::floor(exposed.bottom() / size);
+
+    const int exposedChunks = (right - left + 1) * (bottom - top + 1);
+    if (mGridChunks.size() + exposedChunks > maxGridChunks)
+        mGridChunks.clear();
+
+    for (int y = top; y <= bottom; ++y) {
+        for (int x = left; x <= right; ++x) {
+            const QPair<int, int> index(x, y);
+
+            QPixmap chunk = mGridChunks.value(index);
+            if (chunk.isNull()) {
+                chunk = renderGridChunk(x, y, painter);
+                if (exposedChunks <= maxGridChunks)
+                    mGridChunks.insert(index, chunk);
+            }
+
+            painter->drawPixmap(gridChunkRect(x, y), chunk,
+                                QRectF(chunk.rect()));
+        }
+    }
+}
+
+QRectF MapScene::gridChunkRect(int x, int y) const
+{
+    const qreal size = gridChunkSize / mGridScale;
+    return QRectF(x * size, y * size, size, size);
+}
+
+/**
+ * Renders the grid within the given chunk at the current scale. Drawing the
+ * dashed cosmetic lines is slow, which is why this is only done once for
+ * each chunk.
+ */
+QPixmap MapScene::renderGridChunk(int x, int y, const QPainter *painter) const
+{
+    const QRectF rect = gridChunkRect(x, y);
+
+    QPixmap chunk(gridChunkSize, gridChunkSize);
+    chunk.fill(Qt::transparent);
+
+    QPainter chunkPainter(&chunk);
+    chunkPainter.setRenderHints(painter->renderHints());
+    chunkPainter.scale(mGridScale, mGridScale);
+    chunkPainter.translate(-rect.topLeft());
+
+    mMapDocument->renderer()->drawGrid(&chunkPainter, rect, mGridColor);
+
+    return chunk;
+}
+
+void MapScene::clearGridCache()
+{
+    mGridChunks.clear();
 }
 
 bool MapScene::event(QEvent *event)
@@ -26,8 +26,13 @@
 
 #include <QColor>
 #include <QGraphicsScene>
+#include <QHash>
 #include <QMap>
+#include <QPair>
+#include <QPixmap>
+#include <QRegion>
 #include <QSet>
+#include <QTimer>
 
 namespace Tiled {
 
@@ -41,6 +46,7 @@ class Tileset;
 namespace Internal {
 
 class AbstractTool;
+class LayerCompositeItem;
 class MapDocument;
 class MapObjectItem;
 class MapScene;
@@ -74,6 +80,15 @@ public:
      */
     void setMapDocument(MapDocument *map);
 
+    /**
+     * Drops all items of this scene while keeping its size, so that the
+     * view keeps its scroll position. Used to save memory while the map is
+     * not shown. The scene shows its map again after wakeUp().
+     */
+    void hibernate();
+    void wakeUp();
+    bool isHibernated() const { return mHibernatedDocument != 0; }
+
     /**
      * Returns whether the tile grid is visible.
      */
@@ -146,9 +161,16 @@ private slots:
     void refreshScene();
 
     /**
-     * Repaints the specified region. The region is in tile coordinates.
+     * Schedules a repaint of the specified region. The region is in tile
+     * coordinates. When \a layer is given, only its draw margins are taken
+     * into account.
+     */
+    void repaintRegion(const QRegion &region, Layer *layer);
+
+    /**
+     * Repaints the regions collected by repaintRegion() since the last time.
      */
-    void repaintRegion(const QRegion &region);
+    void flushDirtyRegion();
 
     void currentLayerIndexChanged();
 
@@ -162,6 +184,7 @@ private slots:
 
     void objectGroupChanged(ObjectGroup *objectGroup);
     void imageLayerChanged(ImageLayer *imageLayer);
+    void imageTilesDecoded();
 
     void tilesetTileOffsetChanged(Tileset *tileset);
 
@@ -177,10 +200,18 @@ private:
     QGraphicsItem *createLayerItem(Layer *layer);
 
     void updateCurrentLayerHighlight();
+    void createLayerComposites(int currentLayerIndex);
+    void removeLayerComposites();
+    LayerCompositeItem *layerCompositeFor(const Layer *layer) const;
+
+    QRectF gridChunkRect(int x, int y) const;
+    QPixmap renderGridChunk(int x, int y, const QPainter *painter) const;
+    void clearGridCache();
 
     bool eventFilter(QObject *object, QEvent *event);
 
     MapDocument *mMapDocument;
+    MapDocument *mHibernatedDocument;
     AbstractTool *mSelectedTool;
     AbstractTool *mActiveTool;
     bool mGridVisible;
@@ -191,9 +222,30 @@ private:
     Qt::KeyboardModifiers mCurrentModifiers;
     QPointF mLastMousePos;
     QVector<QGraphicsItem*> mLayerItems;
+
+    /**
+     * While highlighting the current layer, the runs of tile and image
+     * layers below and above it are displayed by these items instead of
+     * their layer items.
+     */
+    QList<LayerCompositeItem*> mLayerComposites;
     QGraphicsRectItem *mDarkRectangle;
     QColor mDefaultBackgroundColor;
 
+    /**
+     * The area waiting to be repainted, in scene coordinates.
+     */
+    QRegion mDirtyRegion;
+    QTimer mRepaintTimer;
+
+    /**
+     * The grid is cached in chunks of device pixels, for the scale and the
+     * color it was rendered at.
+     */
+    QHash<QPair<int, int>, QPixmap> mGridChunks;
+    qreal mGridScale;
+    QColor mGridColor;
+
     typedef QMap<MapObject*, MapObjectItem*> ObjectItems;
     ObjectItems mObjectItems;
     QSet<MapObjectItem*> mSelectedObjectItems;
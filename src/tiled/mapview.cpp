@@ -28,6 +28,8 @@
 #include <QCursor>
 #include <QGesture>
 #include <QGestureEvent>
+#include <QPainter>
+#include <QPaintEvent>
 #include <QPinchGesture>
 #include <QWheelEvent>
 #include <QScrollBar>
@@ -38,6 +40,12 @@
 
 using namespace Tiled::Internal;
 
+/**
+ * The time in milliseconds after the last zoom step before the scene is
+ * rendered at the new scale.
+ */
+static const int zoomSettleDelay = 150;
+
 MapView::MapView(QWidget *parent, Mode mode)
     : QGraphicsView(parent)
     , mHandScrolling(false)
@@ -76,6 +84,10 @@ MapView::MapView(QWidget *parent, Mode mode)
     setVerticalScrollBarPolicy(Qt::ScrollBarAlwaysOn);
 
     connect(mZoomable, SIGNAL(scaleChanged(qreal)), SLOT(adjustScale(qreal)));
+
+    mZoomSettleTimer.setSingleShot(true);
+    mZoomSettleTimer.setInterval(zoomSettleDelay);
+    connect(&mZoomSettleTimer, SIGNAL(timeout()), SLOT(endInteractiveZoom()));
 }
 
 MapView::~MapView()
@@ -161,9 +173,29 @@ void MapView::hideEvent(QHideEvent *event)
 {
     // Disable hand scrolling when the view gets hidden in any way
     setHandScrolling(false);
+    endInteractiveZoom();
     QGraphicsView::hideEvent(event);
 }
 
+/**
+ * Draws the zoom snapshot when zooming is in progress, scaled to where its
+ * contents are at the current scale.
+ */
+void MapView::paintEvent(QPaintEvent *event)
+{
+    if (mZoomSnapshot.isNull()) {
+        QGraphicsView::paintEvent(event);
+        return;
+    }
+
+    QPainter painter(viewport());
+    if (scene())
+        painter.fillRect(event->rect(), scene()->backgroundBrush());
+
+    const QRectF target = viewportTransform().mapRect(mZoomSnapshotRect);
+    painter.drawPixmap(target, mZoomSnapshot, QRectF(mZoomSnapshot.rect()));
+}
+
 /**
  * Override to support zooming in and out using the mouse wheel.
  */
@@ -172,6 +204,8 @@ void MapView::wheelEvent(QWheelEvent *event)
     if (event->modifiers() & Qt::ControlModifier
         && event->orientation() == Qt::Vertical)
     {
+        beginInteractiveZoom();
+
         // No automatic anchoring since we'll do it manually
         setTransformationAnchor(QGraphicsView::NoAnchor);
 
@@ -240,6 +274,8 @@ void MapView::mouseMoveEvent(QMouseEvent *event)
 
 void MapView::handlePinchGesture(QPinchGesture *pinch)
 {
+    beginInteractiveZoom();
+
     setTransformationAnchor(QGraphicsView::NoAnchor);
 
     mZoomable->handlePinchGesture(pinch);
@@ -259,3 +295,44 @@ void MapView::adjustCenterFromMousePosition(QPoint &mousePos)
     QPointF diff = viewCenterScenePos - mouseScenePos;
     centerOn(mLastMouseScenePos + diff);
 }
+
+/**
+ * Takes a snapshot of the viewport, unless zooming is already in progress,
+ * and (re)starts the timer that ends the interactive zoom.
+ *
+ * OpenGL viewports can't be grabbed reliably, so they keep rendering the
+ * scene at each step.
+ */
+void MapView::beginInteractiveZoom()
+{
+#ifndef QT_NO_OPENGL
+    if (qobject_cast<QGLWidget*>(viewport()))
+        return;
+#endif
+
+    if (mZoomSnapshot.isNull()) {
+        QWidget *v = viewport();
+#if QT_VERSION >= 0x050000
+        mZoomSnapshot = v->grab();
+#else
+        mZoomSnapshot = QPixmap::grabWidget(v);
+#endif
+        mZoomSnapshotRect = mapToScene(v->rect()).boundingRect();
+    }
+
+    mZoomSettleTimer.start();
+}
+
+/**
+ * Drops the zoom snapshot and renders the scene at the final scale.
+ */
+void MapView::endInteractiveZoom()
+{
+    mZoomSettleTimer.stop();
+
+    if (mZoomSnapshot.isNull())
+        return;
+
+    mZoomSnapshot = QPixmap();
+    viewport()->update();
+}
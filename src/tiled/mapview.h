@@ -23,6 +23,8 @@
 
 #include <QGraphicsView>
 #include <QPinchGesture>
+#include <QPixmap>
+#include <QTimer>
 
 namespace Tiled {
 namespace Internal {
@@ -35,6 +37,10 @@ class Zoomable;
  * properties on the viewport and implements zooming. It also allows the view
  * to be scrolled with the middle mouse button.
  *
+ * While zooming with the mouse wheel or a pinch gesture, the view shows a
+ * scaled snapshot of what it displayed when the zooming started. The scene
+ * is only rendered again once the zooming has settled.
+ *
  * @see MapScene
  */
 class MapView : public QGraphicsView
@@ -70,6 +76,8 @@ protected:
 
     void hideEvent(QHideEvent *);
 
+    void paintEvent(QPaintEvent *event);
+
     void wheelEvent(QWheelEvent *event);
 
     void mousePressEvent(QMouseEvent *event);
@@ -80,9 +88,12 @@ protected:
 
     void adjustCenterFromMousePosition(QPoint &mousePos);
 
+    void beginInteractiveZoom();
+
 private slots:
     void adjustScale(qreal scale);
     void setUseOpenGL(bool useOpenGL);
+    void endInteractiveZoom();
 
 private:
     QPoint mLastMousePos;
@@ -90,6 +101,10 @@ private:
     bool mHandScrolling;
     Mode mMode;
     Zoomable *mZoomable;
+
+    QPixmap mZoomSnapshot;
+    QRectF mZoomSnapshotRect;
+    QTimer mZoomSettleTimer;
 };
 
 } // namespace Internal
@@ -0,0 +1,229 @@
+/*
+ * paintsession.cpp
+ * Copyright 2015, Sydoria Games <luax@sydoria.fr>
+ *
+ * This file is part of Tiled.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "paintsession.h"
+
+#include "mapdocument.h"
+#include "painttilelayer.h"
+#include "tilelayer.h"
+#include "tilepainter.h"
+
+#include <QUndoStack>
+#include <QVector>
+
+using namespace Tiled;
+using namespace Tiled::Internal;
+
+PaintSession::PaintSession(MapDocument *mapDocument, TileLayer *target)
+    : mMapDocument(mapDocument)
+    , mTarget(target)
+    , mSource(0)
+    , mErased(0)
+{
+}
+
+PaintSession::~PaintSession()
+{
+    delete mSource;
+    delete mErased;
+}
+
+void PaintSession::paint(int x, int y, const TileLayer *stamp)
+{
+    const QRect rect = clipToTarget(QRect(x, y,
+                                          stamp->width(), stamp->height()));
+    if (rect.isEmpty())
+        return;
+
+    reserve(rect);
+
+    // Only record the cells that are actually painted, so that the undo
+    // command can restore and repaint exactly those cells. The stamp may be
+    // clipped at the left or top, so its cells are looked up relative to
+    // (x, y) rather than to the clipped rectangle.
+    TilePainter painter(mMapDocument, mTarget);
+
+    for (int cellY = rect.top(); cellY <= rect.bottom(); ++cellY) {
+        for (int cellX = rect.left(); cellX <= rect.right(); ++cellX) {
+            const Cell &cell = stamp->cellAt(cellX - x, cellY - y);
+            if (cell.isEmpty() || !painter.isDrawable(cellX, cellY))
+                continue;
+
+            recordErased(cellX, cellY);
+            mSource->setCell(cellX - mBufferRect.left(),
+                             cellY - mBufferRect.top(), cell);
+            mPaintedBounds |= QRect(cellX, cellY, 1, 1);
+        }
+    }
+
+    painter.drawCells(x, y, stamp);
+}
+
+void PaintSession::paintCell(int x, int y, const Cell &cell)
+{
+    const QRect rect = clipToTarget(QRect(x, y, 1, 1));
+    if (rect.isEmpty())
+        return;
+
+    TilePainter painter(mMapDocument, mTarget);
+    if (!painter.isDrawable(x, y))
+        return;
+
+    reserve(rect);
+    recordErased(x, y);
+
+    mSource->setCell(x - mBufferRect.left(), y - mBufferRect.top(), cell);
+    mPaintedBounds |= rect;
+
+    painter.setCell(x, y, cell);
+}
+
+void PaintSession::finish()
+{
+    if (isEmpty())
+        return;
+
+    // Crop the buffers to the area that was actually painted
+    const QRect bounds = mPaintedBounds;
+    const QRect local = bounds.translated(-mBufferRect.topLeft());
+    TileLayer *source = mSource->copy(local.x(), local.y(),
+                                      local.width(), local.height());
+    TileLayer *erased = mErased->copy(local.x(), local.y(),
+                                      local.width(), local.height());
+    const QRegion painted = paintedRegion();
+
+    delete mSource;
+    delete mErased;
+    mSource = 0;
+    mErased = 0;
+    mTouched.clear();
+    mBufferRect = QRect();
+    mPaintedBounds = QRect();
+
+    PaintTileLayer *paint = new PaintTileLayer(mMapDocument, mTarget,
+                                               bounds.x(), bounds.y(),
+                                               source, erased, painted);
+    mMapDocument->undoStack()->push(paint);
+    mMapDocument->emitRegionEdited(painted, mTarget);
+}
+
+QRect PaintSession::clipToTarget(const QRect &rect) const
+{
+    return rect & mTarget->bounds();
+}
+
+/**
+ * Makes sure the buffers cover the given \a rect. When they need to grow,
+ * they are grown by at least their current size in that direction, so that
+ * a long stroke only causes a logarithmic number of reallocations.
+ */
+void PaintSession::reserve(const QRect &rect)
+{
+    if (mBufferRect.contains(rect))
+        return;
+
+    if (!mSource) {
+        mBufferRect = rect;
+        mSource = new TileLayer(QString(), rect.x(), rect.y(),
+                                rect.width(), rect.height());
+        mErased = new TileLayer(QString(), rect.x(), rect.y(),
+                                rect.width(), rect.height());
+        mTouched = QBitArray(rect.width() * rect.height());
+        return;
+    }
+
+    const QRect old = mBufferRect;
+    QRect grown = old.united(rect);
+
+    if (grown.left() < old.left())
+        grown.setLeft(qMin(grown.left(), old.left() - old.width()));
+    if (grown.right() > old.right())
+        grown.setRight(qMax(grown.right(), old.right() + old.width()));
+    if (grown.top() < old.top())
+        grown.setTop(qMin(grown.top(), old.top() - old.height()));
+    if (grown.bottom() > old.bottom())
+        grown.setBottom(qMax(grown.bottom(), old.bottom() + old.height()));
+
+    grown &= mTarget->bounds();
+
+    const QPoint offset = old.topLeft() - grown.topLeft();
+    mSource->resize(grown.size(), offset);
+    mSource->setPosition(grown.topLeft());
+    mErased->resize(grown.size(), offset);
+    mErased->setPosition(grown.topLeft());
+
+    QBitArray touched(grown.width() * grown.height());
+    for (int y = 0; y < old.height(); ++y) {
+        const int oldRow = y * old.width();
+        const int newRow = (y + offset.y()) * grown.width() + offset.x();
+        for (int x = 0; x < old.width(); ++x)
+            if (mTouched.testBit(oldRow + x))
+                touched.setBit(newRow + x);
+    }
+
+    mTouched = touched;
+    mBufferRect = grown;
+}
+
+/**
+ * Stores the original cell of the target layer at (\a x, \a y), unless it
+ * was already painted on before during this session.
+ */
+void PaintSession::recordErased(int x, int y)
+{
+    const int bufferX = x - mBufferRect.left();
+    const int bufferY = y - mBufferRect.top();
+    const int index = bufferX + bufferY * mBufferRect.width();
+    if (mTouched.testBit(index))
+        return;
+
+    mTouched.setBit(index);
+    mErased->setCell(bufferX, bufferY,
+                     mTarget->cellAt(x - mTarget->x(), y - mTarget->y()));
+}
+
+/**
+ * Builds the region of touched cells out of horizontal runs. Each run is
+ * one row high and runs never abut, so the rects can be set directly.
+ */
+QRegion PaintSession::paintedRegion() const
+{
+    QVector<QRect> runs;
+    const int width = mBufferRect.width();
+
+    for (int y = mPaintedBounds.top(); y <= mPaintedBounds.bottom(); ++y) {
+        const int row = (y - mBufferRect.top()) * width - mBufferRect.left();
+        for (int x = mPaintedBounds.left(); x <= mPaintedBounds.right(); ++x) {
+            if (!mTouched.testBit(row + x))
+                continue;
+
+            const int start = x;
+            while (x + 1 <= mPaintedBounds.right() &&
+                   mTouched.testBit(row + x + 1))
+                ++x;
+
+            runs.append(QRect(start, y, x - start + 1, 1));
+        }
+    }
+
+    QRegion region;
+    region.setRects(runs.constData(), runs.size());
+    return region;
+}
@@ -0,0 +1,110 @@
+/*
+ * paintsession.h
+ * Copyright 2015, Sydoria Games <luax@sydoria.fr>
+ *
+ * This file is part of Tiled.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef PAINTSESSION_H
+#define PAINTSESSION_H
+
+#include <QBitArray>
+#include <QRect>
+#include <QRegion>
+
+namespace Tiled {
+
+class Cell;
+class TileLayer;
+
+namespace Internal {
+
+class MapDocument;
+
+/**
+ * A paint session collects all the paint operations of a single brush
+ * stroke. The cells are painted on the target layer immediately, while the
+ * painted and the erased cells are recorded in buffers that grow along with
+ * the stroke.
+ *
+ * When the stroke ends, finish() pushes a single PaintTileLayer command on
+ * the undo stack, so no intermediate layers or undo commands are created
+ * while painting.
+ */
+class PaintSession
+{
+public:
+    /**
+     * Constructor.
+     *
+     * @param mapDocument the map document that's being edited
+     * @param target      the target layer to paint on
+     */
+    PaintSession(MapDocument *mapDocument, TileLayer *target);
+
+    ~PaintSession();
+
+    MapDocument *mapDocument() const { return mMapDocument; }
+    TileLayer *target() const { return mTarget; }
+
+    /**
+     * Paints the given \a stamp at the given position, in map coordinates.
+     * Empty cells in the stamp are skipped.
+     */
+    void paint(int x, int y, const TileLayer *stamp);
+
+    /**
+     * Paints a single \a cell at the given position, in map coordinates.
+     */
+    void paintCell(int x, int y, const Cell &cell);
+
+    /**
+     * Returns whether nothing has been painted in this session.
+     */
+    bool isEmpty() const { return mPaintedBounds.isNull(); }
+
+    /**
+     * Ends the session. Pushes the undo command for everything that was
+     * painted and announces the edited region. Does nothing when nothing
+     * was painted.
+     */
+    void finish();
+
+private:
+    QRect clipToTarget(const QRect &rect) const;
+    void reserve(const QRect &rect);
+    void recordErased(int x, int y);
+    QRegion paintedRegion() const;
+
+    MapDocument *mMapDocument;
+    TileLayer *mTarget;
+
+    /**
+     * The buffers cover mBufferRect (in map coordinates). mSource stores
+     * what was painted, mErased the original cells and mTouched marks the
+     * cells that were painted, of which the original has been recorded.
+     */
+    TileLayer *mSource;
+    TileLayer *mErased;
+    QBitArray mTouched;
+    QRect mBufferRect;
+    QRect mPaintedBounds;
+};
+
+} // namespace Internal
+} // namespace Tiled
+
+#endif // PAINTSESSION_H
@@ -41,7 +41,9 @@ PaintTileLayer::PaintTileLayer(MapDocument *mapDocument,
     mX(x),
     mY(y),
     mPaintedRegion(x, y, source->width(), source->height()),
-    mMergeable(false)
+    mMergeable(false),
+    mExactRegion(false),
+    mAlreadyPainted(false)
 {
     mErased = mTarget->copy(mX - mTarget->x(),
                             mY - mTarget->y(),
@@ -49,6 +51,27 @@ PaintTileLayer::PaintTileLayer(MapDocument *mapDocument,
     setText(QCoreApplication::translate("Undo Commands", "Paint"));
 }
 
+PaintTileLayer::PaintTileLayer(MapDocument *mapDocument,
+                               TileLayer *target,
+                               int x,
+                               int y,
+                               TileLayer *source,
+                               TileLayer *erased,
+                               const QRegion &paintedRegion):
+    mMapDocument(mapDocument),
+    mTarget(target),
+    mSource(source),
+    mErased(erased),
+    mX(x),
+    mY(y),
+    mPaintedRegion(paintedRegion),
+    mMergeable(false),
+    mExactRegion(true),
+    mAlreadyPainted(true)
+{
+    setText(QCoreApplication::translate("Undo Commands", "Paint"));
+}
+
 PaintTileLayer::~PaintTileLayer()
 {
     delete mSource;
@@ -58,13 +81,24 @@ PaintTileLayer::~PaintTileLayer()
 void PaintTileLayer::undo()
 {
     TilePainter painter(mMapDocument, mTarget);
-    painter.setCells(mX, mY, mErased, mPaintedRegion);
+    if (mExactRegion)
+        painter.restoreCells(mX, mY, mErased, mPaintedRegion);
+    else
+        painter.setCells(mX, mY, mErased, mPaintedRegion);
 }
 
 void PaintTileLayer::redo()
 {
+    if (mAlreadyPainted) {
+        mAlreadyPainted = false;
+        return;
+    }
+
     TilePainter painter(mMapDocument, mTarget);
-    painter.drawCells(mX, mY, mSource);
+    if (mExactRegion)
+        painter.restoreCells(mX, mY, mSource, mPaintedRegion);
+    else
+        painter.drawCells(mX, mY, mSource);
 }
 
 bool PaintTileLayer::mergeWith(const QUndoCommand *other)
@@ -72,6 +106,7 @@ bool PaintTileLayer::mergeWith(const QUndoCommand *other)
     const PaintTileLayer *o = static_cast<const PaintTileLayer*>(other);
     if (!(mMapDocument == o->mMapDocument &&
           mTarget == o->mTarget &&
+          mExactRegion == o->mExactRegion &&
           o->mMergeable))
         return false;
 
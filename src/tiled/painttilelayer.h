@@ -54,6 +54,24 @@ public:
                    int x, int y,
                    const TileLayer *source);
 
+    /**
+     * Constructs a paint command from cells that have already been painted
+     * on the \a target layer, as done by PaintSession. The command takes
+     * ownership over the \a source and \a erased layers, which are both
+     * positioned at (\a x, \a y). Exactly the cells within
+     * \a paintedRegion are restored on undo and painted again on redo,
+     * regardless of the tile selection at that time.
+     *
+     * Since the paint has already been applied, the first call to redo()
+     * does nothing.
+     */
+    PaintTileLayer(MapDocument *mapDocument,
+                   TileLayer *target,
+                   int x, int y,
+                   TileLayer *source,
+                   TileLayer *erased,
+                   const QRegion &paintedRegion);
+
     ~PaintTileLayer();
 
     /**
@@ -76,6 +94,8 @@ private:
     int mX, mY;
     QRegion mPaintedRegion;
     bool mMergeable;
+    bool mExactRegion;
+    bool mAlreadyPainted;
 };
 
 } // namespace Internal
@@ -0,0 +1,328 @@
+/*
+ * pathfinder.cpp
+ * Copyright 2015, Sydoria Games <luax@sydoria.fr>
+ *
+ * This file is part of Tiled.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "pathfinder.h"
+
+#include "hexagonalrenderer.h"
+#include "map.h"
+#include "walkabilitygrid.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+using namespace Tiled;
+using namespace Tiled::Internal;
+
+static const qreal diagonalCost = 1.41421356237309504880;
+
+PathFinder::PathFinder()
+    : mWidth(0)
+    , mHeight(0)
+    , mSearch(0)
+    , mNeighbourhood(Square)
+    , mRenderer(0)
+    , mHexagonalRenderer(0)
+    , mStaggerX(false)
+    , mDistanceScale(1)
+    , mPathCost(0)
+{
+}
+
+bool PathFinder::findPath(const WalkabilityGrid &grid,
+                          const Map *map,
+                          const MapRenderer *renderer,
+                          const QPoint &start,
+                          const QPoint &goal)
+{
+    clear();
+    reset(grid.width(), grid.height());
+
+    mRenderer = renderer;
+    mHexagonalRenderer = dynamic_cast<const HexagonalRenderer*>(renderer);
+    mNeighbourhood = Square;
+    mStaggerX = map->staggerAxis() == Map::StaggerX;
+    if (mHexagonalRenderer) {
+        if (map->orientation() == Map::Hexagonal)
+            mNeighbourhood = HexagonalCells;
+        else if (map->orientation() == Map::Staggered)
+            mNeighbourhood = StaggeredCells;
+    }
+
+    mGoal = goal;
+
+    if (mNeighbourhood != Square) {
+        mGoalPosition = cellPosition(goal.x(), goal.y());
+
+        // The estimate is the distance in pixels, scaled so that no step
+        // covers more than its cost. Both parities of the staggered rows
+        // and columns are sampled.
+        qreal maxDistancePerCost = 0;
+        for (int y = 0; y < 2; ++y) {
+            for (int x = 0; x < 2; ++x) {
+                const QPointF position = cellPosition(x, y);
+                QPoint edges[6];
+                edgeNeighbours(x, y, edges);
+
+                const int edgeCount = mNeighbourhood == HexagonalCells ? 6 : 4;
+                for (int i = 0; i < edgeCount; ++i) {
+                    const QPointF d = cellPosition(edges[i].x(), edges[i].y()) - position;
+                    maxDistancePerCost = qMax(maxDistancePerCost,
+                                              std::sqrt(d.x() * d.x() + d.y() * d.y()));
+                }
+
+                if (mNeighbourhood == StaggeredCells) {
+                    for (int i = 0; i < 4; ++i) {
+                        QPoint corners[6];
+                        edgeNeighbours(edges[i].x(), edges[i].y(), corners);
+                        const QPoint &corner = corners[(i + 1) % 4];
+                        const QPointF d = cellPosition(corner.x(), corner.y()) - position;
+                        maxDistancePerCost = qMax(maxDistancePerCost,
+                                                  std::sqrt(d.x() * d.x() + d.y() * d.y())
+                                                  / diagonalCost);
+                    }
+                }
+            }
+        }
+
+        mDistanceScale = maxDistancePerCost > 0 ? 1 / maxDistancePerCost : 0;
+    }
+
+    if (!isWalkable(grid, start.x(), start.y()) ||
+            !isWalkable(grid, goal.x(), goal.y()))
+        return false;
+
+    const int startIndex = start.y() * mWidth + start.x();
+    const int goalIndex = goal.y() * mWidth + goal.x();
+
+    mCost[startIndex] = 0;
+    mParent[startIndex] = -1;
+
+    Node startNode = { heuristic(startIndex), startIndex };
+    mOpen.append(startNode);
+
+    Neighbour found[8];
+
+    while (!mOpen.isEmpty()) {
+        std::pop_heap(mOpen.begin(), mOpen.end());
+        const Node node = mOpen.last();
+        mOpen.resize(mOpen.size() - 1);
+
+        // Cells may have been queued more than once with decreasing costs
+        if (mClosed.at(node.index) == mSearch)
+            continue;
+
+        mClosed[node.index] = mSearch;
+        mExplored.append(node.index);
+
+        if (node.index == goalIndex)
+            break;
+
+        const qreal cost = mCost.at(node.index);
+        const int count = neighbours(grid, node.index, found);
+
+        for (int i = 0; i < count; ++i) {
+            const Neighbour &neighbour = found[i];
+            if (mClosed.at(neighbour.index) == mSearch)
+                continue;
+
+            const qreal neighbourCost = cost + neighbour.cost;
+            if (neighbourCost < mCost.at(neighbour.index)) {
+                mCost[neighbour.index] = neighbourCost;
+                mParent[neighbour.index] = node.index;
+
+                Node next = { neighbourCost + heuristic(neighbour.index),
+                              neighbour.index };
+                mOpen.append(next);
+                std::push_heap(mOpen.begin(), mOpen.end());
+            }
+        }
+    }
+
+    mOpen.resize(0);
+
+    if (mClosed.at(goalIndex) != mSearch)
+        return false;
+
+    for (int index = goalIndex; index != -1; index = mParent.at(index))
+        mPath.append(QPoint(index % mWidth, index / mWidth));
+    std::reverse(mPath.begin(), mPath.end());
+
+    mPathCost = mCost.at(goalIndex);
+    return true;
+}
+
+void PathFinder::clear()
+{
+    mPath.clear();
+    mPathCost = 0;
+    mExplored.resize(0);
+
+    ++mSearch;
+
+    // Start over when the search stamp wraps around
+    if (mSearch == 0) {
+        mTouched.fill(0);
+        mClosed.fill(0);
+        mSearch = 1;
+    }
+}
+
+/**
+ * Prepares the buffers for a grid of the given size. They are only
+ * reallocated when the size changed.
+ */
+void PathFinder::reset(int width, int height)
+{
+    if (mWidth == width && mHeight == height)
+        return;
+
+    const int size = width * height;
+
+    mWidth = width;
+    mHeight = height;
+    mTouched.fill(0, size);
+    mClosed.fill(0, size);
+    mCost.resize(size);
+    mParent.resize(size);
+}
+
+/**
+ * Returns whether the cell at (x, y) lies within the grid and doesn't block
+ * movement, and marks it as touched by the current search.
+ */
+bool PathFinder::isWalkable(const WalkabilityGrid &grid, int x, int y)
+{
+    if (!contains(x, y))
+        return false;
+
+    const int index = y * mWidth + x;
+    if (mTouched.at(index) != mSearch) {
+        mTouched[index] = mSearch;
+        mCost[index] = std::numeric_limits<qreal>::max();
+    }
+
+    return !grid.blocksMovement(x, y);
+}
+
+/**
+ * Stores the walkable neighbours of the cell at \a index in \a neighbours
+ * and returns how many there are.
+ */
+int PathFinder::neighbours(const WalkabilityGrid &grid, int index,
+                           Neighbour *neighbours)
+{
+    const int x = index % mWidth;
+    const int y = index / mWidth;
+
+    QPoint edges[6];
+    bool walkable[6];
+    edgeNeighbours(x, y, edges);
+
+    const int edgeCount = mNeighbourhood == HexagonalCells ? 6 : 4;
+    int count = 0;
+
+    for (int i = 0; i < edgeCount; ++i) {
+        const QPoint &edge = edges[i];
+        walkable[i] = isWalkable(grid, edge.x(), edge.y());
+        if (walkable[i]) {
+            Neighbour neighbour = { edge.y() * mWidth + edge.x(), 1 };
+            neighbours[count++] = neighbour;
+        }
+    }
+
+    if (mNeighbourhood == HexagonalCells)
+        return count;
+
+    // The corner between two consecutive edge neighbours is reached by
+    // stepping in both their directions
+    for (int i = 0; i < 4; ++i) {
+        const int j = (i + 1) % 4;
+        if (!walkable[i] || !walkable[j])
+            continue;
+
+        QPoint corners[6];
+        edgeNeighbours(edges[i].x(), edges[i].y(), corners);
+        const QPoint &corner = corners[j];
+
+        if (isWalkable(grid, corner.x(), corner.y())) {
+            Neighbour neighbour = { corner.y() * mWidth + corner.x(),
+                                    diagonalCost };
+            neighbours[count++] = neighbour;
+        }
+    }
+
+    return count;
+}
+
+/**
+ * Stores the cells sharing an edge with the cell at (x, y) in \a edges. For
+ * square and staggered cells there are four, listed so that consecutive
+ * cells are perpendicular. Hexagonal cells have two more.
+ */
+void PathFinder::edgeNeighbours(int x, int y, QPoint *edges) const
+{
+    if (mNeighbourhood == Square) {
+        edges[0] = QPoint(x + 1, y);
+        edges[1] = QPoint(x, y + 1);
+        edges[2] = QPoint(x - 1, y);
+        edges[3] = QPoint(x, y - 1);
+        return;
+    }
+
+    edges[0] = mHexagonalRenderer->topRight(x, y);
+    edges[1] = mHexagonalRenderer->bottomRight(x, y);
+    edges[2] = mHexagonalRenderer->bottomLeft(x, y);
+    edges[3] = mHexagonalRenderer->topLeft(x, y);
+
+    if (mNeighbourhood == HexagonalCells) {
+        if (mStaggerX) {
+            edges[4] = QPoint(x, y - 1);
+            edges[5] = QPoint(x, y + 1);
+        } else {
+            edges[4] = QPoint(x - 1, y);
+            edges[5] = QPoint(x + 1, y);
+        }
+    }
+}
+
+/**
+ * Estimates the cost of the remaining path from the cell at \a index to the
+ * goal, without overestimating it.
+ */
+qreal PathFinder::heuristic(int index) const
+{
+    const int x = index % mWidth;
+    const int y = index / mWidth;
+
+    if (mNeighbourhood == Square) {
+        const int dx = qAbs(x - mGoal.x());
+        const int dy = qAbs(y - mGoal.y());
+        return dx + dy + (diagonalCost - 2) * qMin(dx, dy);
+    }
+
+    const QPointF d = cellPosition(x, y) - mGoalPosition;
+    return std::sqrt(d.x() * d.x() + d.y() * d.y()) * mDistanceScale;
+}
+
+QPointF PathFinder::cellPosition(int x, int y) const
+{
+    return mRenderer->tileToPixelCoords(x, y);
+}
@@ -0,0 +1,162 @@
+/*
+ * pathfinder.h
+ * Copyright 2015, Sydoria Games <luax@sydoria.fr>
+ *
+ * This file is part of Tiled.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef PATHFINDER_H
+#define PATHFINDER_H
+
+#include <QPoint>
+#include <QVector>
+
+namespace Tiled {
+
+class HexagonalRenderer;
+class Map;
+class MapRenderer;
+class WalkabilityGrid;
+
+namespace Internal {
+
+/**
+ * Finds the shortest path between two cells of a WalkabilityGrid using A*.
+ *
+ * The neighbours of a cell depend on the orientation of the map. Orthogonal
+ * and isometric cells have eight neighbours, staggered cells have four edge
+ * and four corner neighbours and hexagonal cells have six neighbours. Moves
+ * across a corner cost the square root of two and are only allowed when both
+ * cells sharing that corner are walkable.
+ *
+ * The buffers used by the search are kept between searches, so that running
+ * it again after a change to the grid doesn't allocate. The finder also
+ * remembers which cells the last search has looked at. Since the search only
+ * depends on those cells, it doesn't need to run again when none of them
+ * changed.
+ */
+class PathFinder
+{
+public:
+    PathFinder();
+
+    /**
+     * Searches for a path from \a start to \a goal over the cells of the
+     * \a grid that don't block movement. The \a renderer is used to find the
+     * neighbours of the cells of staggered and hexagonal maps and to estimate
+     * the remaining distance on those maps.
+     *
+     * Returns whether a path was found.
+     */
+    bool findPath(const WalkabilityGrid &grid,
+                  const Map *map,
+                  const MapRenderer *renderer,
+                  const QPoint &start,
+                  const QPoint &goal);
+
+    /**
+     * Forgets the last search.
+     */
+    void clear();
+
+    /**
+     * Returns the cells of the path found by the last search, from start to
+     * goal. Empty when no path was found.
+     */
+    const QVector<QPoint> &path() const { return mPath; }
+
+    /**
+     * Returns the cost of the path found by the last search.
+     */
+    qreal pathCost() const { return mPathCost; }
+
+    /**
+     * Returns the amount of cells expanded by the last search.
+     */
+    int exploredCount() const { return mExplored.size(); }
+
+    /**
+     * Returns the indices (y * width + x) of the cells expanded by the last
+     * search, in the order they were expanded.
+     */
+    const QVector<int> &exploredCells() const { return mExplored; }
+
+    /**
+     * Returns whether the last search has looked at the cell at (x, y). When
+     * none of these cells changed, searching again gives the same result.
+     */
+    bool isTouched(int x, int y) const
+    { return contains(x, y) && mTouched.at(y * mWidth + x) == mSearch; }
+
+private:
+    struct Neighbour
+    {
+        int index;
+        qreal cost;
+    };
+
+    struct Node
+    {
+        qreal estimate;
+        int index;
+
+        bool operator<(const Node &other) const
+        { return estimate > other.estimate; }
+    };
+
+    enum Neighbourhood {
+        Square,         // orthogonal and isometric maps
+        StaggeredCells,
+        HexagonalCells
+    };
+
+    bool contains(int x, int y) const
+    { return x >= 0 && y >= 0 && x < mWidth && y < mHeight; }
+
+    void reset(int width, int height);
+    bool isWalkable(const WalkabilityGrid &grid, int x, int y);
+    int neighbours(const WalkabilityGrid &grid, int index,
+                   Neighbour *neighbours);
+    void edgeNeighbours(int x, int y, QPoint *edges) const;
+    qreal heuristic(int index) const;
+    QPointF cellPosition(int x, int y) const;
+
+    int mWidth;
+    int mHeight;
+    quint32 mSearch;
+    QVector<quint32> mTouched;
+    QVector<quint32> mClosed;
+    QVector<qreal> mCost;
+    QVector<int> mParent;
+    QVector<Node> mOpen;
+    QVector<int> mExplored;
+
+    Neighbourhood mNeighbourhood;
+    const MapRenderer *mRenderer;
+    const HexagonalRenderer *mHexagonalRenderer;
+    bool mStaggerX;
+    QPoint mGoal;
+    QPointF mGoalPosition;
+    qreal mDistanceScale;
+
+    QVector<QPoint> mPath;
+    qreal mPathCost;
+};
+
+} // namespace Internal
+} // namespace Tiled
+
+#endif // PATHFINDER_H
@@ -0,0 +1,158 @@
+/*
+ * pathfindingitem.cpp
+ * Copyright 2015, Sydoria Games <luax@sydoria.fr>
+ *
+ * This file is part of Tiled.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "pathfindingitem.h"
+
+#include "map.h"
+#include "mapdocument.h"
+#include "maprenderer.h"
+#include "pathfinder.h"
+
+#include <QApplication>
+#include <QPainter>
+#include <QStyleOptionGraphicsItem>
+#include <QVector>
+
+#include <algorithm>
+
+using namespace Tiled;
+using namespace Tiled::Internal;
+
+PathfindingItem::PathfindingItem()
+    : mMapDocument(0)
+{
+    setFlag(QGraphicsItem::ItemUsesExtendedStyleOption);
+}
+
+void PathfindingItem::setMapDocument(MapDocument *mapDocument)
+{
+    if (mMapDocument == mapDocument)
+        return;
+
+    mMapDocument = mapDocument;
+
+    mExplored = QRegion();
+    mStart = QRegion();
+    mGoal = QRegion();
+    mPath.clear();
+    syncWithMap();
+}
+
+void PathfindingItem::setSearch(const PathFinder &pathFinder)
+{
+    if (!mMapDocument)
+        return;
+
+    const Map *map = mMapDocument->map();
+    const MapRenderer *renderer = mMapDocument->renderer();
+    const int width = map->width();
+
+    // Collect the explored cells as runs, which are one row high and sorted,
+    // so they form a valid region. Only the explored cells are visited, in
+    // row-major order.
+    QVector<int> explored = pathFinder.exploredCells();
+    std::sort(explored.begin(), explored.end());
+
+    QVector<QRect> runs;
+    int i = 0;
+    while (i < explored.size()) {
+        const int first = explored.at(i);
+        const int y = first / width;
+        const int rowEnd = (y + 1) * width;
+
+        int last = first;
+        ++i;
+        while (i < explored.size() && explored.at(i) == last + 1 &&
+               explored.at(i) < rowEnd) {
+            last = explored.at(i);
+            ++i;
+        }
+
+        runs.append(QRect(first % width, y, last - first + 1, 1));
+    }
+
+    mExplored = QRegion();
+    mExplored.setRects(runs.constData(), runs.size());
+
+    mPath.clear();
+    foreach (const QPoint &cell, pathFinder.path())
+        mPath.append(QRectF(renderer->boundingRect(QRect(cell, QSize(1, 1)))).center());
+
+    update();
+}
+
+void PathfindingItem::setEndpoints(const QRegion &start, const QRegion &goal)
+{
+    if (mStart == start && mGoal == goal)
+        return;
+
+    mStart = start;
+    mGoal = goal;
+    update();
+}
+
+void PathfindingItem::syncWithMap()
+{
+    prepareGeometryChange();
+
+    if (!mMapDocument) {
+        mBoundingRect = QRectF();
+        return;
+    }
+
+    const Map *map = mMapDocument->map();
+    const QRect mapRect(0, 0, map->width(), map->height());
+    mBoundingRect = mMapDocument->renderer()->boundingRect(mapRect);
+}
+
+QRectF PathfindingItem::boundingRect() const
+{
+    return mBoundingRect;
+}
+
+void PathfindingItem::paint(QPainter *painter,
+                            const QStyleOptionGraphicsItem *option,
+                            QWidget *)
+{
+    if (!mMapDocument)
+        return;
+
+    QColor explored = QApplication::palette().highlight().color();
+    explored.setAlpha(48);
+
+    const MapRenderer *renderer = mMapDocument->renderer();
+    renderer->drawTileSelection(painter, mExplored, explored,
+                                option->exposedRect);
+    renderer->drawTileSelection(painter, mStart, QColor(0, 255, 0, 96),
+                                option->exposedRect);
+    renderer->drawTileSelection(painter, mGoal, QColor(255, 0, 0, 96),
+                                option->exposedRect);
+
+    if (mPath.size() > 1) {
+        QPen pen(QApplication::palette().highlight().color(), 3);
+        pen.setCosmetic(true);
+        pen.setCapStyle(Qt::RoundCap);
+        pen.setJoinStyle(Qt::RoundJoin);
+
+        painter->setRenderHint(QPainter::Antialiasing);
+        painter->setPen(pen);
+        painter->drawPolyline(mPath);
+    }
+}
@@ -0,0 +1,83 @@
+/*
+ * pathfindingitem.h
+ * Copyright 2015, Sydoria Games <luax@sydoria.fr>
+ *
+ * This file is part of Tiled.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef PATHFINDINGITEM_H
+#define PATHFINDINGITEM_H
+
+#include <QGraphicsItem>
+#include <QPolygonF>
+#include <QRegion>
+
+namespace Tiled {
+namespace Internal {
+
+class MapDocument;
+class PathFinder;
+
+/**
+ * Displays the result of a path search on the map: the cells that were
+ * explored, the start and goal cells and the path between them.
+ */
+class PathfindingItem : public QGraphicsItem
+{
+public:
+    PathfindingItem();
+
+    /**
+     * Sets the map document the searches are done on.
+     */
+    void setMapDocument(MapDocument *mapDocument);
+
+    /**
+     * Takes over the explored cells and the path from the last search of the
+     * \a pathFinder.
+     */
+    void setSearch(const PathFinder &pathFinder);
+
+    /**
+     * Sets the start and goal cells. Pass an empty region to hide either.
+     */
+    void setEndpoints(const QRegion &start, const QRegion &goal);
+
+    /**
+     * Updates the size of this item. Should be called when the size of the
+     * map has changed.
+     */
+    void syncWithMap();
+
+    // QGraphicsItem
+    QRectF boundingRect() const;
+    void paint(QPainter *painter,
+               const QStyleOptionGraphicsItem *option,
+               QWidget *widget = 0);
+
+private:
+    MapDocument *mMapDocument;
+    QRegion mExplored;
+    QRegion mStart;
+    QRegion mGoal;
+    QPolygonF mPath;
+    QRectF mBoundingRect;
+};
+
+} // namespace Internal
+} // namespace Tiled
+
+#endif // PATHFINDINGITEM_H
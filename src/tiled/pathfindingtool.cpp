@@ -0,0 +1,333 @@
+/*
+ * pathfindingtool.cpp
+ * Copyright 2015, Sydoria Games <luax@sydoria.fr>
+ *
+ * This file is part of Tiled.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "pathfindingtool.h"
+
+#include "brushitem.h"
+#include "layer.h"
+#include "map.h"
+#include "mapdocument.h"
+#include "mapscene.h"
+#include "pathfindingitem.h"
+#include "tilesetmanager.h"
+
+#include <QGraphicsSceneMouseEvent>
+
+using namespace Tiled;
+using namespace Tiled::Internal;
+
+PathfindingTool::PathfindingTool(QObject *parent)
+    : AbstractTileTool(tr("Pathfinding Preview"),
+                       QIcon(QLatin1String(
+                               ":images/24x24/pathfinding.png")),
+                       QKeySequence(tr("G")),
+                       parent)
+    , mPathfindingItem(new PathfindingItem)
+    , mGridValid(false)
+    , mSearchValid(false)
+    , mHasStart(false)
+    , mHasGoal(false)
+    , mDragButton(Qt::NoButton)
+    , mIsActive(false)
+{
+    // Just below the brush item
+    mPathfindingItem->setZValue(9999);
+
+    mUpdateTimer.setSingleShot(true);
+    mUpdateTimer.setInterval(0);
+    connect(&mUpdateTimer, SIGNAL(timeout()), SLOT(updateSearch()));
+}
+
+PathfindingTool::~PathfindingTool()
+{
+    delete mPathfindingItem;
+}
+
+void PathfindingTool::activate(MapScene *scene)
+{
+    AbstractTileTool::activate(scene);
+    scene->addItem(mPathfindingItem);
+
+    // The grid isn't kept up to date while the tool is inactive
+    mIsActive = true;
+    mGridValid = false;
+    makeConnections();
+    scheduleUpdate();
+}
+
+void PathfindingTool::deactivate(MapScene *scene)
+{
+    clearConnections(mapDocument());
+    mIsActive = false;
+    mDragButton = Qt::NoButton;
+
+    scene->removeItem(mPathfindingItem);
+    AbstractTileTool::deactivate(scene);
+}
+
+void PathfindingTool::mousePressed(QGraphicsSceneMouseEvent *event)
+{
+    const Qt::MouseButton button = event->button();
+    if (button != Qt::LeftButton && button != Qt::RightButton)
+        return;
+
+    mDragButton = button;
+    setEndpoint(button, tilePosition());
+}
+
+void PathfindingTool::mouseReleased(QGraphicsSceneMouseEvent *event)
+{
+    if (event->button() == mDragButton)
+        mDragButton = Qt::NoButton;
+}
+
+void PathfindingTool::languageChanged()
+{
+    setName(tr("Pathfinding Preview"));
+    setShortcut(QKeySequence(tr("G")));
+}
+
+void PathfindingTool::mapDocumentChanged(MapDocument *oldDocument,
+                                         MapDocument *newDocument)
+{
+    AbstractTileTool::mapDocumentChanged(oldDocument, newDocument);
+
+    clearConnections(oldDocument);
+
+    // The endpoints and the grid belong to the previous map
+    mHasStart = false;
+    mHasGoal = false;
+    mDragButton = Qt::NoButton;
+    mGridValid = false;
+    mSearchValid = false;
+    mChangedRegion = QRegion();
+    mGrid = WalkabilityGrid();
+    mPathFinder.clear();
+
+    mPathfindingItem->setMapDocument(newDocument);
+
+    if (mIsActive) {
+        makeConnections();
+        scheduleUpdate();
+    }
+}
+
+void PathfindingTool::updateEnabledState()
+{
+    setEnabled(mapDocument() != 0);
+}
+
+void PathfindingTool::tilePositionChanged(const QPoint &tilePos)
+{
+    brushItem()->setTileRegion(QRect(tilePos, QSize(1, 1)));
+
+    if (mDragButton != Qt::NoButton)
+        setEndpoint(mDragButton, tilePos);
+}
+
+void PathfindingTool::updateStatusInfo()
+{
+    if (!isBrushVisible()) {
+        AbstractTileTool::updateStatusInfo();
+        return;
+    }
+
+    const QPoint pos = tilePosition();
+    QString info = QString(QLatin1String("%1, %2")).arg(pos.x()).arg(pos.y());
+
+    if (mHasStart && mHasGoal && mSearchValid) {
+        const QVector<QPoint> &path = mPathFinder.path();
+
+        info += QLatin1String(" - ");
+        if (path.isEmpty()) {
+            info += tr("No path (%1 cells explored)")
+                    .arg(mPathFinder.exploredCount());
+        } else {
+            info += tr("Path: %1 steps, cost %2 (%3 cells explored)")
+                    .arg(path.size() - 1)
+                    .arg(mPathFinder.pathCost(), 0, 'f', 1)
+                    .arg(mPathFinder.exploredCount());
+        }
+    }
+
+    setStatusInfo(info);
+}
+
+void PathfindingTool::regionChanged(const QRegion &region, Layer *layer)
+{
+    // Only tiles are rasterized per cell
+    if (!layer || !layer->isTileLayer()) {
+        invalidateGrid();
+        return;
+    }
+
+    if (!mGridValid)
+        return;
+
+    mChangedRegion += region;
+    scheduleUpdate();
+}
+
+void PathfindingTool::invalidateGrid()
+{
+    mGridValid = false;
+    mChangedRegion = QRegion();
+    scheduleUpdate();
+}
+
+/**
+ * Brings the grid up to date with the changes made since the last update and
+ * searches again when needed.
+ */
+void PathfindingTool::updateSearch()
+{
+    if (!mIsActive || !mapDocument())
+        return;
+
+    const Map *map = mapDocument()->map();
+    CollisionCache *collisionCache =
+            TilesetManager::instance()->collisionCache();
+
+    if (!mGridValid || mGrid.width() != map->width()
+            || mGrid.height() != map->height()) {
+        mGrid = WalkabilityGrid::fromMap(map, collisionCache);
+        mGridValid = true;
+        mSearchValid = false;
+        mPathfindingItem->syncWithMap();
+    } else if (!mChangedRegion.isEmpty()) {
+        const QBitArray previous = mGrid.movementBits();
+        mGrid.update(map, collisionCache, mChangedRegion);
+
+        // Search again only when a cell the last search depends on changed
+        const QRect mapRect(0, 0, map->width(), map->height());
+        foreach (const QRect &rect, mChangedRegion.rects()) {
+            const QRect area = rect & mapRect;
+            for (int y = area.top(); y <= area.bottom() && mSearchValid; ++y) {
+                for (int x = area.left(); x <= area.right(); ++x) {
+                    if (previous.testBit(y * map->width() + x) != mGrid.blocksMovement(x, y)
+                            && mPathFinder.isTouched(x, y)) {
+                        mSearchValid = false;
+                        break;
+                    }
+                }
+            }
+        }
+    }
+
+    mChangedRegion = QRegion();
+
+    if (mSearchValid)
+        return;
+
+    if (mHasStart && mHasGoal) {
+        mPathFinder.findPath(mGrid, map, mapDocument()->renderer(),
+                             mStart, mGoal);
+    } else {
+        mPathFinder.clear();
+    }
+
+    mSearchValid = true;
+    mPathfindingItem->setSearch(mPathFinder);
+    updateStatusInfo();
+}
+
+void PathfindingTool::makeConnections()
+{
+    MapDocument *mapDocument = this->mapDocument();
+    if (!mapDocument)
+        return;
+
+    connect(mapDocument, SIGNAL(regionChanged(QRegion,Layer*)),
+            this, SLOT(regionChanged(QRegion,Layer*)));
+
+    // Anything else that may affect the collision data rebuilds the grid
+    connect(mapDocument, SIGNAL(mapChanged()),
+            this, SLOT(invalidateGrid()));
+    connect(mapDocument, SIGNAL(layerAdded(int)),
+            this, SLOT(invalidateGrid()));
+    connect(mapDocument, SIGNAL(layerRemoved(int)),
+            this, SLOT(invalidateGrid()));
+    connect(mapDocument, SIGNAL(layerChanged(int)),
+            this, SLOT(invalidateGrid()));
+    connect(mapDocument, SIGNAL(objectsAdded(QList<MapObject*>)),
+            this, SLOT(invalidateGrid()));
+    connect(mapDocument, SIGNAL(objectsRemoved(QList<MapObject*>)),
+            this, SLOT(invalidateGrid()));
+    connect(mapDocument, SIGNAL(objectsChanged(QList<MapObject*>)),
+            this, SLOT(invalidateGrid()));
+    connect(mapDocument, SIGNAL(tileObjectGroupChanged(Tile*)),
+            this, SLOT(invalidateGrid()));
+    connect(mapDocument, SIGNAL(tilesetChanged(Tileset*)),
+            this, SLOT(invalidateGrid()));
+    connect(mapDocument, SIGNAL(tilesetRemoved(Tileset*)),
+            this, SLOT(invalidateGrid()));
+    connect(mapDocument, SIGNAL(propertyAdded(Object*,QString)),
+            this, SLOT(invalidateGrid()));
+    connect(mapDocument, SIGNAL(propertyRemoved(Object*,QString)),
+            this, SLOT(invalidateGrid()));
+    connect(mapDocument, SIGNAL(propertyChanged(Object*,QString)),
+            this, SLOT(invalidateGrid()));
+    connect(mapDocument, SIGNAL(propertiesChanged(Object*)),
+            this, SLOT(invalidateGrid()));
+    connect(mapDocument, SIGNAL(propertiesChanged(QList<Object*>)),
+            this, SLOT(invalidateGrid()));
+}
+
+void PathfindingTool::clearConnections(MapDocument *mapDocument)
+{
+    if (!mapDocument)
+        return;
+
+    disconnect(mapDocument, SIGNAL(regionChanged(QRegion,Layer*)),
+               this, SLOT(regionChanged(QRegion,Layer*)));
+    disconnect(mapDocument, 0, this, SLOT(invalidateGrid()));
+}
+
+void PathfindingTool::setEndpoint(Qt::MouseButton button,
+                                  const QPoint &tilePos)
+{
+    const Map *map = mapDocument()->map();
+    if (!QRect(0, 0, map->width(), map->height()).contains(tilePos))
+        return;
+
+    if (button == Qt::LeftButton) {
+        if (mHasStart && mStart == tilePos)
+            return;
+        mStart = tilePos;
+        mHasStart = true;
+    } else {
+        if (mHasGoal && mGoal == tilePos)
+            return;
+        mGoal = tilePos;
+        mHasGoal = true;
+    }
+
+    mPathfindingItem->setEndpoints(
+                mHasStart ? QRegion(QRect(mStart, QSize(1, 1))) : QRegion(),
+                mHasGoal ? QRegion(QRect(mGoal, QSize(1, 1))) : QRegion());
+
+    mSearchValid = false;
+    scheduleUpdate();
+}
+
+void PathfindingTool::scheduleUpdate()
+{
+    mUpdateTimer.start();
+}
@@ -0,0 +1,109 @@
+/*
+ * pathfindingtool.h
+ * Copyright 2015, Sydoria Games <luax@sydoria.fr>
+ *
+ * This file is part of Tiled.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef PATHFINDINGTOOL_H
+#define PATHFINDINGTOOL_H
+
+#include "abstracttiletool.h"
+#include "pathfinder.h"
+#include "walkabilitygrid.h"
+
+#include <QRegion>
+#include <QTimer>
+
+namespace Tiled {
+
+class Layer;
+
+namespace Internal {
+
+class PathfindingItem;
+
+/**
+ * Previews the paths found over the walkability grid of the map. The left
+ * mouse button places the start cell and the right mouse button places the
+ * goal cell. Both can be dragged around.
+ *
+ * While the tool is active, the grid is kept up to date with the changes
+ * made to the map. Changed tiles only cause their cells to be rasterized
+ * again, while other changes cause the whole grid to be rebuilt. The path is
+ * only searched again when a cell looked at by the last search changed.
+ */
+class PathfindingTool : public AbstractTileTool
+{
+    Q_OBJECT
+
+public:
+    PathfindingTool(QObject *parent = 0);
+    ~PathfindingTool();
+
+    void activate(MapScene *scene);
+    void deactivate(MapScene *scene);
+
+    void mousePressed(QGraphicsSceneMouseEvent *event);
+    void mouseReleased(QGraphicsSceneMouseEvent *event);
+
+    void languageChanged();
+
+protected:
+    void mapDocumentChanged(MapDocument *oldDocument,
+                            MapDocument *newDocument);
+
+    /**
+     * Overridden to enable this tool regardless of the current layer, since
+     * the grid is made up of all layers.
+     */
+    void updateEnabledState();
+
+    void tilePositionChanged(const QPoint &tilePos);
+
+    void updateStatusInfo();
+
+private slots:
+    void regionChanged(const QRegion &region, Layer *layer);
+    void invalidateGrid();
+    void updateSearch();
+
+private:
+    void makeConnections();
+    void clearConnections(MapDocument *mapDocument);
+    void setEndpoint(Qt::MouseButton button, const QPoint &tilePos);
+    void scheduleUpdate();
+
+    PathfindingItem *mPathfindingItem;
+    PathFinder mPathFinder;
+    WalkabilityGrid mGrid;
+    bool mGridValid;
+    bool mSearchValid;
+    QRegion mChangedRegion;
+    QTimer mUpdateTimer;
+
+    bool mHasStart;
+    bool mHasGoal;
+    QPoint mStart;
+    QPoint mGoal;
+    Qt::MouseButton mDragButton;
+    bool mIsActive;
+};
+
+} // namespace Internal
+} // namespace Tiled
+
+#endif // PATHFINDINGTOOL_H
@@ -103,6 +103,10 @@ Preferences::Preferences()
     mMapsDirectory = stringValue("Current");
     mSettings->endGroup();
 
+    mSettings->beginGroup(QLatin1String("Documents"));
+    mHibernationThreshold = intValue("HibernationThreshold", 512);
+    mSettings->endGroup();
+
     TilesetManager *tilesetManager = TilesetManager::instance();
     tilesetManager->setReloadTilesetsOnChange(mReloadTilesetsOnChange);
     tilesetManager->setAnimateTiles(mShowTileAnimations);
@@ -409,6 +413,18 @@ void Preferences::setMapsDirectory(const QString &path)
     emit mapsDirectoryChanged();
 }
 
+/**
+ * Sets the amount of memory in megabytes that the tile layers of inactive
+ * documents may take before the least recently used ones are hibernated.
+ * A value of 0 disables hibernation.
+ */
+void Preferences::setHibernationThreshold(int megabytes)
+{
+    mHibernationThreshold = megabytes;
+    mSettings->setValue(QLatin1String("Documents/HibernationThreshold"),
+                        megabytes);
+}
+
 bool Preferences::boolValue(const char *key, bool defaultValue) const
 {
     return mSettings->value(QLatin1String(key), defaultValue).toBool();
@@ -92,6 +92,9 @@ public:
     QString mapsDirectory() const;
     void setMapsDirectory(const QString &path);
 
+    int hibernationThreshold() const { return mHibernationThreshold; }
+    void setHibernationThreshold(int megabytes);
+
     /**
      * Provides access to the QSettings instance to allow storing/retrieving
      * arbitrary values. The naming style for groups and keys is CamelCase.
@@ -163,6 +166,8 @@ private:
 
     QString mMapsDirectory;
 
+    int mHibernationThreshold;
+
     static Preferences *mInstance;
 };
 
@@ -304,6 +304,7 @@ void PreferencesDialog::fromPreferences()
     const Preferences *prefs = Preferences::instance();
     mUi->reloadTilesetImages->setChecked(prefs->reloadTilesetsOnChange());
     mUi->enableDtd->setChecked(prefs->dtdEnabled());
+    mUi->hibernationThreshold->setValue(prefs->hibernationThreshold());
     if (mUi->openGL->isEnabled())
         mUi->openGL->setChecked(prefs->useOpenGL());
 
@@ -325,6 +326,7 @@ void PreferencesDialog::toPreferences()
 
     prefs->setReloadTilesetsOnChanged(mUi->reloadTilesetImages->isChecked());
     prefs->setDtdEnabled(mUi->enableDtd->isChecked());
+    prefs->setHibernationThreshold(mUi->hibernationThreshold->value());
     prefs->setAutomappingDrawing(mUi->autoMapWhileDrawing->isChecked());
 }
 
@@ -51,6 +51,7 @@
 #include <QtGroupPropertyManager>
 
 #include <QCoreApplication>
+#include <QSet>
 
 namespace Tiled {
 namespace Internal {
@@ -63,6 +64,8 @@ PropertyBrowser::PropertyBrowser(QWidget *parent)
     , mVariantManager(new VariantPropertyManager(this))
     , mGroupManager(new QtGroupPropertyManager(this))
     , mCustomPropertiesGroup(0)
+    , mBuiltInPropertiesKey(-1)
+    , mPendingUpdates(0)
 {
     setFactoryForManager(mVariantManager, new VariantEditorFactory(this));
     setResizeMode(ResizeToContents);
@@ -99,6 +102,38 @@ PropertyBrowser::PropertyBrowser(QWidget *parent)
 
     connect(mVariantManager, SIGNAL(valueChanged(QtProperty*,QVariant)),
             SLOT(valueChanged(QtProperty*,QVariant)));
+
+    mUpdateTimer.setSingleShot(true);
+    mUpdateTimer.setInterval(0);
+    connect(&mUpdateTimer, SIGNAL(timeout()), SLOT(flushPendingUpdates()));
+
+    connect(Preferences::instance(), SIGNAL(objectTypesChanged()),
+            SLOT(objectTypesChanged()));
+}
+
+/**
+ * Returns a key identifying the set of built-in properties displayed for the
+ * given \a object. Objects with the same key share the same property rows.
+ */
+static int builtInPropertiesKey(const Object *object)
+{
+    if (!object)
+        return -1;
+
+    int subType = 0;
+
+    switch (object->typeId()) {
+    case Object::MapObjectType:
+        subType = static_cast<const MapObject*>(object)->cell().isEmpty() ? 0 : 1;
+        break;
+    case Object::LayerType:
+        subType = static_cast<const Layer*>(object)->layerType();
+        break;
+    default:
+        break;
+    }
+
+    return object->typeId() * 16 + subType;
 }
 
 void PropertyBrowser::setObject(Object *object)
@@ -106,45 +141,56 @@ void PropertyBrowser::setObject(Object *object)
     if (mObject == object)
         return;
 
-    // Destroy all previous properties
-    mVariantManager->clear();
-    mGroupManager->clear();
-    mPropertyToId.clear();
-    mIdToProperty.clear();
-    mNameToProperty.clear();
-    mCustomPropertiesGroup = 0;
-
+    const int key = builtInPropertiesKey(object);
     mObject = object;
 
-    if (!mObject)
-        return;
+    // Switching between objects of the same kind, like when clicking through
+    // objects or tiles, keeps the existing rows and only updates their values
+    if (key != mBuiltInPropertiesKey) {
+        mBuiltInPropertiesKey = key;
 
-    mUpdating = true;
+        // Destroy all previous properties
+        mVariantManager->clear();
+        mGroupManager->clear();
+        mPropertyToId.clear();
+        mIdToProperty.clear();
+        mNameToProperty.clear();
+        mCustomPropertiesGroup = 0;
 
-    // Add the built-in properties for each object type
-    switch (object->typeId()) {
-    case Object::MapType:               addMapProperties(); break;
-    case Object::MapObjectType:         addMapObjectProperties(); break;
-    case Object::LayerType:
-        switch (static_cast<Layer*>(object)->layerType()) {
-        case Layer::TileLayerType:      addTileLayerProperties();   break;
-        case Layer::ObjectGroupType:    addObjectGroupProperties(); break;
-        case Layer::ImageLayerType:     addImageLayerProperties();  break;
+        if (!mObject)
+            return;
+
+        mUpdating = true;
+
+        // Add the built-in properties for each object type
+        switch (object->typeId()) {
+        case Object::MapType:               addMapProperties(); break;
+        case Object::MapObjectType:         addMapObjectProperties(); break;
+        case Object::LayerType:
+            switch (static_cast<Layer*>(object)->layerType()) {
+            case Layer::TileLayerType:      addTileLayerProperties();   break;
+            case Layer::ObjectGroupType:    addObjectGroupProperties(); break;
+            case Layer::ImageLayerType:     addImageLayerProperties();  break;
+            }
+            break;
+        case Object::TilesetType:           addTilesetProperties(); break;
+        case Object::TileType:              addTileProperties(); break;
+        case Object::TerrainType:           addTerrainProperties(); break;
         }
-        break;
-    case Object::TilesetType:           addTilesetProperties(); break;
-    case Object::TileType:              addTileProperties(); break;
-    case Object::TerrainType:           addTerrainProperties(); break;
-    }
 
-    // Add a node for the custom properties
-    mCustomPropertiesGroup = mGroupManager->addProperty(tr("Custom Properties"));
-    addProperty(mCustomPropertiesGroup);
+        // Add a node for the custom properties
+        mCustomPropertiesGroup = mGroupManager->addProperty(tr("Custom Properties"));
+        addProperty(mCustomPropertiesGroup);
 
-    mUpdating = false;
+        mUpdating = false;
+    }
 
-    updateProperties();
-    updateCustomProperties();
+    if (!mObject)
+        return;
+
+    mPendingUpdates |= BuiltInProperties | CustomProperties;
+    if (isVisible())
+        flushPendingUpdates();
 }
 
 void PropertyBrowser::setMapDocument(MapDocument *mapDocument)
@@ -189,6 +235,8 @@ void PropertyBrowser::setMapDocument(MapDocument *mapDocument)
                 SLOT(propertyChanged(Object*,QString)));
         connect(mapDocument, SIGNAL(propertiesChanged(Object*)),
                 SLOT(propertiesChanged(Object*)));
+        connect(mapDocument, SIGNAL(propertiesChanged(QList<Object*>)),
+                SLOT(propertiesChanged(QList<Object*>)));
         connect(mapDocument, SIGNAL(selectedObjectsChanged()),
                 SLOT(selectedObjectsChanged()));
         connect(mapDocument, SIGNAL(selectedTilesChanged()),
@@ -203,6 +251,9 @@ bool PropertyBrowser::isCustomPropertyItem(QtBrowserItem *item) const
 
 void PropertyBrowser::editCustomProperty(const QString &name)
 {
+    // The property may have just been added
+    flushPendingUpdates();
+
     QtVariantProperty *property = mNameToProperty.value(name);
     if (!property)
         return;
@@ -215,123 +266,152 @@ void PropertyBrowser::editCustomProperty(const QString &name)
 void PropertyBrowser::mapChanged()
 {
     if (mObject == mMapDocument->map())
-        updateProperties();
+        scheduleUpdate(BuiltInProperties);
 }
 
 void PropertyBrowser::objectsChanged(const QList<MapObject *> &objects)
 {
+    if (mPendingUpdates & BuiltInProperties)
+        return;
     if (mObject && mObject->typeId() == Object::MapObjectType)
         if (objects.contains(static_cast<MapObject*>(mObject)))
-            updateProperties();
+            scheduleUpdate(BuiltInProperties);
 }
 
 void PropertyBrowser::layerChanged(int index)
 {
     if (mObject == mMapDocument->map()->layerAt(index))
-        updateProperties();
+        scheduleUpdate(BuiltInProperties);
 }
 
 void PropertyBrowser::objectGroupChanged(ObjectGroup *objectGroup)
 {
     if (mObject == objectGroup)
-        updateProperties();
+        scheduleUpdate(BuiltInProperties);
 }
 
 void PropertyBrowser::imageLayerChanged(ImageLayer *imageLayer)
 {
     if (mObject == imageLayer)
-        updateProperties();
+        scheduleUpdate(BuiltInProperties);
 }
 
 void PropertyBrowser::tilesetChanged(Tileset *tileset)
 {
     if (mObject == tileset)
-        updateProperties();
+        scheduleUpdate(BuiltInProperties);
 }
 
 void PropertyBrowser::terrainChanged(Tileset *tileset, int index)
 {
     if (mObject == tileset->terrain(index))
-        updateProperties();
+        scheduleUpdate(BuiltInProperties);
 }
 
-void PropertyBrowser::propertyAdded(Object *object, const QString &name)
+void PropertyBrowser::propertyAdded(Object *object, const QString &)
 {
-    if (!mMapDocument->currentObjects().contains(object))
-        return;
-    if (mNameToProperty.keys().contains(name)) {
-        if (mObject == object) {
-            mUpdating = true;
-            mNameToProperty[name]->setValue(mObject->property(name));
-            mUpdating = false;
-        }
-    } else {
-        // Determine the property preceding the new property, if any
-        const int index = mObject->properties().keys().indexOf(name);
-        const QList<QtProperty *> properties = mCustomPropertiesGroup->subProperties();
-        QtProperty *precedingProperty = (index > 0) ? properties.at(index - 1) : 0;
+    propertiesChanged(object);
+}
 
-        mUpdating = true;
-        QtVariantProperty *property = mVariantManager->addProperty(QVariant::String, name);
-        property->setValue(mObject->property(name));
-        mCustomPropertiesGroup->insertSubProperty(property, precedingProperty);
-        mPropertyToId.insert(property, CustomProperty);
-        mNameToProperty.insert(name, property);
-        mUpdating = false;
-    }
-    updatePropertyColor(name);
+void PropertyBrowser::propertyRemoved(Object *object, const QString &)
+{
+    propertiesChanged(object);
+}
+
+void PropertyBrowser::propertyChanged(Object *object, const QString &)
+{
+    propertiesChanged(object);
 }
 
-void PropertyBrowser::propertyRemoved(Object *object, const QString &name)
+void PropertyBrowser::propertiesChanged(Object *object)
 {
-    if (!mMapDocument->currentObjects().contains(object))
+    // Changing a property of many selected objects emits a signal for each of
+    // them, so avoid looking through the selection again once scheduled
+    if (mPendingUpdates & CustomProperties)
         return;
-    if (mObject == object) {
-        bool deleteProperty = true;
-        foreach (Object *obj, mMapDocument->currentObjects()) {
-            if (mObject == obj)
-                continue;
-            if (obj->properties().contains(name)) {
-                // An other selected object still has this property, so just clear the value.
-                mUpdating = true;
-                mNameToProperty[name]->setValue(tr(""));
-                mUpdating = false;
-                deleteProperty = false;
-                break;
-            }
+    if (object == mObject || mMapDocument->currentObjects().contains(object))
+        scheduleUpdate(CustomProperties);
+}
+
+void PropertyBrowser::propertiesChanged(const QList<Object*> &objects)
+{
+    if (mPendingUpdates & CustomProperties)
+        return;
+    if (objects.contains(mObject)) {
+        scheduleUpdate(CustomProperties);
+        return;
+    }
+
+    const QSet<Object*> changed = objects.toSet();
+    foreach (Object *object, mMapDocument->currentObjects()) {
+        if (changed.contains(object)) {
+            scheduleUpdate(CustomProperties);
+            return;
         }
-        // No other selected objects have this property so delete it.
-        if (deleteProperty)
-            delete mNameToProperty.take(name);
     }
-    updatePropertyColor(name);
 }
 
-void PropertyBrowser::propertyChanged(Object *object, const QString &name)
+void PropertyBrowser::selectedObjectsChanged()
 {
-    if (mObject == object) {
-        mUpdating = true;
-        mNameToProperty[name]->setValue(object->property(name));
-        mUpdating = false;
-    }
-    if (mMapDocument->currentObjects().contains(object))
-        updatePropertyColor(name);
+    scheduleUpdate(CustomProperties);
 }
 
-void PropertyBrowser::propertiesChanged(Object *object)
+void PropertyBrowser::selectedTilesChanged()
 {
-    if (mMapDocument->currentObjects().contains(object))
-        updateCustomProperties();
+    scheduleUpdate(CustomProperties);
 }
 
-void PropertyBrowser::selectedObjectsChanged()
+static QStringList objectTypeNames()
 {
-    updateCustomProperties();
+    QStringList names;
+    foreach (const ObjectType &type, Preferences::instance()->objectTypes())
+        names.append(type.name);
+    return names;
 }
 
-void PropertyBrowser::selectedTilesChanged()
+void PropertyBrowser::objectTypesChanged()
+{
+    // The Type row is only there while a map object is displayed
+    if (QtVariantProperty *typeProperty = mIdToProperty.value(TypeProperty))
+        typeProperty->setAttribute(QLatin1String("suggestions"),
+                                   objectTypeNames());
+}
+
+/**
+ * Marks the given parts of the displayed properties as out of date. They are
+ * updated once control returns to the event loop, so that the many signals
+ * emitted while dragging or editing a large selection cause a single update.
+ * While the browser is hidden, the update is postponed until it is shown.
+ */
+void PropertyBrowser::scheduleUpdate(int flags)
 {
-    updateCustomProperties();
+    mPendingUpdates |= flags;
+    if (isVisible())
+        mUpdateTimer.start();
+}
+
+void PropertyBrowser::flushPendingUpdates()
+{
+    mUpdateTimer.stop();
+
+    const int pending = mPendingUpdates;
+    mPendingUpdates = 0;
+
+    if (!mObject || !mMapDocument)
+        return;
+
+    if (pending & BuiltInProperties)
+        updateProperties();
+    if (pending & CustomProperties)
+        updateCustomProperties();
+}
+
+void PropertyBrowser::showEvent(QShowEvent *event)
+{
+    QtTreePropertyBrowser::showEvent(event);
+
+    if (mPendingUpdates)
+        flushPendingUpdates();
 }
 
 void PropertyBrowser::valueChanged(QtProperty *property, const QVariant &val)
@@ -423,14 +503,6 @@ void PropertyBrowser::addMapProperties()
     addProperty(groupProperty);
 }
 
-static QStringList objectTypeNames()
-{
-    QStringList names;
-    foreach (const ObjectType &type, Preferences::instance()->objectTypes())
-        names.append(type.name);
-    return names;
-}
-
 void PropertyBrowser::addMapObjectProperties()
 {
     QtProperty *groupProperty = mGroupManager->addProperty(tr("Object"));
@@ -939,84 +1011,93 @@ void PropertyBrowser::updateCustomProperties()
     if (!mObject)
         return;
 
-    mUpdating = true;
-
-    qDeleteAll(mNameToProperty);
-    mNameToProperty.clear();
+    const QList<Object*> &objects = mMapDocument->currentObjects();
 
+    // Combine the properties of all selected objects in a single pass,
+    // counting the objects that have each property and remembering which
+    // properties have values differing from those of mObject.
     mCombinedProperties = mObject->properties();
-    // Add properties from selected objects which mObject does not contain to mCombinedProperties.
-    foreach (Object *obj, mMapDocument->currentObjects()) {
-        if (obj == mObject)
-            continue;
+    QHash<QString, int> objectCounts;
+    QSet<QString> differingValues;
 
+    foreach (Object *obj, objects) {
         QMapIterator<QString,QString> it(obj->properties());
 
         while (it.hasNext()) {
             it.next();
-            if (!mCombinedProperties.contains(it.key())) {
-                mCombinedProperties.insert(it.key(), tr(""));
-            }
-        }
-    }
-
-    QMapIterator<QString,QString> it(mCombinedProperties);
-
-    while (it.hasNext()) {
-        it.next();
+            ++objectCounts[it.key()];
 
-        QtVariantProperty *property = createProperty(CustomProperty,
-                                                     QVariant::String,
-                                                     it.key(),
-                                                     mCustomPropertiesGroup);
+            if (obj == mObject)
+                continue;
 
-        QList<QString> readOnly;
-        readOnly.append(QLatin1String("hasHorizontalSymmetry"));
-        readOnly.append(QLatin1String("gfxId"));
-        readOnly.append(QLatin1String("elementId"));
-        readOnly.append(QLatin1String("elementIdSymmetry"));
+            Properties::iterator combined = mCombinedProperties.find(it.key());
+            if (combined == mCombinedProperties.end())
+                combined = mCombinedProperties.insert(it.key(), QString());
+            if (combined.value() != it.value())
+                differingValues.insert(it.key());
+        }
+    }
 
-        if (readOnly.contains(it.key()))
-            property->setEnabled(false);
+    mUpdating = true;
 
-        property->setValue(it.value());
-        updatePropertyColor(it.key());
+    // Remove the rows of properties that are gone
+    QHash<QString, QtVariantProperty *>::iterator it = mNameToProperty.begin();
+    while (it != mNameToProperty.end()) {
+        if (!mCombinedProperties.contains(it.key())) {
+            mPropertyToId.remove(it.value());
+            delete it.value();
+            it = mNameToProperty.erase(it);
+        } else {
+            ++it;
+        }
     }
 
-    mUpdating = false;
-}
-
-// If there are other objects selected check if their properties are equal. If not give them a gray color.
-void PropertyBrowser::updatePropertyColor(const QString &name)
-{
-    QtVariantProperty *property = mNameToProperty.value(name);
-    if (!property)
-        return;
+    QList<QString> readOnly;
+    readOnly.append(QLatin1String("hasHorizontalSymmetry"));
+    readOnly.append(QLatin1String("gfxId"));
+    readOnly.append(QLatin1String("elementId"));
+    readOnly.append(QLatin1String("elementIdSymmetry"));
+
+    // Update the remaining rows in place and insert the new ones. The rows are
+    // kept in the same order as the combined properties.
+    QtProperty *precedingProperty = 0;
+    QMapIterator<QString,QString> combinedIt(mCombinedProperties);
+
+    while (combinedIt.hasNext()) {
+        combinedIt.next();
+        const QString &name = combinedIt.key();
+
+        QtVariantProperty *property = mNameToProperty.value(name);
+        if (!property) {
+            property = mVariantManager->addProperty(QVariant::String, name);
+            mCustomPropertiesGroup->insertSubProperty(property, precedingProperty);
+            mPropertyToId.insert(property, CustomProperty);
+            mNameToProperty.insert(name, property);
+
+            if (readOnly.contains(name))
+                property->setEnabled(false);
+        }
 
-    QString propertyName = property->propertyName();
-    QString propertyValue = property->valueText();
+        property->setValue(combinedIt.value());
 
-    // If one of the objects doesn't have this property then gray out the name and value.
-    foreach (Object *obj, mMapDocument->currentObjects()) {
-        if (!obj->hasProperty(propertyName)) {
+        // If one of the objects doesn't have this property then gray out the
+        // name and value. If one of them has a different value then gray out
+        // the value.
+        if (objectCounts.value(name) < objects.size()) {
             property->setNameColor(Qt::gray);
             property->setValueColor(Qt::gray);
-            return;
-        }
-    }
-
-    // If one of the objects doesn't have the same property value then gray out the value.
-    foreach (Object *obj, mMapDocument->currentObjects()) {
-        if (obj == mObject)
-            continue;
-        if (obj->property(propertyName) != propertyValue) {
+        } else if (differingValues.contains(name)) {
+            property->setNameColor(Qt::black);
             property->setValueColor(Qt::gray);
-            return;
+        } else {
+            property->setNameColor(Qt::black);
+            property->setValueColor(Qt::black);
         }
+
+        precedingProperty = property;
     }
 
-    property->setNameColor(Qt::black);
-    property->setValueColor(Qt::black);
+    mUpdating = false;
 }
 
 } // namespace Internal
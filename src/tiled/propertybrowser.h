@@ -22,6 +22,7 @@
 #define PROPERTYBROWSER_H
 
 #include <QHash>
+#include <QTimer>
 #include <QUndoCommand>
 
 #include <QtTreePropertyBrowser>
@@ -92,12 +93,24 @@ private slots:
     void propertyRemoved(Object *object, const QString &name);
     void propertyChanged(Object *object, const QString &name);
     void propertiesChanged(Object *object);
+    void propertiesChanged(const QList<Object*> &objects);
     void selectedObjectsChanged();
     void selectedTilesChanged();
+    void objectTypesChanged();
 
     void valueChanged(QtProperty *property, const QVariant &val);
 
+    void flushPendingUpdates();
+
+protected:
+    void showEvent(QShowEvent *event);
+
 private:
+    enum UpdateFlag {
+        BuiltInProperties   = 0x1,
+        CustomProperties    = 0x2
+    };
+
     enum PropertyId {
         NameProperty,
         TypeProperty,
@@ -148,12 +161,11 @@ private:
                                       const QString &name,
                                       QtProperty *parent);
 
+    void scheduleUpdate(int flags);
     void updateProperties();
     void updateCustomProperties();
     bool mUpdating;
 
-    void updatePropertyColor(const QString &name);
-
     Object *mObject;
     MapDocument *mMapDocument;
 
@@ -165,6 +177,10 @@ private:
     QHash<PropertyId, QtVariantProperty *> mIdToProperty;
     QHash<QString, QtVariantProperty *> mNameToProperty;
 
+    int mBuiltInPropertiesKey;
+    int mPendingUpdates;
+    QTimer mUpdateTimer;
+
     QStringList mStaggerAxisNames;
     QStringList mStaggerIndexNames;
     QStringList mOrientationNames;
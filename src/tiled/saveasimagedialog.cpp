@@ -199,8 +199,19 @@ void SaveAsImageDialog::accept()
             if (objGroup->drawOrder() == ObjectGroup::TopDownOrder)
                 qStableSort(objects.begin(), objects.end(), objectLessThan);
 
+            // Runs of plain tile objects are drawn in batches
+            QList<const MapObject*> tileObjects;
+
             foreach (const MapObject *object, objects) {
                 if (object->isVisible()) {
+                    if (renderer->canBatchTileObject(object)) {
+                        tileObjects.append(object);
+                        continue;
+                    }
+
+                    renderer->drawTileObjects(&painter, tileObjects);
+                    tileObjects.clear();
+
                     if (object->rotation() != qreal(0)) {
                         QPointF origin = renderer->pixelToScreenCoords(object->position());
                         painter.save();
@@ -216,6 +227,8 @@ void SaveAsImageDialog::accept()
                         painter.restore();
                 }
             }
+
+            renderer->drawTileObjects(&painter, tileObjects);
         } else if (imageLayer) {
             renderer->drawImageLayer(&painter, imageLayer);
         }
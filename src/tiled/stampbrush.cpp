@@ -26,12 +26,16 @@
 #include "map.h"
 #include "mapdocument.h"
 #include "mapscene.h"
-#include "painttilelayer.h"
+#include "paintsession.h"
 #include "tilelayer.h"
 
 #include <math.h>
+#include <QHash>
+#include <QPair>
 #include <QVector>
 
+#include <algorithm>
+
 using namespace Tiled;
 using namespace Tiled::Internal;
 
@@ -46,13 +50,17 @@ StampBrush::StampBrush(QObject *parent)
     , mBrushBehavior(Free)
     , mStampReferenceX(0)
     , mStampReferenceY(0)
+    , mPaintSession(0)
     , mIsRandom(false)
+    , mRandomStamp(new TileLayer(QString(), 0, 0, 1, 1))
 {
 }
 
 StampBrush::~StampBrush()
 {
+    delete mPaintSession;
     delete mStamp;
+    delete mRandomStamp;
 }
 
 void StampBrush::tilePositionChanged(const QPoint &)
@@ -63,7 +71,7 @@ void StampBrush::tilePositionChanged(const QPoint &)
     switch (mBrushBehavior) {
     case Paint:
         foreach (const QPoint &p, pointsOnLine(x, y, mStampX, mStampY))
-            doPaint(true, p.x(), p.y());
+            doPaint(p.x(), p.y());
         break;
     case LineStartSet:
         configureBrush(pointsOnLine(mStampReferenceX, mStampReferenceY,
@@ -104,12 +112,12 @@ void StampBrush::mousePressed(QGraphicsSceneMouseEvent *event)
             mBrushBehavior = CircleMidSet;
             break;
         case LineStartSet:
-            doPaint(false, 0, 0);
+            doPaint(0, 0);
             mStampReferenceX = mStampX;
             mStampReferenceY = mStampY;
             break;
         case CircleMidSet:
-            doPaint(false, 0, 0);
+            doPaint(0, 0);
             break;
         case Paint:
             beginPaint();
@@ -137,8 +145,11 @@ void StampBrush::mouseReleased(QGraphicsSceneMouseEvent *event)
         }
         break;
     case Paint:
-        if (event->button() == Qt::LeftButton)
+        if (event->button() == Qt::LeftButton) {
+            endPaint();
             mBrushBehavior = Free;
+        }
+        break;
     default:
         // do nothing?
         break;
@@ -170,9 +181,8 @@ void StampBrush::configureBrush(const QVector<QPoint> &list)
             reg += update;
 
             if (mIsRandom) {
-                TileLayer *newStamp = getRandomTileLayer();
-                stamp->merge(p, newStamp);
-                delete newStamp;
+                if (stamp->contains(p))
+                    stamp->setCell(p.x(), p.y(), pickRandomCell());
             } else {
                 stamp->merge(p, mStamp);
             }
@@ -216,6 +226,15 @@ void StampBrush::modifiersChanged(Qt::KeyboardModifiers modifiers)
     }
 }
 
+void StampBrush::deactivate(MapScene *scene)
+{
+    endPaint();
+    if (mBrushBehavior == Paint)
+        mBrushBehavior = Free;
+
+    AbstractTileTool::deactivate(scene);
+}
+
 void StampBrush::languageChanged()
 {
     setName(tr("Stamp Brush"));
@@ -225,6 +244,11 @@ void StampBrush::languageChanged()
 void StampBrush::mapDocumentChanged(MapDocument *oldDocument,
                                     MapDocument *newDocument)
 {
+    // Commit any stroke in progress to the document it was painted on
+    endPaint();
+    if (mBrushBehavior == Paint)
+        mBrushBehavior = Free;
+
     AbstractTileTool::mapDocumentChanged(oldDocument, newDocument);
 
     // Reset the brush, since it probably became invalid
@@ -232,27 +256,63 @@ void StampBrush::mapDocumentChanged(MapDocument *oldDocument,
     setStamp(0);
 }
 
-TileLayer *StampBrush::getRandomTileLayer() const
+Cell StampBrush::pickRandomCell() const
 {
-    if (mRandomList.empty())
-        return 0;
-
-    TileLayer *ret = new TileLayer(QString(), 0, 0, 1, 1);
-    ret->setCell(0, 0, mRandomList.at(rand() % mRandomList.size()));
-    return ret;
+    if (mRandomCells.isEmpty())
+        return Cell();
+
+    // Pick a position within the total occurrence count and look up the
+    // cell it falls in
+    const int total = mRandomCumulative.last();
+    const int pick = qMin(total - 1,
+                          int((double) rand() / ((double) RAND_MAX + 1) * total));
+    const int index = std::upper_bound(mRandomCumulative.begin(),
+                                       mRandomCumulative.end(),
+                                       pick) - mRandomCumulative.begin();
+    return mRandomCells.at(index);
 }
 
 void StampBrush::updateRandomList()
 {
-    mRandomList.clear();
+    mRandomCells.clear();
+    mRandomCumulative.clear();
 
     if (!mStamp)
         return;
 
-    for (int x = 0; x < mStamp->width(); x++)
-        for (int y = 0; y < mStamp->height(); y++)
-            if (!mStamp->cellAt(x, y).isEmpty())
-                mRandomList.append(mStamp->cellAt(x, y));
+    // Count the occurrences of each distinct cell
+    typedef QPair<Tile*, int> CellKey;
+    QHash<CellKey, int> indexes;
+    QVector<int> counts;
+
+    for (int y = 0; y < mStamp->height(); y++) {
+        for (int x = 0; x < mStamp->width(); x++) {
+            const Cell &cell = mStamp->cellAt(x, y);
+            if (cell.isEmpty())
+                continue;
+
+            const int flags = (cell.flippedHorizontally ? 1 : 0) |
+                              (cell.flippedVertically ? 2 : 0) |
+                              (cell.flippedAntiDiagonally ? 4 : 0);
+            const CellKey key(cell.tile, flags);
+
+            QHash<CellKey, int>::const_iterator it = indexes.constFind(key);
+            if (it == indexes.constEnd()) {
+                indexes.insert(key, mRandomCells.size());
+                mRandomCells.append(cell);
+                counts.append(1);
+            } else {
+                ++counts[it.value()];
+            }
+        }
+    }
+
+    int cumulative = 0;
+    mRandomCumulative.reserve(counts.size());
+    foreach (int count, counts) {
+        cumulative += count;
+        mRandomCumulative.append(cumulative);
+    }
 }
 
 void StampBrush::setStamp(TileLayer *stamp)
@@ -278,8 +338,24 @@ void StampBrush::beginPaint()
     if (mBrushBehavior != Free)
         return;
 
+    TileLayer *tileLayer = currentTileLayer();
+    Q_ASSERT(tileLayer);
+
     mBrushBehavior = Paint;
-    doPaint(false, mStampX, mStampY);
+
+    delete mPaintSession;
+    mPaintSession = new PaintSession(mapDocument(), tileLayer);
+    doPaint(mStampX, mStampY);
+}
+
+void StampBrush::endPaint()
+{
+    if (!mPaintSession)
+        return;
+
+    mPaintSession->finish();
+    delete mPaintSession;
+    mPaintSession = 0;
 }
 
 void StampBrush::beginCapture()
@@ -330,8 +406,22 @@ QRect StampBrush::capturedArea() const
     return captured;
 }
 
-void StampBrush::doPaint(bool mergeable, int whereX, int whereY)
+void StampBrush::doPaint(int whereX, int whereY)
 {
+    if (mPaintSession) {
+        // Random strokes paint the previewed cell and pick the next one
+        // for each step, without going through a stamp layer
+        if (mIsRandom) {
+            const Cell &cell = mRandomStamp->cellAt(0, 0);
+            if (!cell.isEmpty())
+                mPaintSession->paintCell(whereX, whereY, cell);
+            setRandomStamp();
+        } else if (const TileLayer *stamp = brushItem()->tileLayer()) {
+            mPaintSession->paint(whereX, whereY, stamp);
+        }
+        return;
+    }
+
     TileLayer *stamp = brushItem()->tileLayer();
 
     if (!stamp)
@@ -341,16 +431,9 @@ void StampBrush::doPaint(bool mergeable, int whereX, int whereY)
     TileLayer *tileLayer = currentTileLayer();
     Q_ASSERT(tileLayer);
 
-    if (!tileLayer->bounds().intersects(QRect(whereX, whereY,
-                                              stamp->width(),
-                                              stamp->height())))
-        return;
-
-    PaintTileLayer *paint = new PaintTileLayer(mapDocument(), tileLayer,
-                            whereX, whereY, stamp);
-    paint->setMergeable(mergeable);
-    mapDocument()->undoStack()->push(paint);
-    mapDocument()->emitRegionEdited(brushItem()->tileRegion(), tileLayer);
+    PaintSession session(mapDocument(), tileLayer);
+    session.paint(whereX, whereY, stamp);
+    session.finish();
 }
 
 /**
@@ -358,9 +441,6 @@ void StampBrush::doPaint(bool mergeable, int whereX, int whereY)
  */
 void StampBrush::updatePosition()
 {
-    if (mIsRandom)
-        setRandomStamp();
-
     const QPoint tilePos = tilePosition();
 
     if (!brushItem()->tileLayer()) {
@@ -393,7 +473,19 @@ void StampBrush::setRandom(bool value)
 
 void StampBrush::setRandomStamp()
 {
-    TileLayer *t = getRandomTileLayer();
-    brushItem()->setTileLayer(t);
-    delete t;
+    if (mRandomCells.isEmpty()) {
+        brushItem()->setTileLayer(0);
+        return;
+    }
+
+    const Cell cell = pickRandomCell();
+    mRandomStamp->setCell(0, 0, cell);
+
+    // When the brush item already shows the random stamp, only its cell
+    // needs to change
+    const TileLayer *shown = brushItem()->tileLayer();
+    if (shown && shown->size() == mRandomStamp->size())
+        brushItem()->setTileLayerCell(0, 0, cell);
+    else
+        brushItem()->setTileLayer(mRandomStamp);
 }
@@ -32,6 +32,7 @@ class Tile;
 namespace Internal {
 
 class MapDocument;
+class PaintSession;
 
 /**
  * Implements a tile brush that acts like a stamp. It is able to paint a block
@@ -49,6 +50,8 @@ public:
     void mousePressed(QGraphicsSceneMouseEvent *event);
     void mouseReleased(QGraphicsSceneMouseEvent *event);
 
+    void deactivate(MapScene *scene);
+
     void modifiersChanged(Qt::KeyboardModifiers modifiers);
 
     void languageChanged();
@@ -84,14 +87,15 @@ protected:
 
 private:
     void beginPaint();
+    void endPaint();
 
     /**
      * Merges the tile layer of its brush item into the current map.
-     * mergeable determines if this can be merged with similar actions for undo.
      * whereX and whereY give an offset where to merge the brush items tilelayer
-     * into the current map.
+     * into the current map. While a stroke is in progress, the paint is
+     * collected by the paint session, otherwise it is committed immediately.
      */
-    void doPaint(bool mergeable, int whereX, int whereY);
+    void doPaint(int whereX, int whereY);
 
     void beginCapture();
     void endCapture();
@@ -150,18 +154,36 @@ private:
      */
     int mStampReferenceX, mStampReferenceY;
 
+    /**
+     * The paint session of the current stroke, while in Paint mode.
+     */
+    PaintSession *mPaintSession;
+
     bool mIsRandom;
-    QList<Cell> mRandomList;
 
     /**
-     * Returns a tile layer containing one tile randomly choosen
-     * from mRandomList.
+     * The distinct non-empty cells of mStamp, along with the cumulative
+     * number of times they occur. Used to pick random cells with the same
+     * distribution as the stamp without scanning it.
+     */
+    QVector<Cell> mRandomCells;
+    QVector<int> mRandomCumulative;
+
+    /**
+     * A 1x1 tile layer that is reused to show the random stamp.
+     */
+    TileLayer *mRandomStamp;
+
+    /**
+     * Returns a cell randomly choosen from the cumulative table. Returns an
+     * empty cell when there are no cells to choose from.
      */
-    TileLayer *getRandomTileLayer() const;
+    Cell pickRandomCell() const;
 
     /**
-     * Updates the list used random stamps.
-     * This is done by taking all non-null tiles from the original stamp mStamp.
+     * Updates the table used for random stamps.
+     * This is done by counting all non-null tiles from the original stamp
+     * mStamp.
      */
     void updateRandomList();
 
@@ -53,6 +53,7 @@ SOURCES += aboutdialog.cpp \
     automapperwrapper.cpp \
     automappingmanager.cpp \
     automappingutils.cpp  \
+    batchautomapper.cpp \
     brushitem.cpp \
     bucketfilltool.cpp \
     changeimagelayerposition.cpp \
@@ -85,6 +86,7 @@ SOURCES += aboutdialog.cpp \
     createscalableobjecttool.cpp \
     createtileobjecttool.cpp \
     documentmanager.cpp \
+    editjournal.cpp \
     editpolygontool.cpp \
     editterraindialog.cpp \
     eraser.cpp \
@@ -97,6 +99,7 @@ SOURCES += aboutdialog.cpp \
     imagelayeritem.cpp \
     imagemovementtool.cpp \
     languagemanager.cpp \
+    layercompositeitem.cpp \
     layerdock.cpp \
     layermodel.cpp \
     main.cpp \
@@ -124,7 +127,11 @@ SOURCES += aboutdialog.cpp \
     objecttypesmodel.cpp \
     offsetlayer.cpp \
     offsetmapdialog.cpp \
+    paintsession.cpp \
     painttilelayer.cpp \
+    pathfinder.cpp \
+    pathfindingitem.cpp \
+    pathfindingtool.cpp \
     pluginmanager.cpp \
     preferences.cpp \
     preferencesdialog.cpp \
@@ -183,6 +190,7 @@ HEADERS += aboutdialog.h \
     automapperwrapper.h \
     automappingmanager.h \
     automappingutils.h \
+    batchautomapper.h \
     brushitem.h \
     bucketfilltool.h \
     changeimagelayerposition.h \
@@ -215,6 +223,7 @@ HEADERS += aboutdialog.h \
     createscalableobjecttool.h \
     createtileobjecttool.h \
     documentmanager.h \
+    editjournal.h \
     editpolygontool.h \
     editterraindialog.h \
     eraser.h \
@@ -227,6 +236,7 @@ HEADERS += aboutdialog.h \
     imagelayeritem.h \
     imagemovementtool.h \
     languagemanager.h \
+    layercompositeitem.h \
     layerdock.h \
     layermodel.h \
     macsupport.h \
@@ -254,7 +264,11 @@ HEADERS += aboutdialog.h \
     objecttypesmodel.h \
     offsetlayer.h \
     offsetmapdialog.h \
+    paintsession.h \
     painttilelayer.h \
+    pathfinder.h \
+    pathfindingitem.h \
+    pathfindingtool.h \
     pluginmanager.h \
     preferencesdialog.h \
     preferences.h \
@@ -87,7 +87,7 @@ void TilePainter::setCell(int x, int y, const Cell &cell)
 
     DrawMarginsWatcher watcher(mMapDocument, mTileLayer);
     mTileLayer->setCell(layerX, layerY, cell);
-    mMapDocument->emitRegionChanged(QRegion(x, y, 1, 1));
+    mMapDocument->emitRegionChanged(QRegion(x, y, 1, 1), mTileLayer);
 }
 
 void TilePainter::setCells(int x, int y,
@@ -108,10 +108,27 @@ void TilePainter::setCells(int x, int y,
                          tileLayer,
                          region.translated(-mTileLayer->position()));
 
-    mMapDocument->emitRegionChanged(region);
+    mMapDocument->emitRegionChanged(region, mTileLayer);
 }
 
-void TilePainter::drawCells(int x, int y, TileLayer *tileLayer)
+void TilePainter::restoreCells(int x, int y,
+                               TileLayer *tileLayer,
+                               const QRegion &region)
+{
+    const QRegion restored = region & mTileLayer->bounds();
+    if (restored.isEmpty())
+        return;
+
+    DrawMarginsWatcher watcher(mMapDocument, mTileLayer);
+    mTileLayer->setCells(x - mTileLayer->x(),
+                         y - mTileLayer->y(),
+                         tileLayer,
+                         restored.translated(-mTileLayer->position()));
+
+    mMapDocument->emitRegionChanged(restored, mTileLayer);
+}
+
+void TilePainter::drawCells(int x, int y, const TileLayer *tileLayer)
 {
     const QRegion region = paintableRegion(x, y,
                                            tileLayer->width(),
@@ -135,7 +152,7 @@ void TilePainter::drawCells(int x, int y, TileLayer *tileLayer)
         }
     }
 
-    mMapDocument->emitRegionChanged(region);
+    mMapDocument->emitRegionChanged(region, mTileLayer);
 }
 
 void TilePainter::drawStamp(const TileLayer *stamp,
@@ -171,7 +188,7 @@ void TilePainter::drawStamp(const TileLayer *stamp,
         }
     }
 
-    mMapDocument->emitRegionChanged(region);
+    mMapDocument->emitRegionChanged(region, mTileLayer);
 }
 
 void TilePainter::erase(const QRegion &region)
@@ -181,7 +198,7 @@ void TilePainter::erase(const QRegion &region)
         return;
 
     mTileLayer->erase(paintable.translated(-mTileLayer->position()));
-    mMapDocument->emitRegionChanged(paintable);
+    mMapDocument->emitRegionChanged(paintable, mTileLayer);
 }
 
 QRegion TilePainter::computeFillRegion(const QPoint &fillOrigin) const
@@ -75,13 +75,22 @@ public:
     void setCells(int x, int y, TileLayer *tileLayer,
                   const QRegion &mask = QRegion());
 
+    /**
+     * Sets the cells within \a region to the cells in the given tile layer,
+     * positioned at \a x and \a y. Unlike setCells(), the region is not
+     * clipped to the tile selection. Meant for restoring the exact cells
+     * changed by an earlier operation.
+     */
+    void restoreCells(int x, int y, TileLayer *tileLayer,
+                      const QRegion &region);
+
     /**
      * Draws the cells in the given tile layer at the given coordinates. The
      * coordinates \a x and \a y are relative to the map origin.
      *
      * Empty cells are skipped.
      */
-    void drawCells(int x, int y, TileLayer *tileLayer);
+    void drawCells(int x, int y, const TileLayer *tileLayer);
 
     /**
      * Draws the stamp within the given \a drawRegion region, repeating the
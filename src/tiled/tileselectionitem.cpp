@@ -57,15 +57,27 @@ void TileSelectionItem::paint(QPainter *painter,
     highlight.setAlpha(128);
 
     MapRenderer *renderer = mMapDocument->renderer();
-    renderer->drawTileSelection(painter, selection, highlight,
-                                option->exposedRect);
+
+    // Only the part of the selection within the exposed area is drawn
+    const QPolygonF exposedTiles =
+            renderer->screenToTileCoords(QPolygonF(option->exposedRect));
+    const QRect exposedArea =
+            exposedTiles.boundingRect().toAlignedRect().adjusted(-1, -1, 1, 1);
+
+    renderer->drawTileSelection(painter, selection.intersected(exposedArea),
+                                highlight, option->exposedRect);
 }
 
 void TileSelectionItem::selectionChanged(const QRegion &newSelection,
                                          const QRegion &oldSelection)
 {
-    prepareGeometryChange();
-    updateBoundingRect();
+    // Changing the geometry repaints the whole item, so avoid it when the
+    // bounds of the selection stay the same
+    const QRect b = newSelection.boundingRect();
+    if (mMapDocument->renderer()->boundingRect(b) != mBoundingRect) {
+        prepareGeometryChange();
+        updateBoundingRect();
+    }
 
     // Make sure changes within the bounding rect are updated
     const QRect changedArea = newSelection.xored(oldSelection).boundingRect();
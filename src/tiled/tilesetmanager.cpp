@@ -26,11 +26,40 @@
 #include "tile.h"
 #include "tileset.h"
 
+#include <QHash>
 #include <QImage>
+#include <QRunnable>
+#include <QThreadPool>
+#include <QVector>
 
 using namespace Tiled;
 using namespace Tiled::Internal;
 
+namespace {
+
+/**
+ * Reads an image from a file into a slot provided by the caller.
+ */
+class ReadImageJob : public QRunnable
+{
+public:
+    ReadImageJob(const QString &fileName, QImage *image)
+        : mFileName(fileName)
+        , mImage(image)
+    {}
+
+    void run()
+    {
+        *mImage = QImage(mFileName);
+    }
+
+private:
+    QString mFileName;
+    QImage *mImage;
+};
+
+} // anonymous namespace
+
 TilesetManager *TilesetManager::mInstance = 0;
 
 TilesetManager::TilesetManager():
@@ -38,14 +67,16 @@ TilesetManager::TilesetManager():
     mAnimationDriver(new TileAnimationDriver(this)),
     mReloadTilesetsOnChange(false)
 {
-    connect(mWatcher, SIGNAL(fileChanged(QString)),
-            this, SLOT(fileChanged(QString)));
-
-    mChangedFilesTimer.setInterval(500);
-    mChangedFilesTimer.setSingleShot(true);
+    /*
+     * Wait a while before reloading, since GIMP (for example) seems to
+     * generate many file changes during a save, and some of the intermediate
+     * attempts to reload the tileset images actually fail (at least for .png
+     * files).
+     */
+    mWatcher->setChangeInterval(500);
 
-    connect(&mChangedFilesTimer, SIGNAL(timeout()),
-            this, SLOT(fileChangedTimeout()));
+    connect(mWatcher, SIGNAL(filesChanged(QStringList)),
+            this, SLOT(filesChanged(QStringList)));
 
     connect(mAnimationDriver, SIGNAL(update(int)),
             this, SLOT(advanceTileAnimations(int)));
@@ -118,6 +149,7 @@ void TilesetManager::removeReference(Tileset *tileset)
         if (!tileset->imageSource().isEmpty())
             mWatcher->removePath(tileset->imageSource());
 
+        mCollisionCache.invalidate(tileset);
         delete tileset;
     }
 }
@@ -169,30 +201,37 @@ bool TilesetManager::animateTiles() const
     return mAnimationDriver->state() == QAbstractAnimation::Running;
 }
 
-void TilesetManager::fileChanged(const QString &path)
+void TilesetManager::filesChanged(const QStringList &paths)
 {
     if (!mReloadTilesetsOnChange)
         return;
 
-    /*
-     * Use a one-shot timer since GIMP (for example) seems to generate many
-     * file changes during a save, and some of the intermediate attempts to
-     * reload the tileset images actually fail (at least for .png files).
-     */
-    mChangedFiles.insert(path);
-    mChangedFilesTimer.start();
-}
+    QHash<QString, QList<Tileset*> > changedTilesets;
+    foreach (Tileset *tileset, tilesets())
+        changedTilesets[tileset->imageSource()].append(tileset);
 
-void TilesetManager::fileChangedTimeout()
-{
-    foreach (Tileset *tileset, tilesets()) {
-        QString fileName = tileset->imageSource();
-        if (mChangedFiles.contains(fileName))
-            if (tileset->loadFromImage(fileName))
+    QStringList fileNames;
+    foreach (const QString &path, paths)
+        if (changedTilesets.contains(path))
+            fileNames.append(path);
+
+    if (fileNames.isEmpty())
+        return;
+
+    // Decode the changed images in parallel. Creating the pixmaps for the
+    // tiles has to happen on this thread.
+    QVector<QImage> images(fileNames.size());
+    QThreadPool threadPool;
+    for (int i = 0; i < fileNames.size(); ++i)
+        threadPool.start(new ReadImageJob(fileNames.at(i), &images[i]));
+    threadPool.waitForDone();
+
+    for (int i = 0; i < fileNames.size(); ++i) {
+        const QString &fileName = fileNames.at(i);
+        foreach (Tileset *tileset, changedTilesets.value(fileName))
+            if (tileset->loadFromImage(images.at(i), fileName))
                 emit tilesetChanged(tileset);
     }
-
-    mChangedFiles.clear();
 }
 
 void TilesetManager::advanceTileAnimations(int ms)
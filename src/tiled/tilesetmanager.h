@@ -22,12 +22,13 @@
 #ifndef TILESETMANAGER_H
 #define TILESETMANAGER_H
 
+#include "collisioncache.h"
+
 #include <QObject>
 #include <QList>
 #include <QMap>
 #include <QString>
-#include <QSet>
-#include <QTimer>
+#include <QStringList>
 
 namespace Tiled {
 
@@ -131,6 +132,14 @@ public:
     void setAnimateTiles(bool enabled);
     bool animateTiles() const;
 
+    /**
+     * Returns the compiled collision shapes of the tiles of all tilesets.
+     * Since tilesets are shared between maps, so is this cache. It needs to
+     * be invalidated when the object group of a tile changes and when tiles
+     * are added to or removed from a tileset.
+     */
+    CollisionCache *collisionCache() { return &mCollisionCache; }
+
 signals:
     /**
      * Emitted when a tileset's images have changed and views need updating.
@@ -145,8 +154,7 @@ signals:
     void repaintTileset(Tileset *tileset);
 
 private slots:
-    void fileChanged(const QString &path);
-    void fileChangedTimeout();
+    void filesChanged(const QStringList &paths);
 
     void advanceTileAnimations(int ms);
 
@@ -171,9 +179,8 @@ private:
     QMap<Tileset*, int> mTilesets;
     FileSystemWatcher *mWatcher;
     TileAnimationDriver *mAnimationDriver;
-    QSet<QString> mChangedFiles;
-    QTimer mChangedFilesTimer;
     bool mReloadTilesetsOnChange;
+    CollisionCache mCollisionCache;
 };
 
 inline bool TilesetManager::reloadTilesetsOnChange() const
@@ -79,7 +79,8 @@ Map *TmxMapReader::read(const QString &fileName)
     return map;
 }
 
-Map *TmxMapReader::fromByteArray(const QByteArray &data)
+Map *TmxMapReader::fromByteArray(const QByteArray &data,
+                                 const QString &path)
 {
     mError.clear();
 
@@ -88,7 +89,7 @@ Map *TmxMapReader::fromByteArray(const QByteArray &data)
     buffer.open(QBuffer::ReadOnly);
 
     EditorMapReader reader;
-    Map *map = reader.readMap(&buffer);
+    Map *map = reader.readMap(&buffer, path);
     if (!map)
         mError = reader.errorString();
 
@@ -46,9 +46,14 @@ public:
      * Reads the map given by \a data. This is for retrieving a map from the
      * clipboard. Returns 0 on failure.
      *
+     * Relative references to external tilesets and images are resolved
+     * against \a path when given, and against the working directory
+     * otherwise.
+     *
      * @see TmxMapWriter::toByteArray
      */
-    Map *fromByteArray(const QByteArray &data);
+    Map *fromByteArray(const QByteArray &data,
+                       const QString &path = QString());
 
     Tileset *readTileset(const QString &fileName);
 
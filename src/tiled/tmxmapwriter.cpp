@@ -62,14 +62,14 @@ bool TmxMapWriter::writeTileset(const Tileset *tileset,
     return result;
 }
 
-QByteArray TmxMapWriter::toByteArray(const Map *map)
+QByteArray TmxMapWriter::toByteArray(const Map *map, const QString &path)
 {
     QByteArray bytes;
     QBuffer buffer(&bytes);
     buffer.open(QIODevice::WriteOnly);
 
     MapWriter writer;
-    writer.writeMap(map, &buffer);
+    writer.writeMap(map, &buffer, path);
 
     return bytes;
 }
@@ -47,11 +47,12 @@ public:
     /**
      * Converts the given map to a utf8 byte array (in .tmx format). This is
      * for storing a map in the clipboard. References to other files (like
-     * tileset images) will be saved as absolute paths.
+     * tileset images) are made relative to \a path when given, and to the
+     * working directory otherwise.
      *
      * @see TmxMapReader::fromByteArray
      */
-    QByteArray toByteArray(const Map *map);
+    QByteArray toByteArray(const Map *map, const QString &path = QString());
 
     QString nameFilter() const { return tr("Tiled map files (*.tmx)"); }
 
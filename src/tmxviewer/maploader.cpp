@@ -0,0 +1,259 @@
+/*
+ * maploader.cpp
+ * Copyright 2015, Sydoria Games <luax@sydoria.fr>
+ *
+ * This file is part of the TMX Viewer example.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *    1. Redistributions of source code must retain the above copyright notice,
+ *       this list of conditions and the following disclaimer.
+ *
+ *    2. Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE CONTRIBUTORS ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO
+ * EVENT SHALL THE CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "maploader.h"
+
+#include "compression.h"
+
+#include <QFile>
+#include <QMutexLocker>
+#include <QXmlStreamReader>
+#include <QXmlStreamWriter>
+
+using namespace Tiled;
+
+MapLoader::MapLoader(const QString &fileName, QObject *parent)
+    : QThread(parent)
+    , mFileName(fileName)
+    , mCancelled(false)
+{
+}
+
+MapLoader::~MapLoader()
+{
+    cancel();
+    wait();
+}
+
+QByteArray MapLoader::skeleton() const
+{
+    QMutexLocker locker(&mMutex);
+    return mSkeleton;
+}
+
+QVector<unsigned> MapLoader::firstGids() const
+{
+    QMutexLocker locker(&mMutex);
+    return mFirstGids;
+}
+
+QVector<unsigned> MapLoader::takeLayerData(int index)
+{
+    QMutexLocker locker(&mMutex);
+    return mLayerData.take(index);
+}
+
+QString MapLoader::errorString() const
+{
+    QMutexLocker locker(&mMutex);
+    return mError;
+}
+
+void MapLoader::cancel()
+{
+    QMutexLocker locker(&mMutex);
+    mCancelled = true;
+}
+
+bool MapLoader::isCancelled() const
+{
+    QMutexLocker locker(&mMutex);
+    return mCancelled;
+}
+
+void MapLoader::setError(const QString &error)
+{
+    QMutexLocker locker(&mMutex);
+    mError = error;
+}
+
+void MapLoader::run()
+{
+    QList<PendingLayer> layers;
+    if (!readSkeleton(layers)) {
+        emit failed();
+        return;
+    }
+
+    emit mapReady();
+
+    foreach (const PendingLayer &layer, layers) {
+        if (isCancelled())
+            return;
+
+        QVector<unsigned> gids;
+        if (!decodeLayer(layer, gids)) {
+            emit failed();
+            return;
+        }
+
+        {
+            QMutexLocker locker(&mMutex);
+            mLayerData.insert(layer.index, gids);
+        }
+
+        emit layerDataReady(layer.index);
+    }
+}
+
+/**
+ * Copies the map to the skeleton, leaving out the data elements of the tile
+ * layers. Their contents are stored in \a layers, to be decoded later.
+ */
+bool MapLoader::readSkeleton(QList<PendingLayer> &layers)
+{
+    QFile file(mFileName);
+    if (!file.open(QIODevice::ReadOnly)) {
+        setError(tr("Could not open file for reading."));
+        return false;
+    }
+
+    QByteArray skeleton;
+    QVector<unsigned> firstGids;
+
+    QXmlStreamReader reader(&file);
+    QXmlStreamWriter writer(&skeleton);
+
+    int depth = 0;
+    int layerIndex = -1;
+    bool inTileLayer = false;
+
+    while (!reader.atEnd() && !isCancelled()) {
+        reader.readNext();
+
+        if (reader.isStartElement()) {
+            ++depth;
+
+            const QStringRef name = reader.name();
+            const QXmlStreamAttributes atts = reader.attributes();
+
+            if (depth == 2) {
+                inTileLayer = name == QLatin1String("layer");
+
+                if (name == QLatin1String("tileset")) {
+                    firstGids.append(atts.value(QLatin1String("firstgid"))
+                                     .toString().toUInt());
+                } else if (inTileLayer
+                           || name == QLatin1String("objectgroup")
+                           || name == QLatin1String("imagelayer")) {
+                    ++layerIndex;
+                }
+
+                if (inTileLayer) {
+                    PendingLayer layer;
+                    layer.index = layerIndex;
+                    layer.width = atts.value(QLatin1String("width")).toString().toInt();
+                    layer.height = atts.value(QLatin1String("height")).toString().toInt();
+                    layers.append(layer);
+                }
+            } else if (depth == 3 && inTileLayer
+                       && name == QLatin1String("data")) {
+                PendingLayer &layer = layers.last();
+                layer.encoding = atts.value(QLatin1String("encoding")).toString();
+                layer.compression = atts.value(QLatin1String("compression")).toString();
+
+                if (layer.encoding.isEmpty()) {
+                    while (reader.readNextStartElement()) {
+                        if (reader.name() == QLatin1String("tile")) {
+                            layer.gids.append(reader.attributes()
+                                              .value(QLatin1String("gid"))
+                                              .toString().toUInt());
+                        }
+                        reader.skipCurrentElement();
+                    }
+                } else {
+                    layer.text = reader.readElementText().toLatin1();
+                }
+
+                // The data element, including its end, has been consumed
+                --depth;
+                continue;
+            }
+        } else if (reader.isEndElement()) {
+            --depth;
+        }
+
+        writer.writeCurrentToken(reader);
+    }
+
+    if (reader.hasError()) {
+        setError(tr("%3\n\nLine %1, column %2")
+                 .arg(reader.lineNumber())
+                 .arg(reader.columnNumber())
+                 .arg(reader.errorString()));
+        return false;
+    }
+
+    QMutexLocker locker(&mMutex);
+    mSkeleton = skeleton;
+    mFirstGids = firstGids;
+    return true;
+}
+
+bool MapLoader::decodeLayer(const PendingLayer &layer, QVector<unsigned> &gids)
+{
+    const int size = layer.width * layer.height;
+
+    if (layer.encoding.isEmpty()) {
+        gids = layer.gids;
+    } else if (layer.encoding == QLatin1String("csv")) {
+        const QList<QByteArray> values = layer.text.split(',');
+        gids.reserve(values.size());
+        foreach (const QByteArray &value, values)
+            gids.append(value.trimmed().toUInt());
+    } else if (layer.encoding == QLatin1String("base64")) {
+        QByteArray data = QByteArray::fromBase64(layer.text);
+
+        if (layer.compression == QLatin1String("zlib"))
+            data = decompress(data, size * 4, Zlib);
+        else if (layer.compression == QLatin1String("gzip"))
+            data = decompress(data, size * 4, Gzip);
+        else if (!layer.compression.isEmpty()) {
+            setError(tr("Compression method '%1' not supported")
+                     .arg(layer.compression));
+            return false;
+        }
+
+        if (data.size() != size * 4) {
+            setError(tr("Corrupt layer data for layer %1")
+                     .arg(layer.index));
+            return false;
+        }
+
+        const uchar *bytes = reinterpret_cast<const uchar*>(data.constData());
+        gids.resize(size);
+        for (int i = 0; i < size; ++i, bytes += 4)
+            gids[i] = bytes[0] | bytes[1] << 8 | bytes[2] << 16 | unsigned(bytes[3]) << 24;
+    } else {
+        setError(tr("Unknown encoding: %1").arg(layer.encoding));
+        return false;
+    }
+
+    gids.resize(size);
+    return true;
+}
@@ -0,0 +1,117 @@
+/*
+ * maploader.h
+ * Copyright 2015, Sydoria Games <luax@sydoria.fr>
+ *
+ * This file is part of the TMX Viewer example.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *    1. Redistributions of source code must retain the above copyright notice,
+ *       this list of conditions and the following disclaimer.
+ *
+ *    2. Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE CONTRIBUTORS ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO
+ * EVENT SHALL THE CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef MAPLOADER_H
+#define MAPLOADER_H
+
+#include <QByteArray>
+#include <QHash>
+#include <QMutex>
+#include <QString>
+#include <QThread>
+#include <QVector>
+
+/**
+ * Loads a TMX map in two steps on a background thread.
+ *
+ * First the map is read without the data of its tile layers, which gives a
+ * skeleton that can be read by the MapReader quickly. Tilesets and pixmaps
+ * have to be created on the GUI thread, so this is left to the receiver of
+ * mapReady(). The tile layer data is then decoded one layer at a time and
+ * each layer is announced with layerDataReady() as soon as it is done.
+ */
+class MapLoader : public QThread
+{
+    Q_OBJECT
+
+public:
+    explicit MapLoader(const QString &fileName, QObject *parent = 0);
+
+    /**
+     * Cancels the loading and waits for the thread to finish.
+     */
+    ~MapLoader();
+
+    const QString &fileName() const { return mFileName; }
+
+    /**
+     * Returns the map without tile layer data. Valid after mapReady().
+     */
+    QByteArray skeleton() const;
+
+    /**
+     * Returns the first global tile ID of each tileset, in the order in
+     * which the tilesets appear in the map. Valid after mapReady().
+     */
+    QVector<unsigned> firstGids() const;
+
+    /**
+     * Takes the global tile IDs of the tile layer at \a index, row by row.
+     */
+    QVector<unsigned> takeLayerData(int index);
+
+    QString errorString() const;
+
+    void cancel();
+
+signals:
+    void mapReady();
+    void layerDataReady(int index);
+    void failed();
+
+protected:
+    void run();
+
+private:
+    struct PendingLayer
+    {
+        int index;
+        int width;
+        int height;
+        QString encoding;
+        QString compression;
+        QByteArray text;
+        QVector<unsigned> gids;
+    };
+
+    bool readSkeleton(QList<PendingLayer> &layers);
+    bool decodeLayer(const PendingLayer &layer, QVector<unsigned> &gids);
+    bool isCancelled() const;
+    void setError(const QString &error);
+
+    const QString mFileName;
+
+    mutable QMutex mMutex;
+    QByteArray mSkeleton;
+    QVector<unsigned> mFirstGids;
+    QHash<int, QVector<unsigned> > mLayerData;
+    QString mError;
+    bool mCancelled;
+};
+
+#endif // MAPLOADER_H
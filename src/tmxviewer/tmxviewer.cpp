@@ -28,6 +28,8 @@
 
 #include "tmxviewer.h"
 
+#include "maploader.h"
+
 #include "hexagonalrenderer.h"
 #include "isometricrenderer.h"
 #include "map.h"
@@ -39,58 +41,38 @@
 #include "tilelayer.h"
 #include "tileset.h"
 
+#include <QBuffer>
 #include <QCoreApplication>
 #include <QDebug>
+#include <QFileInfo>
 #include <QGraphicsItem>
 #include <QGraphicsScene>
+#include <QHash>
+#include <QPainter>
+#include <QPair>
 #include <QStyleOptionGraphicsItem>
+#include <QWheelEvent>
+
+#include <cmath>
 
 using namespace Tiled;
 
 /**
- * Item that represents a map object.
+ * The size of a cached chunk of a zoomed out tile layer, in device pixels.
  */
-class MapObjectItem : public QGraphicsItem
-{
-public:
-    MapObjectItem(MapObject *mapObject, MapRenderer *renderer,
-                  QGraphicsItem *parent = 0)
-        : QGraphicsItem(parent)
-        , mMapObject(mapObject)
-        , mRenderer(renderer)
-    {
-        const QPointF &position = mapObject->position();
-        const QPointF pixelPos = renderer->pixelToScreenCoords(position);
-
-        QRectF boundingRect = renderer->boundingRect(mapObject);
-        boundingRect.translate(-pixelPos);
-        mBoundingRect = boundingRect;
-
-        setPos(pixelPos);
-        setRotation(mapObject->rotation());
-    }
-
-    QRectF boundingRect() const
-    {
-        return mBoundingRect;
-    }
-
-    void paint(QPainter *p, const QStyleOptionGraphicsItem *, QWidget *)
-    {
-        const QColor &color = mMapObject->objectGroup()->color();
-        p->translate(-pos());
-        mRenderer->drawMapObject(p, mMapObject,
-                                 color.isValid() ? color : Qt::darkGray);
-    }
+static const int chunkSize = 256;
 
-private:
-    MapObject *mMapObject;
-    MapRenderer *mRenderer;
-    QRectF mBoundingRect;
-};
+/**
+ * The maximum amount of cached chunks per tile layer.
+ */
+static const int maxChunks = 256;
 
 /**
  * Item that represents a tile layer.
+ *
+ * When zoomed out, drawing each tile gets expensive while each of them only
+ * covers a few pixels. In that case the layer is drawn through a cache of
+ * downscaled chunks, which are kept until the scale changes.
  */
 class TileLayerItem : public QGraphicsItem
 {
@@ -100,10 +82,21 @@ public:
         : QGraphicsItem(parent)
         , mTileLayer(tileLayer)
         , mRenderer(renderer)
+        , mScale(0)
     {
         setFlag(QGraphicsItem::ItemUsesExtendedStyleOption);
     }
 
+    /**
+     * Drops the cached chunks and repaints the layer. Should be called when
+     * the cells of the layer have changed.
+     */
+    void invalidate()
+    {
+        mChunks.clear();
+        update();
+    }
+
     QRectF boundingRect() const
     {
         return mRenderer->boundingRect(mTileLayer->bounds());
@@ -111,16 +104,86 @@ public:
 
     void paint(QPainter *p, const QStyleOptionGraphicsItem *option, QWidget *)
     {
-        mRenderer->drawTileLayer(p, mTileLayer, option->rect);
+        const qreal scale = QStyleOptionGraphicsItem::levelOfDetailFromTransform(
+                    p->worldTransform());
+
+        if (scale >= 1) {
+            mChunks.clear();
+            mScale = 0;
+            mRenderer->drawTileLayer(p, mTileLayer, option->rect);
+            return;
+        }
+
+        if (scale != mScale) {
+            mChunks.clear();
+            mScale = scale;
+        }
+
+        const QRectF exposed = option->exposedRect & boundingRect();
+        if (exposed.isEmpty())
+            return;
+
+        const qreal size = chunkSize / mScale;
+        const int left = std::floor(exposed.left() / size);
+        const int top = std::floor(exposed.top() / size);
+        const int right = std::floor(exposed.right() / size);
+        const int bottom = std::floor(exposed.bottom() / size);
+
+        const int exposedChunks = (right - left + 1) * (bottom - top + 1);
+        if (mChunks.size() + exposedChunks > maxChunks)
+            mChunks.clear();
+
+        for (int y = top; y <= bottom; ++y) {
+            for (int x = left; x <= right; ++x) {
+                const ChunkIndex index(x, y);
+                const QRectF rect(x * size, y * size, size, size);
+
+                QPixmap chunk = mChunks.value(index);
+                if (chunk.isNull()) {
+                    chunk = renderChunk(rect);
+                    if (exposedChunks <= maxChunks)
+                        mChunks.insert(index, chunk);
+                }
+
+                p->drawPixmap(rect, chunk, QRectF(chunk.rect()));
+            }
+        }
     }
 
 private:
+    typedef QPair<int, int> ChunkIndex;
+
+    QPixmap renderChunk(const QRectF &rect) const
+    {
+        QPixmap chunk(chunkSize, chunkSize);
+        chunk.fill(Qt::transparent);
+
+        QPainter painter(&chunk);
+        painter.setRenderHint(QPainter::SmoothPixmapTransform);
+        painter.scale(mScale, mScale);
+        painter.translate(-rect.topLeft());
+        mRenderer->drawTileLayer(&painter, mTileLayer, rect);
+
+        return chunk;
+    }
+
     TileLayer *mTileLayer;
     MapRenderer *mRenderer;
+
+    qreal mScale;
+    QHash<ChunkIndex, QPixmap> mChunks;
 };
 
+static bool objectLessThan(const MapObject *a, const MapObject *b)
+{
+    return a->y() < b->y();
+}
+
 /**
  * Item that represents an object group.
+ *
+ * The objects are drawn by the group rather than by an item each, so that
+ * runs of plain tile objects can be drawn in batches.
  */
 class ObjectGroupItem : public QGraphicsItem
 {
@@ -128,21 +191,77 @@ public:
     ObjectGroupItem(ObjectGroup *objectGroup, MapRenderer *renderer,
                     QGraphicsItem *parent = 0)
         : QGraphicsItem(parent)
+        , mObjectGroup(objectGroup)
+        , mRenderer(renderer)
+        , mObjects(objectGroup->objects())
     {
-        setFlag(QGraphicsItem::ItemHasNoContents);
+        setFlag(QGraphicsItem::ItemUsesExtendedStyleOption);
 
-        const ObjectGroup::DrawOrder drawOrder = objectGroup->drawOrder();
+        if (objectGroup->drawOrder() == ObjectGroup::TopDownOrder)
+            qStableSort(mObjects.begin(), mObjects.end(), objectLessThan);
 
-        // Create a child item for each object
-        foreach (MapObject *object, objectGroup->objects()) {
-            MapObjectItem *item = new MapObjectItem(object, renderer, this);
-            if (drawOrder == ObjectGroup::TopDownOrder)
-                item->setZValue(item->y());
+        foreach (const MapObject *object, mObjects) {
+            const QRectF bounds = objectTransform(object).mapRect(
+                        renderer->boundingRect(object));
+            mObjectBounds.append(bounds);
+            mBoundingRect |= bounds;
         }
     }
 
-    QRectF boundingRect() const { return QRectF(); }
-    void paint(QPainter *, const QStyleOptionGraphicsItem *, QWidget *) {}
+    QRectF boundingRect() const
+    {
+        return mBoundingRect;
+    }
+
+    void paint(QPainter *p, const QStyleOptionGraphicsItem *option, QWidget *)
+    {
+        const QColor &groupColor = mObjectGroup->color();
+        const QColor color = groupColor.isValid() ? groupColor : Qt::darkGray;
+
+        QList<const MapObject*> tileObjects;
+
+        for (int i = 0; i < mObjects.size(); ++i) {
+            const MapObject *object = mObjects.at(i);
+            if (!mObjectBounds.at(i).intersects(option->exposedRect))
+                continue;
+
+            if (mRenderer->canBatchTileObject(object)) {
+                tileObjects.append(object);
+                continue;
+            }
+
+            mRenderer->drawTileObjects(p, tileObjects);
+            tileObjects.clear();
+
+            p->save();
+            p->setTransform(objectTransform(object), true);
+            mRenderer->drawMapObject(p, object, color);
+            p->restore();
+        }
+
+        mRenderer->drawTileObjects(p, tileObjects);
+    }
+
+private:
+    QTransform objectTransform(const MapObject *object) const
+    {
+        QTransform transform;
+
+        if (object->rotation() != qreal(0)) {
+            const QPointF origin = mRenderer->pixelToScreenCoords(object->position());
+            transform.translate(origin.x(), origin.y());
+            transform.rotate(object->rotation());
+            transform.translate(-origin.x(), -origin.y());
+        }
+
+        return transform;
+    }
+
+    ObjectGroup *mObjectGroup;
+    MapRenderer *mRenderer;
+    QList<MapObject*> mObjects;
+    QVector<QRectF> mObjectBounds;
+    QRectF mBoundingRect;
 };
 
 /**
@@ -158,24 +277,42 @@ public:
 
         // Create a child item for each layer
         foreach (Layer *layer, map->layers()) {
+            TileLayerItem *tileLayerItem = 0;
+
             if (TileLayer *tileLayer = layer->asTileLayer()) {
-                new TileLayerItem(tileLayer, renderer, this);
+                tileLayerItem = new TileLayerItem(tileLayer, renderer, this);
             } else if (ObjectGroup *objectGroup = layer->asObjectGroup()) {
                 new ObjectGroupItem(objectGroup, renderer, this);
             }
+
+            mTileLayerItems.append(tileLayerItem);
         }
     }
 
+    /**
+     * Returns the item of the tile layer at \a index, or 0 when the layer at
+     * that index is not a tile layer.
+     */
+    TileLayerItem *tileLayerItem(int index) const
+    {
+        return mTileLayerItems.value(index);
+    }
+
     QRectF boundingRect() const { return QRectF(); }
     void paint(QPainter *, const QStyleOptionGraphicsItem *, QWidget *) {}
+
+private:
+    QList<TileLayerItem*> mTileLayerItems;
 };
 
 
 TmxViewer::TmxViewer(QWidget *parent) :
     QGraphicsView(parent),
     mScene(new QGraphicsScene(this)),
+    mLoader(0),
     mMap(0),
-    mRenderer(0)
+    mRenderer(0),
+    mMapItem(0)
 {
     setWindowTitle(tr("TMX Viewer"));
 
@@ -192,28 +329,64 @@ TmxViewer::TmxViewer(QWidget *parent) :
 
 TmxViewer::~TmxViewer()
 {
-    if (mMap)
-        qDeleteAll(mMap->tilesets());
-
-    delete mMap;
-    delete mRenderer;
+    clear();
 }
 
 bool TmxViewer::viewMap(const QString &fileName)
 {
-    delete mRenderer;
-    mRenderer = 0;
-
-    mScene->clear();
+    clear();
     centerOn(0, 0);
 
+    if (!QFileInfo(fileName).isReadable()) {
+        qWarning() << "Error:" << "Could not open file for reading.";
+        return false;
+    }
+
+    mLoader = new MapLoader(fileName, this);
+    connect(mLoader, SIGNAL(mapReady()), SLOT(mapReady()));
+    connect(mLoader, SIGNAL(layerDataReady(int)), SLOT(layerDataReady(int)));
+    connect(mLoader, SIGNAL(failed()), SLOT(loadFailed()));
+    mLoader->start();
+
+    return true;
+}
+
+void TmxViewer::wheelEvent(QWheelEvent *event)
+{
+    if (event->modifiers() & Qt::ControlModifier
+            && event->orientation() == Qt::Vertical) {
+        const qreal factor = std::pow(1.2, event->delta() / 120.0);
+        scale(factor, factor);
+        return;
+    }
+
+    QGraphicsView::wheelEvent(event);
+}
+
+/**
+ * Reads the map without its tile layer data. This creates the tilesets, so
+ * it has to happen on the GUI thread.
+ */
+void TmxViewer::mapReady()
+{
+    QBuffer buffer;
+    buffer.setData(mLoader->skeleton());
+    buffer.open(QIODevice::ReadOnly);
+
     MapReader reader;
-    mMap = reader.readMap(fileName);
+    mMap = reader.readMap(&buffer,
+                          QFileInfo(mLoader->fileName()).absolutePath());
     if (!mMap) {
         qWarning() << "Error:" << qPrintable(reader.errorString());
-        return false;
+        QCoreApplication::exit(1);
+        return;
     }
 
+    const QVector<unsigned> firstGids = mLoader->firstGids();
+    const QList<Tileset*> &tilesets = mMap->tilesets();
+    for (int i = 0; i < tilesets.size() && i < firstGids.size(); ++i)
+        mGidMapper.insert(firstGids.at(i), tilesets.at(i));
+
     switch (mMap->orientation()) {
     case Map::Isometric:
         mRenderer = new IsometricRenderer(mMap);
@@ -230,7 +403,60 @@ bool TmxViewer::viewMap(const QString &fileName)
         break;
     }
 
-    mScene->addItem(new MapItem(mMap, mRenderer));
+    mMapItem = new MapItem(mMap, mRenderer);
+    mScene->addItem(mMapItem);
+}
 
-    return true;
+void TmxViewer::layerDataReady(int index)
+{
+    const QVector<unsigned> gids = mLoader->takeLayerData(index);
+
+    TileLayer *tileLayer = mMap ? mMap->layerAt(index)->asTileLayer() : 0;
+    if (!tileLayer)
+        return;
+
+    int i = 0;
+    bool invalidTiles = false;
+
+    for (int y = 0; y < tileLayer->height(); ++y) {
+        for (int x = 0; x < tileLayer->width(); ++x, ++i) {
+            bool ok;
+            const Cell cell = mGidMapper.gidToCell(gids.at(i), ok);
+            if (ok)
+                tileLayer->setCell(x, y, cell);
+            else
+                invalidTiles = true;
+        }
+    }
+
+    if (invalidTiles)
+        qWarning() << "Invalid tile in layer" << qPrintable(tileLayer->name());
+
+    mMapItem->tileLayerItem(index)->invalidate();
+}
+
+void TmxViewer::loadFailed()
+{
+    qWarning() << "Error:" << qPrintable(mLoader->errorString());
+    QCoreApplication::exit(1);
+}
+
+void TmxViewer::clear()
+{
+    // Stops the loader, if it was still running
+    delete mLoader;
+    mLoader = 0;
+
+    mScene->clear();
+    mMapItem = 0;
+
+    delete mRenderer;
+    mRenderer = 0;
+
+    if (mMap)
+        qDeleteAll(mMap->tilesets());
+    delete mMap;
+    mMap = 0;
+
+    mGidMapper.clear();
 }
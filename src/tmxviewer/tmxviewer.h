@@ -29,6 +29,8 @@
 #ifndef TMXVIEWER_H
 #define TMXVIEWER_H
 
+#include "gidmapper.h"
+
 #include <QGraphicsView>
 
 namespace Tiled {
@@ -36,6 +38,9 @@ class Map;
 class MapRenderer;
 }
 
+class MapItem;
+class MapLoader;
+
 class TmxViewer : public QGraphicsView
 {
     Q_OBJECT
@@ -44,12 +49,30 @@ public:
     explicit TmxViewer(QWidget *parent = 0);
     ~TmxViewer();
 
+    /**
+     * Starts loading the map in the background. The map is shown as soon as
+     * its tilesets are loaded, and its tile layers appear as they are
+     * decoded.
+     */
     bool viewMap(const QString &fileName);
 
+protected:
+    void wheelEvent(QWheelEvent *event);
+
+private slots:
+    void mapReady();
+    void layerDataReady(int index);
+    void loadFailed();
+
 private:
+    void clear();
+
     QGraphicsScene *mScene;
+    MapLoader *mLoader;
     Tiled::Map *mMap;
     Tiled::MapRenderer *mRenderer;
+    Tiled::GidMapper mGidMapper;
+    MapItem *mMapItem;
 };
 
 #endif // TMXVIEWER_H
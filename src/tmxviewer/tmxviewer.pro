@@ -35,9 +35,11 @@ macx {
 }
 
 SOURCES += main.cpp \
+         maploader.cpp \
          tmxviewer.cpp
 
-HEADERS += tmxviewer.h
+HEADERS += maploader.h \
+         tmxviewer.h
 
 manpage.path = $${PREFIX}/share/man/man1/
 manpage.files += ../../docs/tmxviewer.1
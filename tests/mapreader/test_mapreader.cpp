@@ -1,21 +1,99 @@
+#include "imagelayer.h"
 #include "map.h"
 #include "mapobject.h"
 #include "objectgroup.h"
 #include "tilelayer.h"
 #include "mapreader.h"
+#include "mapwriter.h"
+#include "tile.h"
+#include "tileset.h"
 
 #include <QtTest/QtTest>
+#include <QPainter>
 
 using namespace Tiled;
 
+/**
+ * A map reader that remembers the external images it was asked to read.
+ * These may be read from several threads at once.
+ */
+class RecordingMapReader : public MapReader
+{
+public:
+    QStringList readImages() const
+    {
+        QMutexLocker locker(&mMutex);
+        return mReadImages;
+    }
+
+protected:
+    QImage readExternalImage(const QString &source)
+    {
+        QMutexLocker locker(&mMutex);
+        mReadImages.append(source);
+        return MapReader::readExternalImage(source);
+    }
+
+private:
+    mutable QMutex mMutex;
+    QStringList mReadImages;
+};
+
 class test_MapReader : public QObject
 {
     Q_OBJECT
 
 private slots:
+    void initTestCase();
+    void cleanupTestCase();
+
     void loadMap();
+    void tileLayerDataRoundTrip_data();
+    void tileLayerDataRoundTrip();
+    void readMapFromDeviceWithPath();
+    void readExternalTilesetImages();
+    void readMissingTilesetImage();
+    void readBrokenTilesetImage();
+
+private:
+    QString writeFile(const QString &fileName, const QByteArray &contents);
+
+    QDir mTempDir;
 };
 
+static const char tempDirName[] = "tiled-test-mapreader";
+
+void test_MapReader::initTestCase()
+{
+    mTempDir = QDir::temp();
+    QVERIFY(mTempDir.mkpath(QLatin1String(tempDirName)));
+    QVERIFY(mTempDir.cd(QLatin1String(tempDirName)));
+}
+
+void test_MapReader::cleanupTestCase()
+{
+    foreach (const QString &fileName, mTempDir.entryList(QDir::Files))
+        mTempDir.remove(fileName);
+
+    QDir::temp().rmdir(QLatin1String(tempDirName));
+}
+
+/**
+ * Writes a file with the given \a contents to the temporary directory and
+ * returns its absolute path.
+ */
+QString test_MapReader::writeFile(const QString &fileName,
+                                  const QByteArray &contents)
+{
+    const QString filePath = mTempDir.absoluteFilePath(fileName);
+
+    QFile file(filePath);
+    if (file.open(QIODevice::WriteOnly))
+        file.write(contents);
+
+    return filePath;
+}
+
 void test_MapReader::loadMap()
 {
     MapReader reader;
@@ -53,5 +131,284 @@ void test_MapReader::loadMap()
     QCOMPARE(mapObject->height(), qreal(64));
 }
 
+void test_MapReader::tileLayerDataRoundTrip_data()
+{
+    QTest::addColumn<int>("format");
+
+    QTest::newRow("xml") << int(Map::XML);
+    QTest::newRow("csv") << int(Map::CSV);
+    QTest::newRow("base64") << int(Map::Base64);
+    QTest::newRow("base64-zlib") << int(Map::Base64Zlib);
+}
+
+/**
+ * Writes a tile layer with empty cells and flipped tiles in each layer data
+ * format and checks that it reads back the same.
+ */
+void test_MapReader::tileLayerDataRoundTrip()
+{
+    QFETCH(int, format);
+
+    Tileset *tileset = new Tileset(QLatin1String("tiles"), 8, 8);
+    for (int i = 0; i < 12; ++i) {
+        QPixmap image(8, 8);
+        image.fill(QColor(i * 20, 0, 0));
+        tileset->addTile(image);
+    }
+
+    Map map(Map::Orthogonal, 5, 3, 8, 8);
+    map.setLayerDataFormat(Map::LayerDataFormat(format));
+    map.addTileset(tileset);
+
+    // The middle row is left empty
+    TileLayer *tileLayer = new TileLayer(QLatin1String("Tiles"), 0, 0, 5, 3);
+    tileLayer->setCell(0, 0, Cell(tileset->tileAt(0)));
+    tileLayer->setCell(2, 0, Cell(tileset->tileAt(11)));
+
+    Cell flipped(tileset->tileAt(3));
+    flipped.flippedHorizontally = true;
+    tileLayer->setCell(3, 0, flipped);
+
+    flipped = Cell(tileset->tileAt(9));
+    flipped.flippedVertically = true;
+    tileLayer->setCell(0, 2, flipped);
+
+    flipped = Cell(tileset->tileAt(10));
+    flipped.flippedAntiDiagonally = true;
+    tileLayer->setCell(1, 2, flipped);
+
+    tileLayer->setCell(2, 2, Cell(tileset->tileAt(1)));
+
+    flipped = Cell(tileset->tileAt(2));
+    flipped.flippedHorizontally = true;
+    flipped.flippedVertically = true;
+    flipped.flippedAntiDiagonally = true;
+    tileLayer->setCell(4, 2, flipped);
+
+    map.addLayer(tileLayer);
+
+    QByteArray data;
+    QBuffer buffer(&data);
+    buffer.open(QIODevice::WriteOnly);
+    MapWriter writer;
+    writer.writeMap(&map, &buffer);
+    buffer.close();
+
+    if (format == Map::XML) {
+        QVERIFY(data.contains("<tile/>"));
+        QVERIFY(data.contains("<tile gid=\"2147483652\"/>"));
+    } else if (format == Map::CSV) {
+        QVERIFY(data.contains("1,0,12,2147483652,0,\n0,0,0,0,0,\n"
+                              "1073741834,536870923,2,0,3758096387\n"));
+    }
+
+    buffer.open(QIODevice::ReadOnly);
+    MapReader reader;
+    Map *readMap = reader.readMap(&buffer);
+
+    QVERIFY2(readMap, qPrintable(reader.errorString()));
+    QCOMPARE(readMap->tilesets().size(), 1);
+    QCOMPARE(readMap->layerCount(), 1);
+
+    TileLayer *readTileLayer = readMap->layerAt(0)->asTileLayer();
+    QVERIFY(readTileLayer);
+    QCOMPARE(readTileLayer->size(), tileLayer->size());
+
+    for (int y = 0; y < tileLayer->height(); ++y) {
+        for (int x = 0; x < tileLayer->width(); ++x) {
+            const Cell &cell = tileLayer->cellAt(x, y);
+            const Cell &readCell = readTileLayer->cellAt(x, y);
+
+            QCOMPARE(readCell.isEmpty(), cell.isEmpty());
+            if (cell.isEmpty())
+                continue;
+
+            QCOMPARE(readCell.tile->id(), cell.tile->id());
+            QCOMPARE(readCell.flippedHorizontally, cell.flippedHorizontally);
+            QCOMPARE(readCell.flippedVertically, cell.flippedVertically);
+            QCOMPARE(readCell.flippedAntiDiagonally, cell.flippedAntiDiagonally);
+        }
+    }
+
+    // The tilesets are not owned by the maps
+    qDeleteAll(readMap->tilesets());
+    delete readMap;
+    delete tileset;
+}
+
+/**
+ * Maps stored in memory (like the checkpoints of the edit journal) keep their
+ * references relative to the given path, so that they can be read back from
+ * any working directory.
+ */
+void test_MapReader::readMapFromDeviceWithPath()
+{
+    const QString mapPath = mTempDir.absolutePath();
+    const QString imageFileName = mTempDir.absoluteFilePath(QLatin1String("image.png"));
+
+    QImage image(16, 16, QImage::Format_ARGB32);
+    image.fill(Qt::red);
+    QVERIFY(image.save(imageFileName));
+
+    Map map(Map::Orthogonal, 10, 10, 32, 32);
+    ImageLayer *imageLayer = new ImageLayer(QLatin1String("Image"), 0, 0, 10, 10);
+    QVERIFY(imageLayer->loadFromFile(imageFileName));
+    map.addLayer(imageLayer);
+
+    QByteArray data;
+    QBuffer buffer(&data);
+    buffer.open(QIODevice::WriteOnly);
+    MapWriter writer;
+    writer.writeMap(&map, &buffer, mapPath);
+    buffer.close();
+
+    QVERIFY(data.contains("source=\"image.png\""));
+
+    // Read back from a working directory that doesn't contain the image
+    const QString previousPath = QDir::currentPath();
+    QVERIFY(QDir::setCurrent(QDir::rootPath()));
+
+    buffer.open(QIODevice::ReadOnly);
+    MapReader reader;
+    Map *readMap = reader.readMap(&buffer, mapPath);
+
+    QDir::setCurrent(previousPath);
+
+    QVERIFY2(readMap, qPrintable(reader.errorString()));
+    QCOMPARE(readMap->layerCount(), 1);
+
+    ImageLayer *readImageLayer = readMap->layerAt(0)->asImageLayer();
+    QVERIFY(readImageLayer);
+    QCOMPARE(readImageLayer->imageSource(), imageFileName);
+
+    delete readMap;
+}
+
+/**
+ * The image of an external tileset is only decoded once the map needs its
+ * tiles, through the reader of the map.
+ */
+void test_MapReader::readExternalTilesetImages()
+{
+    QImage image(64, 32, QImage::Format_RGB32);
+    image.fill(Qt::red);
+    QPainter(&image).fillRect(32, 0, 32, 32, Qt::blue);
+
+    const QString imageFileName = mTempDir.absoluteFilePath(QLatin1String("tiles.png"));
+    QVERIFY(image.save(imageFileName));
+
+    writeFile(QLatin1String("tiles.tsx"),
+              "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+              "<tileset name=\"tiles\" tilewidth=\"32\" tileheight=\"32\">\n"
+              " <image source=\"tiles.png\" width=\"64\" height=\"32\"/>\n"
+              " <tile id=\"1\">\n"
+              "  <properties>\n"
+              "   <property name=\"color\" value=\"blue\"/>\n"
+              "  </properties>\n"
+              " </tile>\n"
+              "</tileset>\n");
+
+    const QString mapFileName = writeFile(
+                QLatin1String("external.tmx"),
+                "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+                "<map version=\"1.0\" orientation=\"orthogonal\" width=\"3\" height=\"1\" tilewidth=\"32\" tileheight=\"32\">\n"
+                " <tileset firstgid=\"1\" source=\"tiles.tsx\"/>\n"
+                " <layer name=\"Tiles\" width=\"3\" height=\"1\">\n"
+                "  <data encoding=\"csv\">2,0,1</data>\n"
+                " </layer>\n"
+                "</map>\n");
+
+    RecordingMapReader reader;
+    Map *map = reader.readMap(mapFileName);
+
+    QVERIFY2(map, qPrintable(reader.errorString()));
+    QCOMPARE(map->tilesets().size(), 1);
+
+    const QStringList readImages = reader.readImages();
+    QCOMPARE(readImages.size(), 1);
+    QCOMPARE(QFileInfo(readImages.first()).canonicalFilePath(),
+             QFileInfo(imageFileName).canonicalFilePath());
+
+    Tileset *tileset = map->tilesets().first();
+    QCOMPARE(tileset->tileCount(), 2);
+    QCOMPARE(tileset->imageWidth(), 64);
+    QCOMPARE(tileset->tileAt(1)->property(QLatin1String("color")),
+             QLatin1String("blue"));
+
+    const QImage first = tileset->tileAt(0)->image().toImage();
+    const QImage second = tileset->tileAt(1)->image().toImage();
+    QCOMPARE(first.size(), QSize(32, 32));
+    QCOMPARE(QColor(first.pixel(16, 16)), QColor(Qt::red));
+    QCOMPARE(QColor(second.pixel(16, 16)), QColor(Qt::blue));
+
+    TileLayer *tileLayer = map->layerAt(0)->asTileLayer();
+    QVERIFY(tileLayer);
+    QCOMPARE(tileLayer->cellAt(0, 0).tile, tileset->tileAt(1));
+    QVERIFY(tileLayer->cellAt(1, 0).isEmpty());
+    QCOMPARE(tileLayer->cellAt(2, 0).tile, tileset->tileAt(0));
+
+    qDeleteAll(map->tilesets());
+    delete map;
+}
+
+static QByteArray tilesetImageMap(const char *imageSource)
+{
+    return QByteArray("<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+                      "<map version=\"1.0\" orientation=\"orthogonal\" width=\"1\" height=\"1\" tilewidth=\"32\" tileheight=\"32\">\n"
+                      " <tileset firstgid=\"1\" name=\"tiles\" tilewidth=\"32\" tileheight=\"32\">\n"
+                      "  <image source=\"") + imageSource + "\" width=\"64\" height=\"32\"/>\n"
+                      " </tileset>\n"
+                      " <layer name=\"Tiles\" width=\"1\" height=\"1\">\n"
+                      "  <data encoding=\"csv\">1</data>\n"
+                      " </layer>\n"
+                      "</map>\n";
+}
+
+void test_MapReader::readMissingTilesetImage()
+{
+    const QString mapFileName = writeFile(QLatin1String("missing.tmx"),
+                                          tilesetImageMap("missing.png"));
+
+    MapReader reader;
+    Map *map = reader.readMap(mapFileName);
+
+    QVERIFY(!map);
+    QVERIFY(reader.errorString().contains(QLatin1String("missing.png")));
+}
+
+/**
+ * An image of which the header can be read, but not the pixels, only fails
+ * once the image is decoded.
+ */
+void test_MapReader::readBrokenTilesetImage()
+{
+    // Noise doesn't compress, so that cutting the file in half leaves the
+    // header intact
+    QImage image(64, 32, QImage::Format_RGB32);
+    quint32 seed = 1;
+    for (int y = 0; y < image.height(); ++y) {
+        for (int x = 0; x < image.width(); ++x) {
+            seed = seed * 1664525 + 1013904223;
+            image.setPixel(x, y, seed >> 8);
+        }
+    }
+
+    QByteArray data;
+    QBuffer buffer(&data);
+    buffer.open(QIODevice::WriteOnly);
+    QVERIFY(image.save(&buffer, "png"));
+    buffer.close();
+
+    writeFile(QLatin1String("broken.png"), data.left(data.size() / 2));
+    const QString mapFileName = writeFile(QLatin1String("broken.tmx"),
+                                          tilesetImageMap("broken.png"));
+
+    MapReader reader;
+    Map *map = reader.readMap(mapFileName);
+
+    QVERIFY(!map);
+    QVERIFY(reader.errorString().contains(QLatin1String("broken.png")));
+}
+
 QTEST_MAIN(test_MapReader)
 #include "test_mapreader.moc"
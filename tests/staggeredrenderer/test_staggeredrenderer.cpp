@@ -29,6 +29,8 @@ private slots:
 
     void relativeCoordinates();
 
+    void batchCoordinates();
+
 private:
     Map *mMap;
 };
@@ -140,5 +142,25 @@ void test_StaggeredRenderer::relativeCoordinates()
     QCOMPARE(renderer.bottomRight(1, 1), QPoint(2, 2));
 }
 
+void test_StaggeredRenderer::batchCoordinates()
+{
+    StaggeredRenderer renderer(mMap);
+
+    QPolygonF screenPoints;
+    for (int y = -20; y <= 60; y += 7)
+        for (int x = -40; x <= 120; x += 9)
+            screenPoints.append(QPointF(x, y));
+
+    const QPolygonF tiles = renderer.screenToTileCoords(screenPoints);
+    QCOMPARE(tiles.size(), screenPoints.size());
+    for (int i = 0; i < screenPoints.size(); ++i)
+        QCOMPARE(tiles.at(i), renderer.screenToTileCoords(screenPoints.at(i)));
+
+    const QPolygonF screen = renderer.tileToScreenCoords(tiles);
+    QCOMPARE(screen.size(), tiles.size());
+    for (int i = 0; i < tiles.size(); ++i)
+        QCOMPARE(screen.at(i), renderer.tileToScreenCoords(tiles.at(i)));
+}
+
 QTEST_MAIN(test_StaggeredRenderer)
 #include "test_staggeredrenderer.moc"
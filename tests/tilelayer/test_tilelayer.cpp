@@ -0,0 +1,108 @@
+#include "tile.h"
+#include "tilelayer.h"
+#include "tileset.h"
+
+#include <QtTest/QtTest>
+
+using namespace Tiled;
+
+class test_TileLayer : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void cleanupTestCase();
+
+    void merge();
+    void mergeClippedAtTopLeft();
+    void mergeClippedAtBottomRight();
+
+private:
+    TileLayer *createStamp() const;
+
+    Tileset *mTileset;
+};
+
+void test_TileLayer::initTestCase()
+{
+    mTileset = new Tileset(QLatin1String("tiles"), 32, 32);
+    for (int i = 0; i < 4; ++i)
+        mTileset->addTile(QPixmap(32, 32));
+}
+
+void test_TileLayer::cleanupTestCase()
+{
+    delete mTileset;
+    mTileset = 0;
+}
+
+/**
+ * Returns a 2x2 stamp with a different tile in each cell, except for the
+ * bottom-right cell which is empty.
+ */
+TileLayer *test_TileLayer::createStamp() const
+{
+    TileLayer *stamp = new TileLayer(QString(), 0, 0, 2, 2);
+    stamp->setCell(0, 0, Cell(mTileset->tileAt(0)));
+    stamp->setCell(1, 0, Cell(mTileset->tileAt(1)));
+    stamp->setCell(0, 1, Cell(mTileset->tileAt(2)));
+    return stamp;
+}
+
+void test_TileLayer::merge()
+{
+    TileLayer layer(QString(), 0, 0, 4, 4);
+    layer.setCell(2, 2, Cell(mTileset->tileAt(3)));
+
+    TileLayer *stamp = createStamp();
+    layer.merge(QPoint(1, 1), stamp);
+    delete stamp;
+
+    QCOMPARE(layer.cellAt(1, 1).tile, mTileset->tileAt(0));
+    QCOMPARE(layer.cellAt(2, 1).tile, mTileset->tileAt(1));
+    QCOMPARE(layer.cellAt(1, 2).tile, mTileset->tileAt(2));
+
+    // Empty cells of the merged layer are skipped
+    QCOMPARE(layer.cellAt(2, 2).tile, mTileset->tileAt(3));
+    QVERIFY(layer.cellAt(0, 0).isEmpty());
+}
+
+void test_TileLayer::mergeClippedAtTopLeft()
+{
+    TileLayer layer(QString(), 0, 0, 4, 4);
+
+    // Only the bottom-right quarter of the stamp overlaps the layer
+    TileLayer *stamp = createStamp();
+    layer.merge(QPoint(-1, -1), stamp);
+    delete stamp;
+
+    QVERIFY(layer.cellAt(0, 0).isEmpty());
+    QVERIFY(layer.cellAt(1, 0).isEmpty());
+    QVERIFY(layer.cellAt(0, 1).isEmpty());
+
+    // Only the top-right cell of the stamp overlaps a row of the layer
+    TileLayer *other = createStamp();
+    layer.merge(QPoint(-1, 0), other);
+    delete other;
+
+    QCOMPARE(layer.cellAt(0, 0).tile, mTileset->tileAt(1));
+    QVERIFY(layer.cellAt(1, 0).isEmpty());
+    QVERIFY(layer.cellAt(0, 1).isEmpty());
+}
+
+void test_TileLayer::mergeClippedAtBottomRight()
+{
+    TileLayer layer(QString(), 0, 0, 4, 4);
+
+    TileLayer *stamp = createStamp();
+    layer.merge(QPoint(3, 3), stamp);
+    delete stamp;
+
+    QCOMPARE(layer.cellAt(3, 3).tile, mTileset->tileAt(0));
+    QVERIFY(layer.cellAt(2, 3).isEmpty());
+    QVERIFY(layer.cellAt(3, 2).isEmpty());
+}
+
+QTEST_MAIN(test_TileLayer)
+#include "test_tilelayer.moc"